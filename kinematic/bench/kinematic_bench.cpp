@@ -0,0 +1,165 @@
+#include "kinematic.hpp"
+
+#pragma region bench utils
+// the chain the way forward() first built it, a 4×4 product per axis with the kind branched on at runtime,
+// kept as the baseline the specialized chains are timed and checked against
+static Eigen::Matrix4d reference_transform(const Robot& robot, const std::array<float, 6>& joint_values) {
+    Eigen::Matrix4d cumulative_transform = robot.transform;
+    for (size_t i = 0; i < robot.axes.size(); i++) {
+        const auto& axis = robot.axes[i];
+        Eigen::Matrix4d local_transform = Eigen::Matrix4d::Identity();
+        local_transform.block<3,1>(0,3) = axis.pivot;
+        if (axis.kind == Axis::Kind::Rotary) {
+            local_transform.block<3,3>(0,0) = Eigen::AngleAxisd(joint_values[i], axis.pivotNormal).toRotationMatrix();
+        } else {
+            local_transform(0, 3) += joint_values[i];
+        }
+        cumulative_transform *= local_transform;
+    }
+    return cumulative_transform;
+}
+
+// the demo's arm: sliding (or turning) base then five rotary axes alternating around X and Z, the second one around Y
+static Robot demo_robot(bool linear_base) {
+    Robot robot;
+    robot.transform = Eigen::Matrix4d::Identity();
+    for (int i = 0; i < 6; i++) {
+        robot.axes[i].kind = (i == 0 && linear_base) ? Axis::Kind::Linear : Axis::Kind::Rotary;
+        robot.axes[i].pivot = (i == 0) ? Eigen::Vector3d(0, 0, 0) : Eigen::Vector3d(0, 1.5, 0);
+        robot.axes[i].pivotNormal = (i == 1) ? Eigen::Vector3d(0, 1, 0) : (i % 2 == 0) ? Eigen::Vector3d(1, 0, 0) : Eigen::Vector3d(0, 0, 1);
+    }
+    return robot;
+}
+
+// the analytic Jacobian against central differences of chain_transform, column by column: the tip's position difference over 2h on top,
+// the rotation's difference over 2h times Rᵀ below, a skew matrix whose axial vector is the turn per unit of the joint (in base space)
+// step 1e-6 in doubles leaves ~1e-10 of truncation and rounding, anything near the tolerance is a wrong column
+constexpr double jacobian_step = 1e-6;
+constexpr double jacobian_tolerance = 1e-6;
+
+static double jacobian_difference(const Robot& robot, const Eigen::Vector3d& tip_position, const std::array<float, 6>& joint_values) {
+    std::array<double, 6> values;
+    for (int i = 0; i < 6; i++)
+        values[i] = joint_values[i];
+    const Jacobian analytic = geometric_jacobian(robot, tip_position, values);
+    const Eigen::Matrix3d rotation = chain_transform(robot, values).block<3,3>(0,0);
+    Jacobian numeric;
+    for (int i = 0; i < 6; i++) {
+        std::array<double, 6> plus = values, minus = values;
+        plus[i] += jacobian_step;
+        minus[i] -= jacobian_step;
+        const Eigen::Matrix4d forward_plus = chain_transform(robot, plus), forward_minus = chain_transform(robot, minus);
+        numeric.col(i).head<3>() = (forward_plus * tip_position.homogeneous() - forward_minus * tip_position.homogeneous()).head<3>() / (2.0 * jacobian_step);
+        const Eigen::Matrix3d skew = (forward_plus.block<3,3>(0,0) - forward_minus.block<3,3>(0,0)) / (2.0 * jacobian_step) * rotation.transpose();
+        numeric.col(i).tail<3>() = Eigen::Vector3d(skew(2, 1) - skew(1, 2), skew(0, 2) - skew(2, 0), skew(1, 0) - skew(0, 1)) / 2.0;
+    }
+    return (analytic - numeric).cwiseAbs().maxCoeff();
+}
+
+// times one way of computing the chain over every configuration, the sum of translations keeps the compiler from dropping the work
+template <typename Compute> static double time_nanoseconds(const std::vector<std::array<float, 6>>& configurations, Compute compute) {
+    double checksum = 0.0;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto& joint_values : configurations)
+        checksum += compute(joint_values).sum();
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (checksum == 42.0)
+        std::printf(" ");
+    return seconds * 1e9 / configurations.size();
+}
+
+#pragma region main
+// kinematic_bench                      -> 1,000,000 random configurations of the demo arm, linear then rotary base
+// kinematic_bench --configs 100000    -> that many configurations
+// kinematic_bench --seed 7            -> another set of configurations
+// per base: ns per forward kinematics for the 4×4 reference, the runtime dispatched chain_transform and the Chain spelled out at compile time,
+// then how many of the results differ from the reference at all (0 = bit for bit identical) and the largest difference,
+// then ns per configuration of the batched float kernel across every core and how far its tips land from the double chain's,
+// then the largest gap between geometric_jacobian and central differences of the chain on every 101st configuration,
+// the exit code is 1 when that gap is over jacobian_tolerance
+int main(int argc, char** argv) {
+    int configuration_count = 1000000;
+    uint32_t seed = 1234;
+    try {
+        for (int argument = 1; argument < argc; argument++) {
+            std::string option = argv[argument];
+            if (argument + 1 >= argc)
+                throw std::runtime_error(option + " needs a value");
+            std::string value = argv[++argument];
+            if (option == "--configs")
+                configuration_count = std::stoi(value);
+            else if (option == "--seed")
+                seed = (uint32_t)std::stoul(value);
+            else
+                throw std::runtime_error("unknown option " + option);
+        }
+        if (configuration_count <= 0)
+            throw std::runtime_error("--configs needs a positive count");
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+
+    std::minstd_rand random(seed);
+    std::uniform_real_distribution<float> joint(-PI, PI);
+    std::vector<std::array<float, 6>> configurations(configuration_count);
+    for (auto& joint_values : configurations)
+        for (float& value : joint_values)
+            value = joint(random);
+
+    // the same configurations as structure of arrays for the batched float kernel
+    JointBatch batch;
+    for (int i = 0; i < 6; i++) {
+        batch.joints[i].resize(configuration_count);
+        for (int c = 0; c < configuration_count; c++)
+            batch.joints[i][c] = configurations[c][i];
+    }
+    PoseBatch poses;
+    const Target tip_target = {Eigen::Vector3d(0, 1.5, 0), Eigen::Vector3d(0, 0, 1), 0.0};
+
+    std::printf("%-7s %12s %12s %12s %9s %10s %12s %10s %12s %14s\n", "base", "4x4 ns", "dispatch ns", "chain ns", "speedup", "differ", "max diff",
+                "batch ns", "batch diff", "jacobian diff");
+    bool jacobian_failed = false;
+    for (bool linear_base : {true, false}) {
+        const Robot robot = demo_robot(linear_base);
+        using LinearBase = Chain<Axis::Kind::Linear, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary>;
+        using RotaryBase = Chain<Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary, Axis::Kind::Rotary>;
+        auto compile_time = [&](const std::array<float, 6>& joint_values) {
+            return linear_base ? LinearBase::transform(robot, joint_values) : RotaryBase::transform(robot, joint_values);
+        };
+        const double reference_ns = time_nanoseconds(configurations, [&](const auto& joint_values) { return reference_transform(robot, joint_values); });
+        const double dispatch_ns = time_nanoseconds(configurations, [&](const auto& joint_values) { return chain_transform(robot, joint_values); });
+        const double chain_ns = time_nanoseconds(configurations, [&](const auto& joint_values) { return compile_time(joint_values); });
+
+        long long differing = 0;
+        double max_difference = 0.0;
+        for (const auto& joint_values : configurations) {
+            const Eigen::Matrix4d difference = chain_transform(robot, joint_values) - reference_transform(robot, joint_values);
+            const double largest = difference.cwiseAbs().maxCoeff();
+            differing += largest != 0.0;
+            max_difference = std::max(max_difference, largest);
+        }
+
+        // batched floats trade exactness for 8 configurations per register and every core, checked against the double chain on a sample
+        forward_batch(robot, tip_target, batch, poses); // first touch of the outputs
+        const auto batch_start = std::chrono::steady_clock::now();
+        forward_batch(robot, tip_target, batch, poses);
+        const double batch_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - batch_start).count() / configuration_count;
+        double batch_difference = 0.0;
+        for (int c = 0; c < configuration_count; c += 101) {
+            const Target tip = forward(robot, tip_target, configurations[c]);
+            batch_difference = std::max(batch_difference, (tip.position - Eigen::Vector3d(poses.x[c], poses.y[c], poses.z[c])).norm());
+        }
+        double jacobian_gap = 0.0;
+        for (int c = 0; c < configuration_count; c += 101)
+            jacobian_gap = std::max(jacobian_gap, jacobian_difference(robot, tip_target.position, configurations[c]));
+        jacobian_failed |= !(jacobian_gap <= jacobian_tolerance);
+        std::printf("%-7s %12.1f %12.1f %12.1f %8.2fx %10lld %12.3g %10.1f %12.3g %14.3g\n", linear_base ? "linear" : "rotary", reference_ns, dispatch_ns,
+                    chain_ns, reference_ns / chain_ns, differing, max_difference, batch_ns, batch_difference, jacobian_gap);
+    }
+    if (jacobian_failed) {
+        std::cerr << "Benchmark failed: geometric_jacobian is off from finite differences by more than " << jacobian_tolerance << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#include "kinematic.hpp"
+
+#pragma region collision utils
+// closest points between segments p1-q1 and p2-q2 as squared distance (Ericson, Real-Time Collision Detection 5.1.9):
+// the closest pair minimizes |p1 + s·d1 - p2 - t·d2|² over s, t in [0, 1], solved for s with t free, clamped, then t recomputed for
+// that s and clamped, then s once more for that t, degenerate segments (points) fall back to point-segment
+// ex: two parallel segments 1 apart side by side -> 1, two segments crossing like an X 0.5 apart -> 0.25
+static double segment_segment_squared(const Eigen::Vector3d& p1, const Eigen::Vector3d& q1, const Eigen::Vector3d& p2, const Eigen::Vector3d& q2) {
+    constexpr double epsilon = 1e-12;
+    const Eigen::Vector3d d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    const double a = d1.squaredNorm(), e = d2.squaredNorm(), f = d2.dot(r);
+    double s = 0.0, t = 0.0;
+    if (a <= epsilon && e <= epsilon)
+        return r.squaredNorm();
+    if (a <= epsilon) {
+        t = std::clamp(f / e, 0.0, 1.0);
+    } else {
+        const double c = d1.dot(r);
+        if (e <= epsilon) {
+            s = std::clamp(-c / a, 0.0, 1.0);
+        } else {
+            const double b = d1.dot(d2), denominator = a * e - b * b;
+            // parallel segments (denominator 0) have a whole range of closest pairs, any s works, take the start
+            s = denominator > epsilon ? std::clamp((b * f - c * e) / denominator, 0.0, 1.0) : 0.0;
+            t = (b * s + f) / e;
+            if (t < 0.0) {
+                t = 0.0;
+                s = std::clamp(-c / a, 0.0, 1.0);
+            } else if (t > 1.0) {
+                t = 1.0;
+                s = std::clamp((b - c) / a, 0.0, 1.0);
+            }
+        }
+    }
+    return (p1 + d1 * s - p2 - d2 * t).squaredNorm();
+}
+
+// squared distance from a point to the box [-half, half], 0 inside: clamp to the box and measure what was clamped away
+static double point_box_squared(const Eigen::Vector3d& point, const Eigen::Vector3d& half) {
+    return (point - point.cwiseMax(-half).cwiseMin(half)).squaredNorm();
+}
+
+// whether segment p-q crosses the box [-half, half] (slab test: clip the segment's parameter range against each pair of parallel faces,
+// anything left over is inside all three slabs at once = inside the box)
+static bool segment_hits_box(const Eigen::Vector3d& p, const Eigen::Vector3d& q, const Eigen::Vector3d& half) {
+    const Eigen::Vector3d d = q - p;
+    double enter = 0.0, leave = 1.0;
+    for (int k = 0; k < 3; k++) {
+        if (std::abs(d[k]) < 1e-12) {
+            if (std::abs(p[k]) > half[k])
+                return false;
+            continue;
+        }
+        double t0 = (-half[k] - p[k]) / d[k], t1 = (half[k] - p[k]) / d[k];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        enter = std::max(enter, t0);
+        leave = std::min(leave, t1);
+        if (enter > leave)
+            return false;
+    }
+    return true;
+}
+
+// bounding sphere of a capsule, the broad phase's cheap first look at a pair of links
+static double capsule_bound(const Capsule& capsule) {
+    return 0.5 * (capsule.b - capsule.a).norm() + capsule.radius;
+}
+
+// segment p-q already in the box's space, a lower bound of its distance to the box [-half, half]: the widest gap between the segment's
+// extent and the box's along any one of the box's axes, cheap and tight against the floor where a sphere around a 100-wide slab says nothing
+static double box_gap(const Eigen::Vector3d& p, const Eigen::Vector3d& q, const Eigen::Vector3d& half) {
+    const Eigen::Vector3d low = p.cwiseMin(q), high = p.cwiseMax(q);
+    return std::max((low - half).maxCoeff(), (-half - high).maxCoeff());
+}
+
+// exact distance of segment p-q in the box's space, see capsule_box_distance
+static double segment_box_distance(const Eigen::Vector3d& p, const Eigen::Vector3d& q, const Eigen::Vector3d& half) {
+    if (segment_hits_box(p, q, half))
+        return 0.0;
+    double squared = std::min(point_box_squared(p, half), point_box_squared(q, half));
+    for (int k = 0; k < 3; k++) {
+        const int u = (k + 1) % 3, v = (k + 2) % 3;
+        for (int corner = 0; corner < 4; corner++) {
+            Eigen::Vector3d start, end;
+            start[u] = end[u] = corner & 1 ? half[u] : -half[u];
+            start[v] = end[v] = corner & 2 ? half[v] : -half[v];
+            start[k] = -half[k];
+            end[k] = half[k];
+            squared = std::min(squared, segment_segment_squared(p, q, start, end));
+        }
+    }
+    return std::sqrt(squared);
+}
+
+#pragma region collision
+// the segments' gap minus both radii
+double capsule_distance(const Capsule& first, const Capsule& second) {
+    return std::sqrt(segment_segment_squared(first.a, first.b, second.a, second.b)) - first.radius - second.radius;
+}
+
+// in the box's own space the box is [-half, half], and a segment that doesn't cross it is closest to it at one of its endpoints
+// or against one of the 12 edges (a segment closest to the inside of a face is parallel to it, and then an endpoint or the face's edge
+// is as close), so the exact distance is the smallest of 2 point-box and 12 segment-segment distances,
+// a segment crossing the box is 0 away, the capsule counts as overlapping by its radius
+double capsule_box_distance(const Capsule& capsule, const Box& box) {
+    const Eigen::Vector3d p = box.rotation.transpose() * (capsule.a - box.center), q = box.rotation.transpose() * (capsule.b - box.center);
+    return segment_box_distance(p, q, box.half_size) - capsule.radius;
+}
+
+// broad phase then exact distances:
+// - link pairs next to each other in the chain share a joint and always touch there, they are never tested,
+// - link 0 is the one mounted on the floor, it isn't tested against the scene,
+// - a pair of links whose bounding spheres are farther apart than the clearance can't collide and skips the exact test,
+//   a link and a box the same when the gap along one of the box's axes is already wider
+CollisionReport check_collision(const Robot& robot, const LinkFrames& frames, const CollisionScene& scene, bool first_hit) {
+    CollisionReport report;
+    std::array<Capsule, 6> capsules;
+    std::array<Eigen::Vector3d, 6> centers;
+    std::array<double, 6> bounds;
+    for (int i = 0; i < 6; i++) {
+        const Axis& axis = robot.axes[i];
+        capsules[i] = {(frames[i] * axis.segmentA.homogeneous()).head<3>(), (frames[i] * axis.segmentB.homogeneous()).head<3>(), axis.radius};
+        centers[i] = 0.5 * (capsules[i].a + capsules[i].b);
+        bounds[i] = capsule_bound(capsules[i]);
+    }
+    auto record = [&](double distance, int first, int second) {
+        report.distance = std::min(report.distance, distance);
+        if (distance > scene.clearance)
+            return false;
+        report.colliding = true;
+        report.links[first] = true;
+        if (second >= 0)
+            report.links[second] = true;
+        return first_hit;
+    };
+
+    for (int i = 0; i < 6; i++) {
+        if (robot.axes[i].radius <= 0.0)
+            continue;
+        for (int j = i + 2; j < 6; j++) {
+            if (robot.axes[j].radius <= 0.0 || (centers[i] - centers[j]).norm() - bounds[i] - bounds[j] > scene.clearance)
+                continue;
+            if (record(capsule_distance(capsules[i], capsules[j]), i, j))
+                return report;
+        }
+        if (i == 0)
+            continue;
+        for (const Box& box : scene.obstacles) {
+            const Eigen::Vector3d p = box.rotation.transpose() * (capsules[i].a - box.center), q = box.rotation.transpose() * (capsules[i].b - box.center);
+            if (box_gap(p, q, box.half_size) - capsules[i].radius > scene.clearance)
+                continue;
+            if (record(segment_box_distance(p, q, box.half_size) - capsules[i].radius, i, -1))
+                return report;
+        }
+    }
+    return report;
+}
+
+// each configuration's frames straight from the specialized chain links, then the checks stopping at the first hit,
+// contiguous runs of configurations per thread like forward_batch
+void check_collision_batch(const Robot& robot, const JointBatch& batch, const CollisionScene& scene, std::vector<uint8_t>& colliding) {
+    const size_t count = batch.joints[0].size();
+    colliding.resize(count);
+    auto check_range = [&](size_t begin, size_t end) {
+        LinkFrames frames;
+        std::array<float, 6> joint_values;
+        for (size_t c = begin; c < end; c++) {
+            for (int i = 0; i < 6; i++)
+                joint_values[i] = batch.joints[i][c];
+            update_link_frames(robot, joint_values, frames);
+            colliding[c] = check_collision(robot, frames, scene, true).colliding;
+        }
+    };
+    const int thread_count = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(count / 1024, 1));
+    if (thread_count == 1) {
+        check_range(0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int thread_id = 0; thread_id < thread_count; thread_id++)
+        workers.emplace_back(check_range, count * thread_id / thread_count, count * (thread_id + 1) / thread_count);
+    for (auto& worker : workers)
+        worker.join();
+}
@@ -0,0 +1,145 @@
+#include "kinematic.hpp"
+
+#pragma region controller utils
+// latencies are binned per microsecond up to 10 ms, anything later lands in the last bin (the maximum is kept exactly on the side),
+// a tick only increments a counter, percentiles are read off the cumulative counts now and then
+constexpr size_t latency_bins = 10000;
+
+struct LatencyHistogram {
+    std::vector<uint32_t> counts = std::vector<uint32_t>(latency_bins, 0);
+    long long total = 0;
+    double maximum = 0.0;
+};
+
+static void record(LatencyHistogram& histogram, double microseconds) {
+    histogram.counts[std::min((size_t)std::max(microseconds, 0.0), latency_bins - 1)]++;
+    histogram.total++;
+    histogram.maximum = std::max(histogram.maximum, microseconds);
+}
+
+// each percentile is the first bin whose cumulative count reaches its share of the ticks, reported at the bin's middle
+static LatencyStatistics statistics(const LatencyHistogram& histogram) {
+    LatencyStatistics result;
+    result.maximum = histogram.maximum;
+    const std::array<double, 3> shares = {0.5, 0.99, 0.999};
+    std::array<double*, 3> values = {&result.p50, &result.p99, &result.p999};
+    long long cumulative = 0;
+    size_t next = 0;
+    for (size_t bin = 0; bin < latency_bins && next < shares.size(); bin++) {
+        cumulative += histogram.counts[bin];
+        while (next < shares.size() && cumulative >= shares[next] * histogram.total && cumulative > 0)
+            *values[next++] = bin + 0.5;
+    }
+    return result;
+}
+
+// one joint towards its target within its limits, the velocity heads for the fastest one from which the joint can still brake
+// to a stop on the target (v² = 2·a·distance) but changes by at most the acceleration per tick,
+// once within a tick's braking of the target at a crawl it lands on it so it doesn't dither around it
+// ex: 1 rad away at rest, limits 1.5 rad/s, 3 rad/s² -> speeds up for 0.5 s, cruises, brakes over the last 0.375 rad
+static void step_joint(float& position, float& velocity, float target, const Axis& axis, double period) {
+    const double error = target - position, change = axis.max_acceleration * period;
+    if (std::abs(error) <= change * period && std::abs(velocity) <= change) {
+        position = target;
+        velocity = 0.f;
+        return;
+    }
+    const double desired = std::copysign(std::min(axis.max_velocity, std::sqrt(2.0 * axis.max_acceleration * std::abs(error))), error);
+    velocity = (float)(velocity + std::clamp(desired - velocity, -change, change));
+    position = (float)std::clamp(position + velocity * period, axis.minimum, axis.maximum);
+}
+
+// the thread's body, one tick: the newest setpoint waiting (older ones are stale by now, they're only counted), solved into joint
+// targets when Cartesian (warm started from the previous targets, a couple of IK iterations for a goal that moved a frame's worth),
+// then every joint one step closer
+static void run_tick(Controller& controller, ControllerSnapshot& state) {
+    Setpoint setpoint, latest;
+    bool received = false;
+    while (controller.setpoints.pop(setpoint)) {
+        latest = setpoint;
+        received = true;
+        state.setpoints++;
+    }
+    if (received) {
+        if (latest.kind == Setpoint::Kind::Cartesian) {
+            const IkResult ik = inverse(controller.robot, controller.tip_target, latest.goal, state.target_values, controller.options.ik);
+            state.target_values = ik.joint_values;
+            state.reachable = ik.converged;
+        } else {
+            for (int i = 0; i < 6; i++)
+                state.target_values[i] = std::clamp(latest.joint_values[i], (float)controller.robot.axes[i].minimum, (float)controller.robot.axes[i].maximum);
+        }
+    }
+    for (int i = 0; i < 6; i++)
+        step_joint(state.joint_values[i], state.joint_velocities[i], state.target_values[i], controller.robot.axes[i], controller.options.period);
+}
+
+// fixed rate against a steady clock like the sonar simulation, but a controller doesn't catch up: a tick that comes a period late
+// or more skips the ones it missed (counted as overruns) instead of running them back to back with stale timing,
+// the latency statistics are refreshed every 100 ticks outside the measured work
+static void run_controller(Controller& controller, ControllerSnapshot state) {
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(controller.options.period));
+    const auto spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(controller.options.spin));
+    LatencyHistogram wake_latency, tick_time;
+    auto next = Clock::now() + period;
+
+    while (controller.running.load(std::memory_order_relaxed)) {
+        if (spin.count() > 0) {
+            std::this_thread::sleep_until(next - spin);
+            while (Clock::now() < next)
+                _mm_pause();
+        } else {
+            std::this_thread::sleep_until(next);
+        }
+        const auto woke = Clock::now();
+        const auto late = woke - next;
+        record(wake_latency, std::chrono::duration<double, std::micro>(late).count());
+        if (late >= period) {
+            const long long missed = late / period;
+            state.overruns += missed;
+            next += missed * period;
+        }
+
+        run_tick(controller, state);
+        state.tick++;
+        record(tick_time, std::chrono::duration<double, std::micro>(Clock::now() - woke).count());
+        if (state.tick % 100 == 0) {
+            state.wake_latency = statistics(wake_latency);
+            state.tick_time = statistics(tick_time);
+        }
+        controller.snapshots.write() = state;
+        controller.snapshots.publish();
+        next += period;
+    }
+}
+
+#pragma region controller
+void start_controller(Controller& controller, const Robot& robot, const Target& tip_target, const std::array<float, 6>& joint_values,
+                      const ControllerOptions& options) {
+    if (controller.running.load())
+        throw std::runtime_error("start_controller on a controller already running");
+    if (options.period <= 0.0)
+        throw std::runtime_error("start_controller needs a positive period");
+    controller.robot = robot;
+    controller.tip_target = tip_target;
+    controller.options = options;
+    // the first snapshot is the start itself, readable before the first tick
+    ControllerSnapshot first;
+    for (int i = 0; i < 6; i++)
+        first.joint_values[i] = first.target_values[i] = std::clamp(joint_values[i], (float)robot.axes[i].minimum, (float)robot.axes[i].maximum);
+    controller.snapshots.write() = first;
+    controller.snapshots.publish();
+    controller.running = true;
+    controller.thread = std::thread(run_controller, std::ref(controller), first);
+}
+
+void stop_controller(Controller& controller) {
+    controller.running = false;
+    if (controller.thread.joinable())
+        controller.thread.join();
+}
+
+Controller::~Controller() {
+    stop_controller(*this);
+}
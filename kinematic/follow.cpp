@@ -0,0 +1,140 @@
+#include "kinematic.hpp"
+
+#pragma region follow utils
+// a point of the stream as a goal in robot space, the orientation turns with the path but isn't scaled
+static Target path_goal(const PathOptions& options, const Eigen::Vector3d& point, const Eigen::Vector3d& orientation) {
+    Target goal;
+    goal.position = (options.path_to_robot * point.homogeneous()).head<3>();
+    goal.align = (options.path_to_robot.block<3,3>(0,0) * orientation).normalized();
+    goal.roll = options.roll;
+    return goal;
+}
+
+static double joint_distance(const std::array<float, 6>& first, const std::array<float, 6>& second) {
+    double sum = 0.0;
+    for (int i = 0; i < 6; i++)
+        sum += (double)(first[i] - second[i]) * (first[i] - second[i]);
+    return std::sqrt(sum);
+}
+
+// the first point decides which branch the whole path stays on, from start_values IK may not get there at all (stuck against a limit
+// or in a local minimum of the error, ex: the demo arm straight up and a point below its shoulder), so when it doesn't it restarts from
+// configurations spread within the limits and keeps the solution closest to start_values
+static std::array<float, 6> first_joints(const Robot& robot, const Target& tip_target, const Target& goal, const std::array<float, 6>& start_values,
+                                         const IkOptions& ik_options) {
+    constexpr int restarts = 32;
+    IkOptions options = ik_options;
+    options.max_iterations = std::max(options.max_iterations, 64);
+    IkResult best = inverse(robot, tip_target, goal, start_values, options);
+    if (best.converged)
+        return best.joint_values;
+    std::minstd_rand random(1);
+    double best_distance = std::numeric_limits<double>::infinity();
+    for (int restart = 0; restart < restarts; restart++) {
+        std::array<float, 6> seed;
+        for (int i = 0; i < 6; i++)
+            seed[i] = std::uniform_real_distribution<float>((float)robot.axes[i].minimum, (float)robot.axes[i].maximum)(random);
+        const IkResult ik = inverse(robot, tip_target, goal, seed, options);
+        if (ik.converged && joint_distance(ik.joint_values, start_values) < best_distance) {
+            best = ik;
+            best_distance = joint_distance(ik.joint_values, start_values);
+        }
+    }
+    return best.joint_values;
+}
+
+// runs of consecutive flagged points
+static std::vector<PathSpan> spans(const std::vector<uint8_t>& flags) {
+    std::vector<PathSpan> result;
+    for (size_t k = 0; k < flags.size(); k++) {
+        if (!flags[k])
+            continue;
+        if (!result.empty() && result.back().first + result.back().count == k)
+            result.back().count++;
+        else
+            result.push_back({k, 1});
+    }
+    return result;
+}
+
+#pragma region follow
+// every point solved from the previous point's joints, so the arm keeps the same configuration all along (elbow up stays up)
+// and a point next to the last one converges in an iteration or none at all,
+// long paths are split into one contiguous range per core, which needs each range's starting joints before the one before it is solved:
+// a first pass walks the path every seed_spacing points with the same warm starts (a 64th of the work) and keeps the joints at the range
+// starts, each range then starts from those and lands on the same branch its predecessor would have handed it,
+// unreachable points keep going from the closest pose found, singular stretches are read off the joints afterwards in one pass
+// ex: a million point spiral at 7 µm spacing -> most points are within tolerance of the last joints already and cost one pose evaluation
+PathFollowing follow_path(const Robot& robot, const Target& tip_target, const std::vector<Eigen::Vector3d>& points,
+                          const std::vector<Eigen::Vector3d>& orientation, const std::array<float, 6>& start_values, const PathOptions& options) {
+    if (points.size() != orientation.size())
+        throw std::runtime_error("follow_path needs one orientation per point, got " + std::to_string(points.size()) + " points and "
+                                 + std::to_string(orientation.size()) + " orientations");
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = points.size();
+    PathFollowing result;
+    result.joint_values.resize(count);
+    result.unreachable.assign(count, 0);
+    result.singular.assign(count, 0);
+
+    const size_t spacing = std::max<size_t>(options.seed_spacing, 1);
+    const int thread_count = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(count / (spacing * 256), 1));
+    // range boundaries on multiples of the spacing so the seed pass lands exactly on them
+    std::vector<size_t> boundaries(thread_count + 1);
+    for (int thread_id = 0; thread_id <= thread_count; thread_id++)
+        boundaries[thread_id] = std::min(count, (count / spacing) * thread_id / thread_count * spacing);
+    boundaries[thread_count] = count;
+    std::vector<std::array<float, 6>> seeds(thread_count);
+    if (count > 0)
+        seeds[0] = first_joints(robot, tip_target, path_goal(options, points[0], orientation[0]), start_values, options.ik);
+    if (thread_count > 1) {
+        std::array<float, 6> joints = seeds[0];
+        int next = 1;
+        for (size_t k = 0; k < count && next < thread_count; k += spacing) {
+            joints = inverse(robot, tip_target, path_goal(options, points[k], orientation[k]), joints, options.ik).joint_values;
+            while (next < thread_count && boundaries[next] == k)
+                seeds[next++] = joints;
+        }
+    }
+
+    std::vector<long long> iterations(thread_count, 0);
+    auto follow_range = [&](int thread_id) {
+        std::array<float, 6> joints = seeds[thread_id];
+        for (size_t k = boundaries[thread_id]; k < boundaries[thread_id + 1]; k++) {
+            const IkResult ik = inverse(robot, tip_target, path_goal(options, points[k], orientation[k]), joints, options.ik);
+            joints = ik.joint_values;
+            result.joint_values[k] = joints;
+            result.unreachable[k] = !ik.converged;
+            iterations[thread_id] += ik.iterations;
+        }
+    };
+    if (thread_count == 1) {
+        follow_range(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int thread_id = 0; thread_id < thread_count; thread_id++)
+            workers.emplace_back(follow_range, thread_id);
+        for (auto& worker : workers)
+            worker.join();
+    }
+    result.iterations = std::accumulate(iterations.begin(), iterations.end(), 0LL);
+
+    // tip motion (distance + the align's turn in radians, near enough for small steps) against joint motion, window by window
+    const double scale = std::cbrt(std::abs(options.path_to_robot.block<3,3>(0,0).determinant()));
+    size_t window_start = 0;
+    double tip_motion = 0.0, joint_motion = 0.0;
+    for (size_t k = 1; k < count; k++) {
+        tip_motion += scale * (points[k] - points[k - 1]).norm() + (orientation[k].normalized() - orientation[k - 1].normalized()).norm();
+        joint_motion += joint_distance(result.joint_values[k], result.joint_values[k - 1]);
+        if (tip_motion < options.singular_window && k + 1 < count)
+            continue;
+        if (joint_motion > options.max_joint_ratio * std::max(tip_motion, options.singular_window))
+            std::fill(result.singular.begin() + window_start, result.singular.begin() + k + 1, 1);
+        window_start = k;
+        tip_motion = joint_motion = 0.0;
+    }
+    result.unreachable_spans = spans(result.unreachable);
+    result.singular_spans = spans(result.singular);
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
@@ -0,0 +1,28 @@
+#include "kinematic.hpp"
+
+#pragma region frames
+// finds the first link whose inputs changed since the frames were computed and recomputes from there on:
+// a new base transform or a toggled axis kind redoes everything from that link, a moved joint from its own link,
+// the draw, the tip and the Jacobian of a frame then all read the same frames
+void update_kinematic_state(KinematicState& state, const Robot& robot, const std::array<float, 6>& joint_values) {
+    int first = 6;
+    if (!state.valid || state.base != robot.transform)
+        first = 0;
+    for (int i = 0; i < first; i++)
+        if (state.kinds[i] != robot.axes[i].kind || state.joint_values[i] != joint_values[i])
+            first = i;
+    state.recomputed_links = 6 - first;
+    if (first == 6)
+        return;
+    update_link_frames(robot, joint_values, state.frames, first);
+    state.joint_values = joint_values;
+    for (int i = 0; i < 6; i++)
+        state.kinds[i] = robot.axes[i].kind;
+    state.base = robot.transform;
+    state.valid = true;
+}
+
+// the tip_target carried by the last frame, exactly what forward() gives for the same joints (same links, same order)
+Target forward(const KinematicState& state, const Target& tip_target) {
+    return transform_target(state.frames[5], tip_target);
+}
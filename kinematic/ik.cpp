@@ -0,0 +1,110 @@
+#include "kinematic.hpp"
+
+#pragma region ik utils
+// damping bounds: below the minimum steps are plain Gauss-Newton anyway, above the maximum the steps are too small to ever arrive,
+// the goal is out of reach or behind a limit and we keep the closest pose found
+constexpr double minimum_damping = 1e-6;
+constexpr double maximum_damping = 1e3;
+
+using Joints = std::array<double, 6>;
+using Vector6d = Eigen::Matrix<double, 6, 1>;
+using Matrix6d = Eigen::Matrix<double, 6, 6>;
+
+struct Pose {
+    Eigen::Vector3d position;
+    Eigen::Quaterniond orientation;
+};
+
+// where the tip sits for the given joints, tip_orientation is tip_target's align + roll as a quaternion, built once per solve
+static Pose tip_pose(const Robot& robot, const Eigen::Vector3d& tip_position, const Eigen::Quaterniond& tip_orientation, const Joints& joints) {
+    const Eigen::Matrix4d transform = chain_transform(robot, joints);
+    return {(transform * tip_position.homogeneous()).head<3>(), Eigen::Quaterniond(Eigen::Matrix3d(transform.block<3,3>(0,0))) * tip_orientation};
+}
+
+// how far current is from goal as one 6D vector: position difference on top, rotation vector (axis × angle) below
+// ex: goal 0.1 higher and turned 0.2 rad around Z -> (0, 0.1, 0, 0, 0, 0.2)
+static Vector6d pose_error(const Pose& goal, const Pose& current) {
+    Vector6d error;
+    error.head<3>() = goal.position - current.position;
+    Eigen::Quaterniond delta = goal.orientation * current.orientation.inverse();
+    // q and -q are the same rotation, the one with a positive w is the short way around (angle <= 180°)
+    if (delta.w() < 0)
+        delta.coeffs() = -delta.coeffs();
+    const Eigen::AngleAxisd angle_axis(delta);
+    error.tail<3>() = angle_axis.axis() * angle_axis.angle();
+    return error;
+}
+
+// damped least squares: the joint step that best explains the error while keeping the step itself small,
+// Δq = Jᵀ (J Jᵀ + λ² I)⁻¹ e, λ = 0 would be the plain pseudo-inverse which explodes next to a singularity (arm stretched straight,
+// two axes lined up) where a tiny tip motion needs huge joint motion, λ trades a bit of accuracy there for steps that stay sane
+static Vector6d damped_step(const Jacobian& jacobian, const Vector6d& error, double damping) {
+    const Matrix6d normal = jacobian * jacobian.transpose() + damping * damping * Matrix6d::Identity();
+    return jacobian.transpose() * normal.ldlt().solve(error);
+}
+
+#pragma region ik
+// Levenberg-Marquardt around the damped least squares step, warm started from start_values (the current joints, so a goal that moved
+// a little since last frame is a couple of iterations away): a step that lowers the error is kept and λ halves (trust the linear model more),
+// one that doesn't is thrown away and λ quadruples (shorter, more gradient-like step) until it helps,
+// joints stay inside their limits: steps are clamped, and a joint already pinned at a limit and pushed further out is dropped from the solve
+// so the others make up for it instead of the step being wasted against the stop,
+// everything is fixed-size on the stack, no allocation, a converging solve is a handful of iterations of 2 chain evaluations (the pose and
+// the analytic Jacobian) + one 6×6 LDLT,
+// unreachable goals end when λ saturates and return the closest pose found with converged = false
+IkResult inverse(const Robot& robot, const Target& tip_target, const Target& goal, const std::array<float, 6>& start_values, const IkOptions& options) {
+    const Eigen::Vector3d& tip_position = tip_target.position;
+    const Eigen::Quaterniond tip_orientation = fromAlignRoll(tip_target.align, tip_target.roll);
+    const Pose goal_pose = {goal.position, fromAlignRoll(goal.align, goal.roll)};
+
+    Joints joints;
+    for (int i = 0; i < 6; i++)
+        joints[i] = std::clamp((double)start_values[i], robot.axes[i].minimum, robot.axes[i].maximum);
+    Pose pose = tip_pose(robot, tip_position, tip_orientation, joints);
+    Vector6d error = pose_error(goal_pose, pose);
+    auto converged = [&](const Vector6d& e) { return e.head<3>().norm() <= options.position_tolerance && e.tail<3>().norm() <= options.angle_tolerance; };
+
+    IkResult result;
+    double damping = options.damping;
+    // only changes when a step is kept, a rejected step retries from the same joints with more damping,
+    // not even computed when the start is already there (a path point next to the last one often is)
+    Jacobian current_jacobian;
+    if (!converged(error))
+        current_jacobian = geometric_jacobian(robot, tip_position, joints);
+    while (!converged(error) && result.iterations < options.max_iterations && damping < maximum_damping) {
+        result.iterations++;
+        Jacobian jacobian = current_jacobian;
+        Vector6d step = damped_step(jacobian, error, damping);
+        bool pinned = false;
+        for (int i = 0; i < 6; i++) {
+            if ((joints[i] <= robot.axes[i].minimum && step[i] < 0) || (joints[i] >= robot.axes[i].maximum && step[i] > 0)) {
+                jacobian.col(i).setZero();
+                pinned = true;
+            }
+        }
+        if (pinned)
+            step = damped_step(jacobian, error, damping);
+
+        Joints candidate;
+        for (int i = 0; i < 6; i++)
+            candidate[i] = std::clamp(joints[i] + step[i], robot.axes[i].minimum, robot.axes[i].maximum);
+        const Pose candidate_pose = tip_pose(robot, tip_position, tip_orientation, candidate);
+        const Vector6d candidate_error = pose_error(goal_pose, candidate_pose);
+        if (candidate_error.squaredNorm() < error.squaredNorm()) {
+            joints = candidate;
+            pose = candidate_pose;
+            error = candidate_error;
+            current_jacobian = geometric_jacobian(robot, tip_position, joints);
+            damping = std::max(damping * 0.5, minimum_damping);
+        } else {
+            damping *= 4.0;
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+        result.joint_values[i] = (float)joints[i];
+    result.converged = converged(error);
+    result.position_error = error.head<3>().norm();
+    result.angle_error = error.tail<3>().norm();
+    return result;
+}
@@ -0,0 +1,45 @@
+#include "kinematic.hpp"
+
+#pragma region jacobian
+// reads every joint off its link frame, the frame after the joint moved: a joint's motion leaves its own axis where it was
+// (a rotary spins around it, a linear slides along it) so frame i says where joint i sits and which way it works as well as the one before:
+// - rotary: spins around axis z = R · pivotNormal through the frame's origin o, the tip at p sweeps z × (p - o) per radian, and turns by z
+//   ex: z = Y, tip 2 units away along X -> the tip moves 2 units along -Z per radian and turns around Y
+// - linear: slides along its local x turned into base space, d = R · X, the tip moves d per unit and doesn't turn
+// same twist convention as the IK's pose error (angular part in base space), so the two plug into each other
+Jacobian geometric_jacobian(const Robot& robot, const LinkFrames& frames, const Eigen::Vector3d& tip_position) {
+    const Eigen::Vector3d tip = (frames[5] * tip_position.homogeneous()).head<3>();
+    Jacobian jacobian;
+    for (int i = 0; i < 6; i++) {
+        const Eigen::Matrix3d rotation = frames[i].block<3,3>(0,0);
+        if (robot.axes[i].kind == Axis::Kind::Rotary) {
+            const Eigen::Vector3d direction = rotation * robot.axes[i].pivotNormal.normalized();
+            jacobian.col(i).head<3>() = direction.cross(tip - frames[i].block<3,1>(0,3));
+            jacobian.col(i).tail<3>() = direction;
+        } else {
+            jacobian.col(i).head<3>() = rotation.col(0);
+            jacobian.col(i).tail<3>().setZero();
+        }
+    }
+    return jacobian;
+}
+
+// one pass down the chain for the frames, then the above
+Jacobian geometric_jacobian(const Robot& robot, const Eigen::Vector3d& tip_position, const std::array<double, 6>& joint_values) {
+    LinkFrames frames;
+    update_link_frames(robot, joint_values, frames);
+    return geometric_jacobian(robot, frames, tip_position);
+}
+
+// both from one fixed-size SVD (no heap), σ come sorted largest first,
+// the rows mix units (position per radian on top, radians per radian below) so values compare between configurations of one arm,
+// not between arms of different sizes
+// ex: arm folded so two rotary axes line up -> one σ ≈ 0 -> manipulability ≈ 0, condition number huge
+Dexterity dexterity(const Jacobian& jacobian) {
+    const Eigen::JacobiSVD<Jacobian> svd(jacobian);
+    const Eigen::Matrix<double, 6, 1>& singular_values = svd.singularValues();
+    Dexterity result;
+    result.manipulability = singular_values.prod();
+    result.condition_number = singular_values[5] > 1e-12 ? singular_values[0] / singular_values[5] : std::numeric_limits<double>::infinity();
+    return result;
+}
@@ -1,10 +1,58 @@
 #include "kinematic.hpp"
+#include "toolpath/toolpath.hpp"
 
 struct State {
     Robot robot;
     std::array<float, 6> joint_values;
 
     Target target;
+    KinematicState kinematics;
+
+    // the floor and a pillar to bump into, links touching them or each other turn red
+    CollisionScene scene;
+    CollisionReport collision;
+
+    // IK mode: the six sliders move a goal pose (x, y, z, yaw, pitch, roll) and the joints follow it every frame
+    bool ik_enabled = false;
+    std::array<float, 6> goal_values;
+    Target goal;
+    IkResult ik;
+    double ik_microseconds = 0.0;
+
+    // reachability overlay, every voxel some sampled configuration put the tip in, red (few directions) to green (every direction)
+    bool show_workspace = false;
+    WorkspaceMap workspace;
+    double workspace_milliseconds = 0.0;
+
+    // motion planning: Save pose remembers the joints, Plan goes back there around the obstacles and plays the path
+    std::array<float, 6> saved_values;
+    bool has_saved = false;
+    bool planned = false;
+    PlanResult plan;
+    std::vector<Vector3> plan_trace; // where the tip goes along the path
+    // the path in time within the axes' velocity, acceleration and jerk limits, regenerated while the speed slider moves
+    float speed_scale = 1.f;
+    Trajectory trajectory;
+    std::vector<TrajectorySample> trajectory_samples; // for the velocity plot
+    double trajectory_microseconds = 0.0;
+    bool playing = false;
+    double played_time = 0.0;
+
+    // the toolpath demo's spiral (a million points) laid flat in front of the arm, the head pointing down onto it, followed by IK point
+    // by point then played at the feed rate, green where the arm gets there, red where it can't, yellow where it nears a singularity
+    bool followed = false;
+    bool following = false;
+    Output toolpath;
+    PathFollowing follow;
+    std::vector<std::pair<Vector3, Color>> follow_trace; // a few thousand points of the path for drawing
+    double toolpath_length = 0.0;
+    double followed_time = 0.0;
+    float feed_rate = 0.5f;
+
+    // the 1 kHz controller: while it runs the sliders, the IK goal and the playbacks only send it setpoints every frame,
+    // the arm drawn is the snapshot it last published, moving within the axes' velocity and acceleration limits
+    std::unique_ptr<Controller> controller;
+    ControllerSnapshot controller_snapshot;
 
     Camera3D camera;
 
@@ -12,6 +60,23 @@ struct State {
     float link_width = 0.7f;
 };
 
+// goal slider values to the goal pose, align is pointed by yaw (around Y, 0 = +Z) then pitch (up from the floor)
+// ex: yaw 0, pitch 0 -> align (0, 0, 1), yaw π/2, pitch 0 -> align (1, 0, 0), pitch π/2 -> align (0, 1, 0) whatever the yaw
+Target goal_from_values(const std::array<float, 6>& values) {
+    Target goal;
+    goal.position = Eigen::Vector3d(values[0], values[1], values[2]);
+    goal.align = Eigen::Vector3d(std::cos(values[4]) * std::sin(values[3]), std::sin(values[4]), std::cos(values[4]) * std::cos(values[3]));
+    goal.roll = values[5];
+    return goal;
+}
+
+// and back, so switching IK on starts from wherever the tip is and nothing jumps
+std::array<float, 6> values_from_target(const Target& target) {
+    Eigen::Vector3d align = target.align.normalized();
+    return {(float)target.position.x(), (float)target.position.y(), (float)target.position.z(),
+            (float)std::atan2(align.x(), align.z()), (float)std::asin(std::clamp(align.y(), -1.0, 1.0)), (float)target.roll};
+}
+
 State init_state() {
     State s;
     s.robot.transform = Eigen::Matrix4d::Identity();
@@ -27,7 +92,13 @@ State init_state() {
             s.robot.axes[i].pivotNormal = (i % 2 == 0) ? Eigen::Vector3d(1, 0, 0) : Eigen::Vector3d(0, 0, 1);
         }
         s.joint_values[i] = 0.f;
+        // every link's body is the capsule it's drawn as, from its pivot to the next one
+        s.robot.axes[i].segmentA = Eigen::Vector3d(0, 0, 0);
+        s.robot.axes[i].segmentB = Eigen::Vector3d(0, s.link_height, 0);
+        s.robot.axes[i].radius = s.link_width / 2.f;
     }
+    s.scene.obstacles.push_back({Eigen::Vector3d(0, -0.5, 0), Eigen::Vector3d(50, 0.5, 50)});
+    s.scene.obstacles.push_back({Eigen::Vector3d(3.5, 1.5, 2.5), Eigen::Vector3d(0.75, 1.5, 0.75)});
 
     s.target.position = Eigen::Vector3d(0, s.link_height, 0);
     s.target.align = Eigen::Vector3d(0, 0, 1);
@@ -44,7 +115,7 @@ State init_state() {
 
 void handle_mouse(State& s) {
     // manually handle panning, this time in all directions + mousewheel zoom
-    if (GetMousePosition().x > 240) {
+    if (GetMousePosition().x > 240 && GetMousePosition().x < 1040) {
         Vector3 pos = s.camera.position;
         Vector3 target = s.camera.target;
         Vector3 up  = s.camera.up;
@@ -61,37 +132,50 @@ void handle_mouse(State& s) {
 }
 
 void draw_3d(State& s) {
-    const Target target = forward(s.robot, s.target, s.joint_values);
+    // one set of link frames for the drawing, the tip and the dexterity readout, only recomputed from the first joint that moved
+    update_kinematic_state(s.kinematics, s.robot, s.controller ? s.controller_snapshot.joint_values : s.joint_values);
+    const Target target = forward(s.kinematics, s.target);
+    s.collision = check_collision(s.robot, s.kinematics.frames, s.scene);
 
     ClearBackground(DARKGRAY);
     BeginMode3D(s.camera);
         DrawGrid(20, 1.f);
-        rlPushMatrix();
-            float robot_space[16];
-            for(int i = 0; i < 16; i++)
-                robot_space[i] = (float)s.robot.transform.data()[i];
-            rlMultMatrixf(robot_space);
-            // in robot space, create the axes with each being in the previous' space for the kinematic chain
-            for (int i = 0; i < 6; i++) {
-                rlPushMatrix();
-                rlTranslatef(s.robot.axes[i].pivot.x(), s.robot.axes[i].pivot.y(), s.robot.axes[i].pivot.z());
-                // translate if linear, rotate along the pivotNormal if rotary, both using the joint_value, then draw
+        // each link drawn in its own frame straight from the cache, no rlgl translate/rotate chain redoing the kinematics
+        for (int i = 0; i < 6; i++) {
+            float link_space[16];
+            for (int j = 0; j < 16; j++)
+                link_space[j] = (float)s.kinematics.frames[i].data()[j];
+            rlPushMatrix();
+                rlMultMatrixf(link_space);
                 if (s.robot.axes[i].kind == Axis::Kind::Linear) {
-                    rlTranslatef(s.joint_values[i], 0, 0);
-                    DrawCube({0, s.link_height / 2.f, 0}, s.link_width, s.link_height, s.link_width, ColorAlpha(BLUE, 0.4f));
-                    DrawCubeWires({0, s.link_height / 2.f, 0}, s.link_width, s.link_height, s.link_width, BLUE);
+                    Color color = s.collision.links[i] ? RED : BLUE;
+                    DrawCube({0, s.link_height / 2.f, 0}, s.link_width, s.link_height, s.link_width, ColorAlpha(color, 0.4f));
+                    DrawCubeWires({0, s.link_height / 2.f, 0}, s.link_width, s.link_height, s.link_width, color);
                 } else {
-                    Vector3 axis_normal = {(float)s.robot.axes[i].pivotNormal.x(), (float)s.robot.axes[i].pivotNormal.y(), (float)s.robot.axes[i].pivotNormal.z()};
-                    rlRotatef(s.joint_values[i] * RAD2DEG, axis_normal.x, axis_normal.y, axis_normal.z);
-                    DrawCapsule({0, 0, 0}, {0, s.link_height, 0}, s.link_width / 2.f, 8, 8, ColorAlpha(PURPLE, 0.4f));
-                    DrawCapsuleWires({0, 0, 0}, {0, s.link_height, 0}, s.link_width / 2.f, 8, 8, PURPLE);
+                    Color color = s.collision.links[i] ? RED : PURPLE;
+                    DrawCapsule({0, 0, 0}, {0, s.link_height, 0}, s.link_width / 2.f, 8, 8, ColorAlpha(color, 0.4f));
+                    DrawCapsuleWires({0, 0, 0}, {0, s.link_height, 0}, s.link_width / 2.f, 8, 8, color);
                 }
-            }
-
-            for (int i = 0; i < 6; i++)
-                rlPopMatrix();
-        rlPopMatrix();
+            rlPopMatrix();
+        }
         
+        // obstacles, the first one is the floor the grid already shows
+        for (size_t i = 1; i < s.scene.obstacles.size(); i++) {
+            const Box& box = s.scene.obstacles[i];
+            Eigen::Matrix4d box_transform = Eigen::Matrix4d::Identity();
+            box_transform.block<3,3>(0,0) = box.rotation;
+            box_transform.block<3,1>(0,3) = box.center;
+            float box_space[16];
+            for (int j = 0; j < 16; j++)
+                box_space[j] = (float)box_transform.data()[j];
+            rlPushMatrix();
+                rlMultMatrixf(box_space);
+                Vector3 size = {2.f * (float)box.half_size.x(), 2.f * (float)box.half_size.y(), 2.f * (float)box.half_size.z()};
+                DrawCubeV({0, 0, 0}, size, ColorAlpha(BEIGE, 0.5f));
+                DrawCubeWiresV({0, 0, 0}, size, BEIGE);
+            rlPopMatrix();
+        }
+
         rlPushMatrix();
             rlTranslatef((float)target.position.x(), (float)target.position.y(), (float)target.position.z());
             // rotate to an angle axis from align and roll then draw
@@ -99,6 +183,38 @@ void draw_3d(State& s) {
             rlRotatef(angle_axis.angle() * RAD2DEG, (float)angle_axis.axis().x(), (float)angle_axis.axis().y(), (float)angle_axis.axis().z());
             DrawCylinderWiresEx({0, 0, 0}, {0, 0, 1.f}, 0.3f, 0.f, 8, ORANGE);
         rlPopMatrix();
+
+        if (s.show_workspace) {
+            const WorkspaceMap& map = s.workspace;
+            const float size = (float)map.voxel_size * 0.25f;
+            for (int z = 0; z < map.resolution; z++)
+                for (int y = 0; y < map.resolution; y++)
+                    for (int x = 0; x < map.resolution; x++) {
+                        const size_t voxel = ((size_t)z * map.resolution + y) * map.resolution + x;
+                        if (map.counts[voxel] == 0)
+                            continue;
+                        const Eigen::Vector3d center = map.minimum + map.voxel_size * Eigen::Vector3d(x + 0.5, y + 0.5, z + 0.5);
+                        DrawCube({(float)center.x(), (float)center.y(), (float)center.z()}, size, size, size,
+                                 ColorFromHSV(120.f * voxel_dexterity(map, voxel), 0.8f, 0.9f));
+                    }
+        }
+
+        for (size_t i = 1; i < s.follow_trace.size(); i++)
+            DrawLine3D(s.follow_trace[i - 1].first, s.follow_trace[i].first, s.follow_trace[i].second);
+
+        if (s.planned)
+            for (size_t i = 1; i < s.plan_trace.size(); i++)
+                DrawLine3D(s.plan_trace[i - 1], s.plan_trace[i], YELLOW);
+
+        // the goal the tip is chasing, green once IK got there
+        if (s.ik_enabled) {
+            rlPushMatrix();
+                rlTranslatef((float)s.goal.position.x(), (float)s.goal.position.y(), (float)s.goal.position.z());
+                Eigen::AngleAxisd goal_angle_axis(fromAlignRoll(s.goal.align, s.goal.roll));
+                rlRotatef(goal_angle_axis.angle() * RAD2DEG, (float)goal_angle_axis.axis().x(), (float)goal_angle_axis.axis().y(), (float)goal_angle_axis.axis().z());
+                DrawCylinderWiresEx({0, 0, 0}, {0, 0, 1.2f}, 0.4f, 0.f, 4, (s.controller ? s.controller_snapshot.reachable : s.ik.converged) ? GREEN : RED);
+            rlPopMatrix();
+        }
         
     EndMode3D();
 }
@@ -113,22 +229,33 @@ void draw_ui(State& s) {
     if (CheckCollisionPointRec(GetMousePosition(), toggle_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
         s.robot.axes[0].kind = linear ? Axis::Kind::Rotary : Axis::Kind::Linear;
         s.joint_values[0] = 0.f; 
+        s.show_workspace = false; // mapped for the other base
+        s.planned = s.playing = s.has_saved = s.following = false; // and so were these
+        s.controller.reset(); // it runs a copy of the robot
     }
 
+    // joint sliders span each axis' limits, in IK mode they move the goal instead and the joints are only shown
+    static const char* goal_names[6] = {"Goal x", "Goal y", "Goal z", "Goal yaw", "Goal pitch", "Goal roll"};
     for (int i = 0; i < 6; i++) {
         float y = 80.f + i * 60.f;
-        DrawText(TextFormat("Axis %d: %.2f", i, s.joint_values[i]), 20, y, 16, WHITE);
+        float& value = s.ik_enabled ? s.goal_values[i] : s.joint_values[i];
+        float minimum = s.ik_enabled ? (i < 3 ? -9.f : -PI) : (float)s.robot.axes[i].minimum;
+        float maximum = s.ik_enabled ? (i < 3 ? 9.f : PI) : (float)s.robot.axes[i].maximum;
+        if (s.ik_enabled)
+            DrawText(TextFormat("%s: %.2f (axis %d: %.2f)", goal_names[i], value, i, s.joint_values[i]), 20, y, 16, WHITE);
+        else
+            DrawText(TextFormat("Axis %d: %.2f", i, value), 20, y, 16, WHITE);
         Rectangle slider_rect = {20, y + 20, 200, 20};
         DrawRectangleLinesEx(slider_rect, 2, WHITE);
         DrawRectangle(
             slider_rect.x,
             slider_rect.y,
-            slider_rect.width * (s.joint_values[i] + PI) / (2.f * PI),
+            slider_rect.width * (value - minimum) / (maximum - minimum),
             slider_rect.height,
-            (i == 0 && linear) ? BLUE : PURPLE
+            s.ik_enabled ? GREEN : (i == 0 && linear) ? BLUE : PURPLE
         );
         if (CheckCollisionPointRec(GetMousePosition(), slider_rect) && IsMouseButtonDown(MOUSE_LEFT_BUTTON))
-            s.joint_values[i] = -PI + (GetMousePosition().x - slider_rect.x) / slider_rect.width * (2.f * PI);
+            value = minimum + (GetMousePosition().x - slider_rect.x) / slider_rect.width * (maximum - minimum);
     }
 
     DrawText(TextFormat("Target roll: %.2f rad", s.target.roll), 20, 430, 16, WHITE);
@@ -143,6 +270,258 @@ void draw_ui(State& s) {
     );
     if (CheckCollisionPointRec(GetMousePosition(), roll_rect) && IsMouseButtonDown(MOUSE_LEFT_BUTTON))
         s.target.roll = -PI + (GetMousePosition().x - roll_rect.x) / roll_rect.width * (2.f * PI);
+
+    Rectangle ik_rect = {20, 490, 200, 30};
+    DrawRectangleRec(ik_rect, s.ik_enabled ? DARKGREEN : GRAY);
+    DrawText(s.ik_enabled ? "IK on" : "IK off", ik_rect.x + 15, ik_rect.y + 6, 20, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), ik_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        s.ik_enabled = !s.ik_enabled;
+        s.playing = false;
+        if (s.ik_enabled)
+            s.goal_values = values_from_target(forward(s.robot, s.target, s.joint_values));
+    }
+    if (s.ik_enabled && !s.controller) {
+        DrawText(TextFormat("%s in %d it, %.1f us", s.ik.converged ? "Reached" : "Closest", s.ik.iterations, s.ik_microseconds), 20, 530, 16, WHITE);
+        DrawText(TextFormat("off by %.4f, %.4f rad", s.ik.position_error, s.ik.angle_error), 20, 550, 16, WHITE);
+    }
+
+    // how close the arm is to a singularity, manipulability drops to 0 and the condition number blows up as two axes line up
+    const Dexterity arm_dexterity = dexterity(geometric_jacobian(s.robot, s.kinematics.frames, s.target.position));
+    DrawText(TextFormat("Manipulability: %.3f", arm_dexterity.manipulability), 20, 590, 16, WHITE);
+    DrawText(TextFormat("Condition number: %.1f", arm_dexterity.condition_number), 20, 610, 16, arm_dexterity.condition_number > 100.0 ? RED : WHITE);
+    if (s.collision.colliding)
+        DrawText("Collision", 20, 630, 16, RED);
+    else if (std::isfinite(s.collision.distance))
+        DrawText(TextFormat("Clear by %.2f", s.collision.distance), 20, 630, 16, WHITE);
+    else
+        DrawText("Clear", 20, 630, 16, WHITE);
+
+    // a million random configurations through the batched forward kinematics, binned into 32³ voxels
+    Rectangle workspace_rect = {20, 650, 200, 30};
+    DrawRectangleRec(workspace_rect, s.show_workspace ? DARKGREEN : GRAY);
+    DrawText(s.show_workspace ? "Hide workspace" : "Map workspace", workspace_rect.x + 15, workspace_rect.y + 6, 20, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), workspace_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        s.show_workspace = !s.show_workspace;
+        if (s.show_workspace) {
+            auto start = std::chrono::steady_clock::now();
+            s.workspace = map_workspace(s.robot, s.target, 1000000, 32, 1234);
+            s.workspace_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+    }
+    if (s.show_workspace)
+        DrawText(TextFormat("1M configurations in %.0f ms", s.workspace_milliseconds), 20, 690, 16, WHITE);
+}
+
+// the planner's panel on the right
+void draw_planner_ui(State& s) {
+    DrawRectangle(1040, 0, 240, 720, ColorAlpha(BLACK, 0.5f));
+
+    Rectangle save_rect = {1060, 20, 200, 30};
+    DrawRectangleRec(save_rect, s.has_saved ? DARKGREEN : GRAY);
+    DrawText("Save pose", save_rect.x + 15, save_rect.y + 6, 20, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), save_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        s.saved_values = s.joint_values;
+        s.has_saved = true;
+    }
+
+    Rectangle plan_rect = {1060, 60, 200, 30};
+    DrawRectangleRec(plan_rect, s.has_saved ? (s.playing ? ORANGE : DARKBLUE) : GRAY);
+    DrawText("Plan to saved", plan_rect.x + 15, plan_rect.y + 6, 20, WHITE);
+    if (s.has_saved && CheckCollisionPointRec(GetMousePosition(), plan_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        s.ik_enabled = false; // the joints follow the path now
+        s.plan = plan_motion(s.robot, s.scene, s.joint_values, s.saved_values);
+        s.planned = true;
+        s.trajectory = {};
+        s.playing = s.plan.status == PlanStatus::Found;
+        s.played_time = 0.0;
+        // the tip along each edge, enough points for the curve the straight joint space edges draw in space
+        s.plan_trace.clear();
+        for (size_t i = 1; i < s.plan.path.size(); i++)
+            for (int k = i == 1 ? 0 : 1; k <= 16; k++) {
+                std::array<float, 6> joints;
+                for (int j = 0; j < 6; j++)
+                    joints[j] = s.plan.path[i - 1][j] + (s.plan.path[i][j] - s.plan.path[i - 1][j]) * k / 16.f;
+                const Eigen::Vector3d tip = forward(s.robot, s.target, joints).position;
+                s.plan_trace.push_back({(float)tip.x(), (float)tip.y(), (float)tip.z()});
+            }
+    }
+
+    if (s.planned) {
+        static const char* status_names[4] = {"Path found", "Start colliding", "Saved pose colliding", "No path"};
+        DrawText(status_names[(int)s.plan.status], 1060, 100, 16, s.plan.status == PlanStatus::Found ? WHITE : RED);
+        DrawText(TextFormat("%d nodes, %lld checks", s.plan.nodes, s.plan.collision_checks), 1060, 120, 16, WHITE);
+        DrawText(TextFormat("%.1f ms + %.1f ms smoothing", s.plan.planning_milliseconds, s.plan.smoothing_milliseconds), 1060, 140, 16, WHITE);
+        if (s.plan.status == PlanStatus::Found)
+            DrawText(TextFormat("%zu waypoints, length %.2f", s.plan.path.size(), path_length(s.plan.path)), 1060, 160, 16, WHITE);
+    }
+    if (!s.planned || s.plan.status != PlanStatus::Found)
+        return;
+
+    DrawText(TextFormat("Speed: x%.2f", s.speed_scale), 1060, 190, 16, WHITE);
+    Rectangle speed_rect = {1060, 210, 200, 15};
+    DrawRectangleLinesEx(speed_rect, 2, WHITE);
+    DrawRectangle(speed_rect.x, speed_rect.y, speed_rect.width * (s.speed_scale - 0.1f) / 0.9f, speed_rect.height, YELLOW);
+    bool regenerate = s.trajectory.segments.empty();
+    if (CheckCollisionPointRec(GetMousePosition(), speed_rect) && IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+        s.speed_scale = 0.1f + (GetMousePosition().x - speed_rect.x) / speed_rect.width * 0.9f;
+        regenerate = true;
+    }
+    if (regenerate) {
+        // keeps playing from the same share of the motion, only the pace changes
+        const double progress = s.trajectory.duration > 0.0 ? s.played_time / s.trajectory.duration : 0.0;
+        auto start = std::chrono::steady_clock::now();
+        s.trajectory = time_parameterize(s.robot, s.plan.path, s.speed_scale);
+        sample_trajectory(s.trajectory, std::max(s.trajectory.duration / 200.0, 1e-3), s.trajectory_samples);
+        s.trajectory_microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        s.played_time = progress * s.trajectory.duration;
+    }
+    DrawText(TextFormat("%.2f s, generated in %.0f us", s.trajectory.duration, s.trajectory_microseconds), 1060, 235, 16, WHITE);
+
+    // every joint's velocity over the motion, each within its limit (the plot's full height), and where playback is
+    Rectangle plot_rect = {1060, 260, 200, 120};
+    DrawRectangleLinesEx(plot_rect, 1, GRAY);
+    static const Color joint_colors[6] = {BLUE, PURPLE, GREEN, ORANGE, PINK, SKYBLUE};
+    const float middle = plot_rect.y + plot_rect.height / 2.f;
+    for (size_t k = 1; k < s.trajectory_samples.size(); k++) {
+        const TrajectorySample& previous = s.trajectory_samples[k - 1];
+        const TrajectorySample& sample = s.trajectory_samples[k];
+        for (int i = 0; i < 6; i++) {
+            const float scale = plot_rect.height / 2.f / (float)s.robot.axes[i].max_velocity;
+            DrawLineV({plot_rect.x + plot_rect.width * (float)(previous.time / s.trajectory.duration), middle - previous.velocity[i] * scale},
+                      {plot_rect.x + plot_rect.width * (float)(sample.time / s.trajectory.duration), middle - sample.velocity[i] * scale}, joint_colors[i]);
+        }
+    }
+    const float playhead = plot_rect.x + plot_rect.width * (float)(s.trajectory.duration > 0.0 ? s.played_time / s.trajectory.duration : 1.0);
+    DrawLineV({playhead, plot_rect.y}, {playhead, plot_rect.y + plot_rect.height}, WHITE);
+}
+
+// the toolpath section of the right panel
+void draw_follow_ui(State& s) {
+    Rectangle follow_rect = {1060, 400, 200, 30};
+    DrawRectangleRec(follow_rect, s.following ? ORANGE : DARKBLUE);
+    DrawText("Follow toolpath", follow_rect.x + 15, follow_rect.y + 6, 20, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), follow_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        // 0.15 of the toolpath demo's size in front of the arm, turned upside down so the plane's normal points the head down
+        constexpr double toolpath_scale = 0.15;
+        const Eigen::Affine3d path_to_robot = Eigen::Translation3d(3, 1, 0) * Eigen::Scaling(toolpath_scale) * Eigen::AngleAxisd(M_PI, Eigen::Vector3d::UnitX());
+        if (!s.followed) {
+            Input input;
+            input.V = Eigen::MatrixXd::Zero(1, 3);
+            input.F = Eigen::MatrixXi::Zero(1, 3);
+            input.mesh_to_world = Eigen::Matrix4d::Identity();
+            input.slicing_plane_normal = Eigen::Vector3d(0, 1, 0);
+            input.kind = Input::Kind::Spiral;
+            input.spiral_step = input.spiral_length / 1000000.0;
+            s.toolpath = ramping(input);
+            s.toolpath_length = 0.0;
+            for (size_t k = 1; k < s.toolpath.points.size(); k++)
+                s.toolpath_length += toolpath_scale * (s.toolpath.points[k] - s.toolpath.points[k - 1]).norm();
+        }
+        PathOptions options;
+        options.path_to_robot = path_to_robot.matrix();
+        s.follow = follow_path(s.robot, s.target, s.toolpath.points, s.toolpath.orientation, s.joint_values, options);
+        s.followed = s.following = true;
+        s.followed_time = 0.0;
+        s.ik_enabled = s.playing = false;
+
+        s.follow_trace.clear();
+        const size_t count = s.toolpath.points.size(), stride = std::max<size_t>(count / 4000, 1);
+        for (size_t k = 0; k < count; k += stride) {
+            Color color = GREEN;
+            for (size_t j = k; j < std::min(k + stride, count); j++) {
+                if (s.follow.unreachable[j]) {
+                    color = RED;
+                    break;
+                }
+                if (s.follow.singular[j])
+                    color = YELLOW;
+            }
+            const Eigen::Vector3d point = path_to_robot * s.toolpath.points[k];
+            s.follow_trace.push_back({{(float)point.x(), (float)point.y(), (float)point.z()}, color});
+        }
+    }
+    if (!s.followed)
+        return;
+    const double path_seconds = s.toolpath_length / s.feed_rate;
+    DrawText(TextFormat("%zu points in %.0f ms", s.toolpath.points.size(), s.follow.milliseconds), 1060, 440, 16, WHITE);
+    DrawText(TextFormat("%.0fx real time at %.1f/s", path_seconds * 1000.0 / s.follow.milliseconds, s.feed_rate), 1060, 460, 16, WHITE);
+    DrawText(TextFormat("%zu unreachable stretches", s.follow.unreachable_spans.size()), 1060, 480, 16, s.follow.unreachable_spans.empty() ? WHITE : RED);
+    DrawText(TextFormat("%zu singular stretches", s.follow.singular_spans.size()), 1060, 500, 16, s.follow.singular_spans.empty() ? WHITE : YELLOW);
+}
+
+// the controller section of the right panel, its timing as measured on its own thread
+void draw_controller_ui(State& s) {
+    Rectangle controller_rect = {1060, 540, 200, 30};
+    DrawRectangleRec(controller_rect, s.controller ? DARKGREEN : GRAY);
+    DrawText(s.controller ? "Controller on" : "Controller off", controller_rect.x + 15, controller_rect.y + 6, 20, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), controller_rect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+        if (s.controller) {
+            s.joint_values = s.controller_snapshot.joint_values; // the arm stays where the controller left it
+            s.controller.reset();
+        } else {
+            s.controller = std::make_unique<Controller>();
+            start_controller(*s.controller, s.robot, s.target, s.joint_values);
+            s.controller_snapshot = s.controller->snapshots.read();
+        }
+    }
+    if (!s.controller)
+        return;
+    const ControllerSnapshot& snapshot = s.controller_snapshot;
+    DrawText(TextFormat("%lld ticks, %lld setpoints", snapshot.tick, snapshot.setpoints), 1060, 580, 16, WHITE);
+    DrawText(TextFormat("wake p50 %.0f p99 %.0f p99.9 %.0f us", snapshot.wake_latency.p50, snapshot.wake_latency.p99, snapshot.wake_latency.p999),
+             1060, 600, 16, WHITE);
+    DrawText(TextFormat("max %.0f us, %lld overruns", snapshot.wake_latency.maximum, snapshot.overruns), 1060, 620, 16, snapshot.overruns ? ORANGE : WHITE);
+    DrawText(TextFormat("tick work p99 %.0f us", snapshot.tick_time.p99), 1060, 640, 16, WHITE);
+}
+
+// moves the joints along the trajectory in real time
+void play_plan(State& s) {
+    if (!s.playing || s.trajectory.segments.empty())
+        return;
+    s.played_time += GetFrameTime();
+    s.joint_values = sample_trajectory(s.trajectory, s.played_time).position;
+    s.playing = s.played_time < s.trajectory.duration;
+}
+
+// moves the joints along the followed toolpath at the feed rate
+void play_toolpath(State& s) {
+    if (!s.following)
+        return;
+    s.followed_time += GetFrameTime();
+    const size_t count = s.follow.joint_values.size();
+    const double progress = s.followed_time * s.feed_rate / s.toolpath_length;
+    s.joint_values = s.follow.joint_values[std::min(count - 1, (size_t)(progress * (count - 1)))];
+    s.following = progress < 1.0;
+}
+
+// sends the frame's setpoint, the IK goal as is for the controller to solve or the joints the sliders and playbacks put out,
+// then takes the latest snapshot for the frame
+void command_controller(State& s) {
+    if (!s.controller)
+        return;
+    Setpoint setpoint;
+    if (s.ik_enabled) {
+        s.goal = goal_from_values(s.goal_values);
+        setpoint.kind = Setpoint::Kind::Cartesian;
+        setpoint.goal = s.goal;
+    } else {
+        setpoint.joint_values = s.joint_values;
+    }
+    s.controller->setpoints.push(setpoint); // 256 slots against a frame's worth of ticks, never full
+    s.controller_snapshot = s.controller->snapshots.read();
+    if (s.ik_enabled)
+        s.joint_values = s.controller_snapshot.joint_values;
+}
+
+// chases the goal from the current joints every frame, a goal that moved a little needs only a couple of iterations
+void solve_goal(State& s) {
+    if (!s.ik_enabled || s.controller)
+        return;
+    s.goal = goal_from_values(s.goal_values);
+    auto start = std::chrono::steady_clock::now();
+    s.ik = inverse(s.robot, s.target, s.goal, s.joint_values);
+    s.ik_microseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+    s.joint_values = s.ik.joint_values;
 }
 
 int main() {
@@ -152,9 +531,16 @@ int main() {
     SetTargetFPS(60);
     while (!WindowShouldClose()) {
         handle_mouse(state);
+        solve_goal(state);
+        play_plan(state);
+        play_toolpath(state);
+        command_controller(state);
         BeginDrawing();
             draw_3d(state);
             draw_ui(state);
+            draw_planner_ui(state);
+            draw_follow_ui(state);
+            draw_controller_ui(state);
         EndDrawing();
     }
     CloseWindow();
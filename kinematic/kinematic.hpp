@@ -1,4 +1,5 @@
 #include "main.hpp"
+#include "snapshot_buffer.hpp"
 
 // This is a technical test file I was given as a .cpp, it suffices for my prototype so I built upon it
 // all the comments have been removed so people can't just search them up to cheat using my solution
@@ -22,6 +23,16 @@ struct Axis {
 
 	Eigen::Vector3d segmentA;
 	Eigen::Vector3d segmentB;
+	// the link's body for collisions: every point within radius of the segmentA-segmentB segment (in the axis' space), 0 = no body
+	double radius = 0.0;
+
+	// joint limits, radians for rotary, units along the pivot's x for linear, the sliders span them and IK never leaves them
+	double minimum = -M_PI;
+	double maximum = M_PI;
+	// how fast the joint may move, per second, per second², per second³, a jerk of 0 = unlimited (trapezoidal velocity)
+	double max_velocity = 1.5;
+	double max_acceleration = 3.0;
+	double max_jerk = 15.0;
 };
 
 struct Robot {
@@ -30,34 +41,130 @@ struct Robot {
 	Eigen::Matrix4d transform;
 };
 
-Target forward(const Robot& robot, const Target& tip_target, const std::array<float, 6> &joint_values) {
-    // build the cumulative transform by chaining pivot translations
-    Eigen::Matrix4d cumulative_transform = robot.transform;
-    for (size_t i = 0; i < robot.axes.size(); i++) {
-        const auto& axis = robot.axes[i];
-        Eigen::Matrix4d local_transform = Eigen::Matrix4d::Identity();
-        local_transform.block<3,1>(0,3) = axis.pivot;
-        if (axis.kind == Axis::Kind::Rotary) {
-            local_transform.block<3,3>(0,0) = Eigen::AngleAxisd(joint_values[i], axis.pivotNormal).toRotationMatrix();
-        } else {
-            local_transform(0, 3) += joint_values[i];
-        }
-        cumulative_transform *= local_transform;
+// appends one link to the cumulative transform, written on the raw column-major coefficients (column j starts at j·4) one column per
+// AVX register, Eigen's own 4×4 product already vectorizes but can't know the bottom row is constant or that a linear link leaves the rotation alone
+template <Axis::Kind Kind> void chain_link(Eigen::Matrix4d& cumulative, const Axis& axis, double value) {
+    double* m = cumulative.data();
+    const double pivot_x = Kind == Axis::Kind::Linear ? axis.pivot.x() + value : axis.pivot.x(), pivot_y = axis.pivot.y(), pivot_z = axis.pivot.z();
+    Eigen::Matrix3d rotation;
+    if constexpr (Kind == Axis::Kind::Rotary)
+        rotation = Eigen::AngleAxisd(value, axis.pivotNormal).toRotationMatrix();
+#ifdef __AVX2__
+    const __m256d column_0 = _mm256_loadu_pd(m), column_1 = _mm256_loadu_pd(m + 4), column_2 = _mm256_loadu_pd(m + 8);
+    auto combine = [&](double x, double y, double z) {
+        return _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(column_0, _mm256_set1_pd(x)), _mm256_mul_pd(column_1, _mm256_set1_pd(y))),
+                             _mm256_mul_pd(column_2, _mm256_set1_pd(z)));
+    };
+    _mm256_storeu_pd(m + 12, _mm256_add_pd(combine(pivot_x, pivot_y, pivot_z), _mm256_loadu_pd(m + 12)));
+    if constexpr (Kind == Axis::Kind::Rotary)
+        for (int column = 0; column < 3; column++)
+            _mm256_storeu_pd(m + column * 4, combine(rotation(0, column), rotation(1, column), rotation(2, column)));
+#else
+    double previous[12];
+    std::copy(m, m + 12, previous);
+    for (int row = 0; row < 4; row++)
+        m[12 + row] = previous[row] * pivot_x + previous[4 + row] * pivot_y + previous[8 + row] * pivot_z + m[12 + row];
+    if constexpr (Kind == Axis::Kind::Rotary)
+        for (int column = 0; column < 3; column++)
+            for (int row = 0; row < 4; row++)
+                m[column * 4 + row] = previous[row] * rotation(0, column) + previous[4 + row] * rotation(1, column) + previous[8 + row] * rotation(2, column);
+#endif
+}
+
+// forward kinematics with the joint kinds as template parameters, one instantiation per chain layout:
+// the kind branch is resolved by the compiler, the fold below unrolls the six links into straight-line code,
+// and each link only does the work its kind needs, treating the matrices as the rigid transforms they are
+// (the 0 0 0 1 bottom row never changes so it is never multiplied through):
+// - rotary: [R | t] · [Rq | pivot] = [R·Rq | R·pivot + t], 3 new rotation columns + the translation instead of a full 4×4 product
+// - linear: [R | t] · [I | pivot + q·x] = [R | R·(pivot + q·x) + t], only the translation column moves
+// each column is summed in the same order as the 4×4 product (the skipped terms are exact zeros and ones) so the results are identical
+// ex: Chain<Linear, Rotary, Rotary, Rotary, Rotary, Rotary>::transform(robot, joints) for the demo arm with its sliding base
+template <Axis::Kind... Kinds> struct Chain {
+    static_assert(sizeof...(Kinds) == 6, "a chain describes the robot's six axes");
+
+    template <typename Value> static Eigen::Matrix4d transform(const Robot& robot, const std::array<Value, 6>& joint_values) {
+        Eigen::Matrix4d cumulative = robot.transform;
+        [&]<size_t... I>(std::index_sequence<I...>) { (chain_link<Kinds>(cumulative, robot.axes[I], (double)joint_values[I]), ...); }(std::make_index_sequence<6>{});
+        return cumulative;
     }
-    // transform tip_target from end-effector space to robot base space
+};
+
+// the chain for the given kinds as a bit mask (bit i set = axis i linear)
+template <typename Value, size_t Mask> Eigen::Matrix4d chain_for_mask(const Robot& robot, const std::array<Value, 6>& joint_values) {
+    constexpr auto kind = [](size_t i) { return (Mask >> i) & 1 ? Axis::Kind::Linear : Axis::Kind::Rotary; };
+    return Chain<kind(0), kind(1), kind(2), kind(3), kind(4), kind(5)>::transform(robot, joint_values);
+}
+
+// cumulative transform of the whole chain, robot space to the last axis' space, for a robot whose kinds are only known at runtime
+// (the demo toggles axis 0): one table lookup picks the matching specialized chain out of the 64 possible layouts,
+// templated on the joint value type so IK can iterate in doubles
+template <typename Value> Eigen::Matrix4d chain_transform(const Robot& robot, const std::array<Value, 6>& joint_values) {
+    static constexpr auto chains = []<size_t... Mask>(std::index_sequence<Mask...>) {
+        return std::array { &chain_for_mask<Value, Mask>... };
+    }(std::make_index_sequence<64>{});
+    size_t mask = 0;
+    for (size_t i = 0; i < 6; i++)
+        mask |= size_t(robot.axes[i].kind == Axis::Kind::Linear) << i;
+    return chains[mask](robot, joint_values);
+}
+
+// every link's cumulative transform for one configuration, frames[i] = robot space to axis i's space once its joint moved,
+// what draw_3d draws each link in, what the Jacobian reads the joint axes from, and frames[5] carries the tip
+using LinkFrames = std::array<Eigen::Matrix4d, 6>;
+
+// recomputes frames from link first on, the ones before it are kept as they are: a joint only moves the links after it
+template <typename Value> void update_link_frames(const Robot& robot, const std::array<Value, 6>& joint_values, LinkFrames& frames, int first = 0) {
+    Eigen::Matrix4d cumulative = first == 0 ? robot.transform : frames[first - 1];
+    for (int i = first; i < 6; i++) {
+        if (robot.axes[i].kind == Axis::Kind::Rotary)
+            chain_link<Axis::Kind::Rotary>(cumulative, robot.axes[i], (double)joint_values[i]);
+        else
+            chain_link<Axis::Kind::Linear>(cumulative, robot.axes[i], (double)joint_values[i]);
+        frames[i] = cumulative;
+    }
+}
+
+// the link frames kept from one update to the next along with what they were computed for (joints, kinds, base transform),
+// so an update only redoes the links from the first thing that changed on (frames.cpp)
+// ex: dragging the axis 4 slider -> links 4 and 5 recomputed, 0 to 3 reused, nothing moved -> nothing recomputed
+struct KinematicState {
+    LinkFrames frames;
+    std::array<float, 6> joint_values;
+    std::array<Axis::Kind, 6> kinds;
+    Eigen::Matrix4d base;
+    bool valid = false; // set false after editing pivots or normals, those aren't compared
+    int recomputed_links = 0; // by the last update
+};
+
+void update_kinematic_state(KinematicState& state, const Robot& robot, const std::array<float, 6>& joint_values);
+
+inline Eigen::Quaterniond fromAlignRoll(Eigen::Vector3d align, double roll);
+inline std::pair<Eigen::Vector3d, double> toAlignRoll(const Eigen::Quaterniond& quat);
+
+// transforms tip_target from end-effector space to robot base space, roll included: the tip's full orientation goes through the chain
+// and is split back into align + roll so the result is a complete pose IK can aim at (only carrying align over would lose the twist)
+inline Target transform_target(const Eigen::Matrix4d& cumulative_transform, const Target& tip_target) {
     Target result = tip_target;
     result.position = (cumulative_transform * tip_target.position.homogeneous()).head<3>();
-    result.align = (cumulative_transform.block<3,3>(0,0) * tip_target.align).normalized();
+    const Eigen::Quaterniond orientation = Eigen::Quaterniond(Eigen::Matrix3d(cumulative_transform.block<3,3>(0,0))) * fromAlignRoll(tip_target.align, tip_target.roll);
+    std::tie(result.align, result.roll) = toAlignRoll(orientation);
     return result;
 }
 
-Eigen::Quaterniond fromAlignRoll(Eigen::Vector3d align, double roll) {
+inline Target forward(const Robot& robot, const Target& tip_target, const std::array<float, 6> &joint_values) {
+    return transform_target(chain_transform(robot, joint_values), tip_target);
+}
+
+// same as above from the cached frames, no chain evaluated at all (frames.cpp)
+Target forward(const KinematicState& state, const Target& tip_target);
+
+inline Eigen::Quaterniond fromAlignRoll(Eigen::Vector3d align, double roll) {
 	// rotate Z (convention vector) to point in the align direction then twists around it by roll radians
     align.normalize();
     return Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitZ(), align) * Eigen::Quaterniond(Eigen::AngleAxisd(roll, Eigen::Vector3d::UnitZ()));
 }
 
-std::pair<Eigen::Vector3d, double> toAlignRoll(const Eigen::Quaterniond& quat) {
+inline std::pair<Eigen::Vector3d, double> toAlignRoll(const Eigen::Quaterniond& quat) {
 	// extract align direction
     Eigen::Vector3d align = quat * Eigen::Vector3d::UnitZ();
     align.normalize();
@@ -70,4 +177,293 @@ std::pair<Eigen::Vector3d, double> toAlignRoll(const Eigen::Quaterniond& quat) {
         roll = -roll;
     }
     return {align, roll};
-}
\ No newline at end of file
+}
+
+// geometric Jacobian, column i = the tip's twist (linear velocity on top, angular velocity below, both in robot base space)
+// per unit of joint i, built from the cumulative transforms in one pass down the chain (jacobian.cpp)
+using Jacobian = Eigen::Matrix<double, 6, 6>;
+
+Jacobian geometric_jacobian(const Robot& robot, const Eigen::Vector3d& tip_position, const std::array<double, 6>& joint_values);
+// from link frames already at hand (a KinematicState's), nothing recomputed
+Jacobian geometric_jacobian(const Robot& robot, const LinkFrames& frames, const Eigen::Vector3d& tip_position);
+
+// how freely the tip can move from a configuration, both read off the Jacobian's singular values σ
+struct Dexterity {
+    double manipulability = 0.0; // Yoshikawa's √det(J Jᵀ) = σ1·σ2·…·σ6, 0 at a singularity
+    double condition_number = 0.0; // σmax / σmin, 1 = moves as easily in every direction, infinity at a singularity
+};
+
+Dexterity dexterity(const Jacobian& jacobian);
+
+
+// forward kinematics over many configurations at once (workspace.cpp), in floats and structure of arrays:
+// joint i of configuration c sits at joints[i][c] so 8 neighbouring configurations load into one AVX register and go down the chain together
+struct JointBatch {
+    std::array<std::vector<float>, 6> joints;
+};
+
+// the tips of a batch, same layout: position, align (where the tip points) and side (the tip's own x), the two axes pin the whole
+// orientation, the third one is their cross product
+struct PoseBatch {
+    std::vector<float> x, y, z;
+    std::vector<float> align_x, align_y, align_z;
+    std::vector<float> side_x, side_y, side_z;
+};
+
+void forward_batch(const Robot& robot, const Target& tip_target, const JointBatch& batch, PoseBatch& poses);
+
+// where the tip can get and from how many directions, over a cube of resolution³ voxels around the robot
+// ex: a voxel at the edge of the reach is only hit with the arm stretched towards it, a handful of directions, low dexterity,
+//     one close to the shoulder is hit from nearly everywhere
+struct WorkspaceMap {
+    int resolution = 0; // voxels per side
+    Eigen::Vector3d minimum; // corner of the cube
+    double voxel_size = 0.0;
+    long long sample_count = 0;
+    std::vector<uint32_t> counts; // sampled configurations whose tip landed in the voxel
+    std::vector<uint64_t> directions; // which of 64 equal-area bins of align directions were seen there, one bit each
+};
+
+WorkspaceMap map_workspace(const Robot& robot, const Target& tip_target, long long sample_count, int resolution, uint32_t seed);
+// share of the 64 direction bins seen in the voxel, 0 = unreachable to 1 = reached pointing every way
+float voxel_dexterity(const WorkspaceMap& map, size_t voxel);
+
+
+// collision checking on the links' capsules (collision.cpp), distances are signed: > 0 apart, <= 0 touching or overlapping
+struct Capsule {
+    Eigen::Vector3d a, b;
+    double radius;
+};
+
+// an oriented box, obstacles and the floor
+struct Box {
+    Eigen::Vector3d center;
+    Eigen::Vector3d half_size;
+    Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity(); // box space to robot base space
+};
+
+double capsule_distance(const Capsule& first, const Capsule& second);
+double capsule_box_distance(const Capsule& capsule, const Box& box);
+
+// what the links can hit besides each other, in the same space as the link frames
+struct CollisionScene {
+    std::vector<Box> obstacles;
+    double clearance = 0.0; // closer than this counts as a collision
+};
+
+struct CollisionReport {
+    bool colliding = false;
+    std::array<bool, 6> links = {}; // which links are involved
+    double distance = std::numeric_limits<double>::infinity(); // smallest gap among the pairs that got past the broad phase, infinity = none did
+};
+
+// the configuration whose link frames are given, first_hit stops at the first collision (planning only needs yes or no)
+CollisionReport check_collision(const Robot& robot, const LinkFrames& frames, const CollisionScene& scene, bool first_hit = false);
+// yes or no for every configuration of a batch, spread across the cores, colliding[c] = 1 when configuration c collides
+void check_collision_batch(const Robot& robot, const JointBatch& batch, const CollisionScene& scene, std::vector<uint8_t>& colliding);
+
+
+// inverse kinematics, joint values that bring tip_target onto a goal pose (ik.cpp)
+struct IkOptions {
+    int max_iterations = 64;
+    double position_tolerance = 1e-4; // same units as the pivots
+    double angle_tolerance = 1e-4; // radians
+    double damping = 1e-2; // starting λ, grows where the arm is near singular, shrinks again once steps pay off
+};
+
+struct IkResult {
+    std::array<float, 6> joint_values;
+    bool converged = false;
+    int iterations = 0;
+    double position_error = 0.0;
+    double angle_error = 0.0;
+};
+
+IkResult inverse(const Robot& robot, const Target& tip_target, const Target& goal, const std::array<float, 6>& start_values, const IkOptions& options = {});
+
+
+// collision-free motion between two joint configurations (planner.cpp), RRT-Connect: one tree grows from each end towards random
+// configurations and towards each other until they meet, the path is then shortcut, every configuration is checked on the links' capsules
+struct PlannerOptions {
+    double step = 0.15; // farthest a tree grows in one extension, joint space distance
+    double resolution = 0.05; // edges are checked so no point of the arm moves more than this in between, and every check keeps this much clearance
+    int max_nodes = 20000; // both trees together
+    double max_milliseconds = 500.0;
+    int shortcut_rounds = 8; // each one tries shortcut_batch random shortcuts at once
+    int shortcut_batch = 8;
+    uint32_t seed = 1;
+};
+
+enum class PlanStatus {
+    Found,
+    StartColliding, // or closer than the resolution
+    GoalColliding,
+    NoPath // out of nodes or time
+};
+
+struct PlanResult {
+    PlanStatus status = PlanStatus::NoPath;
+    std::vector<std::array<float, 6>> path; // waypoints from start to goal, straight joint space edges between them
+    int nodes = 0;
+    long long collision_checks = 0; // configurations checked
+    double planning_milliseconds = 0.0;
+    double smoothing_milliseconds = 0.0;
+};
+
+PlanResult plan_motion(const Robot& robot, const CollisionScene& scene, const std::array<float, 6>& start, const std::array<float, 6>& goal,
+                       const PlannerOptions& options = {});
+// joint space length of a path, what the smoothing shortens
+double path_length(const std::vector<std::array<float, 6>>& path);
+
+
+// time along a joint space path (trajectory.cpp): every straight edge between two waypoints is one segment run rest to rest
+// with a jerk-limited S-curve (7 phases: jerk up, constant acceleration, jerk down, cruise, then the same braking),
+// the joints move in sync, all on the edge's straight line and arriving together, the slowest joint relative to its limits sets the pace
+struct SCurve {
+    double jerk = 0.0, acceleration = 0.0, velocity = 0.0; // reached along the edge's 0 to 1 parameter
+    double jerk_time = 0.0; // each jerk phase
+    double acceleration_time = 0.0; // speeding up as a whole, jerk phases included
+    double cruise_time = 0.0;
+    double duration = 0.0;
+};
+
+struct TrajectorySegment {
+    std::array<float, 6> from, to;
+    double start_time = 0.0;
+    SCurve profile;
+};
+
+struct Trajectory {
+    std::vector<TrajectorySegment> segments;
+    double duration = 0.0;
+};
+
+struct TrajectorySample {
+    double time = 0.0;
+    std::array<float, 6> position, velocity, acceleration;
+};
+
+// speed_scale slows every joint's limits down together (velocity × scale, acceleration × scale², jerk × scale³ keeps the same shape)
+Trajectory time_parameterize(const Robot& robot, const std::vector<std::array<float, 6>>& path, double speed_scale = 1.0);
+// the state at a time, clamped to the trajectory's start and end
+TrajectorySample sample_trajectory(const Trajectory& trajectory, double time);
+// every period from 0 to the end, the end itself always included
+void sample_trajectory(const Trajectory& trajectory, double period, std::vector<TrajectorySample>& samples);
+
+
+// the tip along a stream of points and orientations (follow.cpp), such as a toolpath's Output, by inverse kinematics at every point
+// warm started from the previous one
+struct PathOptions {
+    IkOptions ik = {16}; // a point next to the last one takes 1 or 2 iterations, more only burns time on unreachable ones
+    Eigen::Matrix4d path_to_robot = Eigen::Matrix4d::Identity(); // places the path in robot space, scaling included
+    double roll = 0.0; // the tip's twist around each orientation, the stream doesn't carry one
+    // joint space distance per unit of tip motion above which a stretch counts as singular: next to a singularity a small tip motion
+    // takes a large joint motion, measured over windows of tip motion long enough that IK's tolerance doesn't read as motion
+    double max_joint_ratio = 20.0;
+    double singular_window = 0.01;
+    size_t seed_spacing = 64; // see follow_path
+};
+
+// consecutive points sharing a flag
+struct PathSpan {
+    size_t first, count;
+};
+
+struct PathFollowing {
+    std::vector<std::array<float, 6>> joint_values; // one per point
+    std::vector<uint8_t> unreachable; // 1 where IK couldn't get there, the joints are then the closest pose found
+    std::vector<uint8_t> singular;
+    std::vector<PathSpan> unreachable_spans, singular_spans;
+    long long iterations = 0; // IK iterations over the whole path
+    double milliseconds = 0.0;
+};
+
+PathFollowing follow_path(const Robot& robot, const Target& tip_target, const std::vector<Eigen::Vector3d>& points,
+                          const std::vector<Eigen::Vector3d>& orientation, const std::array<float, 6>& start_values, const PathOptions& options = {});
+
+
+// real-time control (controller.cpp): a thread ticking at a fixed 1 kHz takes setpoints from the UI, moves the joints towards them
+// within their limits and hands its state back, the two sides never lock or wait on each other
+
+// single producer / single consumer ring, lock-free: the producer only writes head, the consumer only tail, each reads the other's
+// with acquire so a slot's contents are visible before its index is, the counters only grow and wrap through the mask,
+// each on its own cache line so the two threads don't keep taking the line from each other
+template <typename T, size_t Capacity> struct SpscQueue {
+    static_assert(std::has_single_bit(Capacity), "a power of two so the wrap is a mask");
+    std::array<T, Capacity> slots;
+    alignas(64) std::atomic<size_t> head{0}; // next slot written
+    alignas(64) std::atomic<size_t> tail{0}; // next slot read
+
+    // false when full, the value is dropped
+    bool push(const T& value) {
+        const size_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) == Capacity)
+            return false;
+        slots[position & (Capacity - 1)] = value;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool pop(T& value) {
+        const size_t position = tail.load(std::memory_order_relaxed);
+        if (position == head.load(std::memory_order_acquire))
+            return false;
+        value = slots[position & (Capacity - 1)];
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+};
+
+// where the joints should go: given directly, or a goal pose for tip_target solved by IK on the controller thread
+struct Setpoint {
+    enum class Kind {
+        Joint,
+        Cartesian
+    };
+    Kind kind = Kind::Joint;
+    std::array<float, 6> joint_values = {};
+    Target goal = {Eigen::Vector3d::Zero(), Eigen::Vector3d::UnitZ(), 0.0}; // set even for joint setpoints, every slot is copied whole
+};
+
+struct ControllerOptions {
+    double period = 1e-3; // seconds per tick
+    // how long before each tick the thread stops sleeping and spins instead, the OS wakes a sleeping thread tens of µs late,
+    // spinning trades that much of a core for ticks on time, 0 = only sleep
+    double spin = 0.0;
+    IkOptions ik = {16};
+};
+
+// over every tick so far, microseconds
+struct LatencyStatistics {
+    double p50 = 0.0, p99 = 0.0, p999 = 0.0, maximum = 0.0;
+};
+
+// the controller's state at the end of a tick, what the renderer draws
+struct ControllerSnapshot {
+    long long tick = 0;
+    std::array<float, 6> joint_values = {};
+    std::array<float, 6> joint_velocities = {};
+    std::array<float, 6> target_values = {}; // the latest setpoint once solved and inside the limits
+    bool reachable = true; // whether IK got to the latest Cartesian setpoint
+    long long setpoints = 0; // taken off the queue so far
+    long long overruns = 0; // ticks skipped because the thread woke up a whole period late or more
+    LatencyStatistics wake_latency; // how late each tick started against its schedule
+    LatencyStatistics tick_time; // how long each tick's work took
+};
+
+struct Controller {
+    Robot robot;
+    Target tip_target;
+    ControllerOptions options;
+    SpscQueue<Setpoint, 256> setpoints; // the UI pushes, the controller pops
+    SnapshotBuffer<ControllerSnapshot> snapshots; // the controller publishes, the UI reads
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    ~Controller();
+};
+
+// copies the robot (its later edits don't reach a running controller) and starts ticking from joint_values
+void start_controller(Controller& controller, const Robot& robot, const Target& tip_target, const std::array<float, 6>& joint_values,
+                      const ControllerOptions& options = {});
+void stop_controller(Controller& controller);
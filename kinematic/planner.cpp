@@ -0,0 +1,367 @@
+#include "kinematic.hpp"
+
+#pragma region planner utils
+using Joints = std::array<float, 6>;
+
+static float distance_squared(const Joints& first, const Joints& second) {
+    float sum = 0.f;
+    for (int i = 0; i < 6; i++)
+        sum += (first[i] - second[i]) * (first[i] - second[i]);
+    return sum;
+}
+
+static Joints interpolate(const Joints& from, const Joints& to, float t) {
+    Joints result;
+    for (int i = 0; i < 6; i++)
+        result[i] = from[i] + (to[i] - from[i]) * t;
+    return result;
+}
+
+// one RRT tree with a k-d tree over the same nodes for the nearest neighbour queries, both only ever grow so nothing is rebalanced:
+// each new node hangs below the leaf its coordinates lead to, splitting on joint depth % 6,
+// random samples arrive in random order which keeps the depth logarithmic in practice
+// ex: nodes (0,...) then (1,...) then (-1,...): the root splits on joint 0, (1,...) goes right, (-1,...) left
+struct JointTree {
+    std::vector<Joints> nodes;
+    std::vector<int> parents; // the RRT edge each node was reached by, -1 for the root
+    std::vector<std::array<int, 2>> children; // k-d tree, below / above the node on its split joint, -1 = none
+};
+
+static void insert_node(JointTree& tree, const Joints& joints, int parent) {
+    const int index = (int)tree.nodes.size();
+    tree.nodes.push_back(joints);
+    tree.parents.push_back(parent);
+    tree.children.push_back({-1, -1});
+    if (index == 0)
+        return;
+    int node = 0;
+    for (int depth = 0;; depth++) {
+        const int split = depth % 6;
+        int& child = tree.children[node][joints[split] >= tree.nodes[node][split]];
+        if (child < 0) {
+            child = index;
+            return;
+        }
+        node = child;
+    }
+}
+
+// descends the side of each split the query is on first, the other side is only visited when the split plane is closer
+// than the best node found so far (a closer node can only be across a plane nearer than it)
+static void nearest_below(const JointTree& tree, int node, int depth, const Joints& query, int& best, float& best_squared) {
+    if (node < 0)
+        return;
+    const float squared = distance_squared(tree.nodes[node], query);
+    if (squared < best_squared) {
+        best_squared = squared;
+        best = node;
+    }
+    const int split = depth % 6;
+    const float offset = query[split] - tree.nodes[node][split];
+    nearest_below(tree, tree.children[node][offset >= 0.f], depth + 1, query, best, best_squared);
+    if (offset * offset < best_squared)
+        nearest_below(tree, tree.children[node][offset < 0.f], depth + 1, query, best, best_squared);
+}
+
+static int nearest_node(const JointTree& tree, const Joints& query) {
+    int best = 0;
+    float best_squared = std::numeric_limits<float>::infinity();
+    nearest_below(tree, 0, 0, query, best, best_squared);
+    return best;
+}
+
+// how far any point of the links after joint i can move per unit of joint i: for a rotary joint the farthest such point from its pivot
+// (the pivots after it end to end, the farthest segment end and its radius, the travel of linear joints after it), an arc is never longer
+// than radius × angle, for a linear joint 1
+// ex: the demo arm's axis 1 carries 4 more 1.5 links and a 0.35 radius -> 7.85 per radian
+static std::array<double, 6> motion_bounds(const Robot& robot) {
+    std::array<double, 6> bounds;
+    for (int i = 0; i < 6; i++) {
+        if (robot.axes[i].kind == Axis::Kind::Linear) {
+            bounds[i] = 1.0;
+            continue;
+        }
+        double reach = 0.0, body = 0.0;
+        for (int k = i; k < 6; k++) {
+            const Axis& axis = robot.axes[k];
+            if (k > i)
+                reach += axis.pivot.norm() + (axis.kind == Axis::Kind::Linear ? std::max(std::abs(axis.minimum), std::abs(axis.maximum)) : 0.0);
+            body = std::max(body, reach + std::max(axis.segmentA.norm(), axis.segmentB.norm()) + axis.radius);
+        }
+        bounds[i] = body;
+    }
+    return bounds;
+}
+
+// edges needing more checks than this are split across the cores, a thread costs tens of µs to start and a check a few µs,
+// in practice that's the straight start to goal edge tried first (often a thousand checks or more), a tree step stays well under it
+constexpr int parallel_edge_checks = 256;
+
+static bool configuration_free(const Robot& robot, const CollisionScene& scene, const Joints& joints) {
+    LinkFrames frames;
+    update_link_frames(robot, joints, frames);
+    return !check_collision(robot, frames, scene, true).colliding;
+}
+
+// a configuration is free when its links touch neither each other nor the scene, frames straight from the specialized chain links,
+// checked with resolution added to the clearance so that a whole edge is free and not only the configurations checked along it:
+// checks are spaced so that no point of the arm moves more than resolution from one to the next, any configuration in between
+// is within resolution / 2 of a checked one for every link, two links closing in on each other by resolution at most
+struct ConfigurationChecker {
+    const Robot& robot;
+    CollisionScene scene;
+    double resolution;
+    std::array<double, 6> bounds;
+    long long checks = 0;
+    bool split_long_edges = true; // off where the checker already runs on one of several threads
+
+    ConfigurationChecker(const Robot& robot, const CollisionScene& scene, double resolution)
+        : robot(robot), scene(scene), resolution(resolution), bounds(motion_bounds(robot)) {
+        this->scene.clearance += resolution;
+    }
+
+    bool free(const Joints& joints) {
+        checks++;
+        return configuration_free(robot, scene, joints);
+    }
+
+    // the straight edge from a free configuration to another one, the far end first then by halving (middle, quarters, eighths..):
+    // a blocked edge is usually blocked over a stretch and halving finds it in a few checks where walking from the start would go
+    // through the whole free part first
+    // ex: 7 inner steps -> far end, then 4, 2, 6, 1, 3, 5, 7
+    // a long edge deals that order out round robin to every core so each one still goes coarse to fine, the first to hit stops them all
+    bool edge_free(const Joints& from, const Joints& to) {
+        if (!free(to))
+            return false;
+        double motion = 0.0;
+        for (int i = 0; i < 6; i++)
+            motion += bounds[i] * std::abs(to[i] - from[i]);
+        const int steps = (int)std::ceil(motion / resolution);
+        int stride = 1;
+        while (stride * 2 < steps)
+            stride *= 2;
+        const int thread_count = (int)std::max(1u, std::thread::hardware_concurrency());
+        if (steps <= parallel_edge_checks || thread_count == 1 || !split_long_edges) {
+            for (; stride >= 1; stride /= 2)
+                for (int k = stride; k < steps; k += 2 * stride)
+                    if (!free(interpolate(from, to, (float)k / steps)))
+                        return false;
+            return true;
+        }
+
+        std::vector<int> order;
+        for (; stride >= 1; stride /= 2)
+            for (int k = stride; k < steps; k += 2 * stride)
+                order.push_back(k);
+        std::atomic<bool> blocked{false};
+        std::vector<long long> thread_checks(thread_count, 0);
+        std::vector<std::thread> workers;
+        for (int thread_id = 0; thread_id < thread_count; thread_id++)
+            workers.emplace_back([&, thread_id] {
+                for (size_t n = thread_id; n < order.size() && !blocked.load(std::memory_order_relaxed); n += thread_count) {
+                    thread_checks[thread_id]++;
+                    if (!configuration_free(robot, scene, interpolate(from, to, (float)order[n] / steps)))
+                        blocked = true;
+                }
+            });
+        for (auto& worker : workers)
+            worker.join();
+        checks += std::accumulate(thread_checks.begin(), thread_checks.end(), 0LL);
+        return !blocked;
+    }
+};
+
+// the edges are independent so they are spread across the cores, each thread with its own checker, free[e] = 1 when edge e is
+static long long check_edges(const Robot& robot, const CollisionScene& scene, double resolution, const std::vector<std::pair<Joints, Joints>>& edges,
+                             std::vector<uint8_t>& free) {
+    free.assign(edges.size(), 0);
+    if (edges.empty())
+        return 0;
+    const int thread_count = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), edges.size());
+    std::vector<long long> checks(thread_count, 0);
+    auto check_range = [&](int thread_id) {
+        ConfigurationChecker checker(robot, scene, resolution);
+        checker.split_long_edges = false;
+        for (size_t e = edges.size() * thread_id / thread_count; e < edges.size() * (thread_id + 1) / thread_count; e++)
+            free[e] = checker.edge_free(edges[e].first, edges[e].second);
+        checks[thread_id] = checker.checks;
+    };
+    if (thread_count == 1) {
+        check_range(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int thread_id = 0; thread_id < thread_count; thread_id++)
+            workers.emplace_back(check_range, thread_id);
+        for (auto& worker : workers)
+            worker.join();
+    }
+    return std::accumulate(checks.begin(), checks.end(), 0LL);
+}
+
+enum class Growth {
+    Trapped, // the first step is blocked
+    Advanced,
+    Reached
+};
+
+// grows the tree one step from its node nearest to towards, all the way when it's closer than a step
+static Growth extend(JointTree& tree, ConfigurationChecker& checker, const Joints& towards, const PlannerOptions& options) {
+    const int nearest = nearest_node(tree, towards);
+    const Joints from = tree.nodes[nearest];
+    const float distance = std::sqrt(distance_squared(from, towards));
+    const bool reaches = distance <= options.step;
+    const Joints next = reaches ? towards : interpolate(from, towards, (float)options.step / distance);
+    if (!checker.edge_free(from, next))
+        return Growth::Trapped;
+    insert_node(tree, next, nearest);
+    return reaches ? Growth::Reached : Growth::Advanced;
+}
+
+// the greedy half of RRT-Connect: keeps extending towards the same configuration until it gets there or hits something
+static Growth connect(JointTree& tree, ConfigurationChecker& checker, const Joints& towards, const PlannerOptions& options) {
+    Growth growth;
+    do
+        growth = extend(tree, checker, towards, options);
+    while (growth == Growth::Advanced);
+    return growth;
+}
+
+// the configuration at arc length s along the path and the waypoint it comes after
+static Joints point_at(const std::vector<Joints>& path, const std::vector<double>& lengths, double s, size_t& segment) {
+    segment = std::upper_bound(lengths.begin(), lengths.end(), s) - lengths.begin() - 1;
+    segment = std::min(segment, path.size() - 2);
+    const double length = lengths[segment + 1] - lengths[segment];
+    return interpolate(path[segment], path[segment + 1], length > 0.0 ? (float)((s - lengths[segment]) / length) : 0.f);
+}
+
+// random shortcuts, a whole batch validated at once across the cores: two random points along the path, anywhere on it and not only
+// at waypoints (RRT paths zigzag inside each edge too), replaced by the straight edge between them when it's free,
+// the valid ones are applied longest saving first as long as they don't overlap one already taken
+// ex: a path going around the pillar in 40 jagged waypoints ends up as a handful of straight edges hugging it
+static void shortcut(std::vector<Joints>& path, const Robot& robot, const CollisionScene& scene, const PlannerOptions& options, std::minstd_rand& random,
+                     long long& checks) {
+    struct Shortcut {
+        double from, to, saving;
+        Joints start, end;
+    };
+    for (int round = 0; round < options.shortcut_rounds && path.size() > 2; round++) {
+        std::vector<double> lengths(1, 0.0);
+        for (size_t i = 1; i < path.size(); i++)
+            lengths.push_back(lengths.back() + std::sqrt(distance_squared(path[i - 1], path[i])));
+        std::uniform_real_distribution<double> position(0.0, lengths.back());
+
+        std::vector<Shortcut> candidates;
+        std::vector<std::pair<Joints, Joints>> edges;
+        for (int attempt = 0; attempt < options.shortcut_batch; attempt++) {
+            double from = position(random), to = position(random);
+            if (from > to)
+                std::swap(from, to);
+            size_t from_segment, to_segment;
+            const Joints start = point_at(path, lengths, from, from_segment), end = point_at(path, lengths, to, to_segment);
+            if (from_segment == to_segment) // already straight in between
+                continue;
+            candidates.push_back({from, to, to - from - std::sqrt(distance_squared(start, end)), start, end});
+            edges.push_back({start, end});
+        }
+        std::vector<uint8_t> free;
+        checks += check_edges(robot, scene, options.resolution, edges, free);
+
+        std::vector<Shortcut> taken;
+        std::vector<size_t> order(candidates.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return candidates[a].saving > candidates[b].saving; });
+        for (size_t c : order) {
+            const Shortcut& candidate = candidates[c];
+            if (!free[c] || candidate.saving <= 1e-6)
+                continue;
+            if (std::none_of(taken.begin(), taken.end(), [&](const Shortcut& other) { return candidate.from < other.to && other.from < candidate.to; }))
+                taken.push_back(candidate);
+        }
+        if (taken.empty())
+            continue;
+
+        std::sort(taken.begin(), taken.end(), [](const Shortcut& a, const Shortcut& b) { return a.from < b.from; });
+        std::vector<Joints> shorter;
+        size_t waypoint = 0;
+        for (const Shortcut& cut : taken) {
+            for (; waypoint < path.size() && lengths[waypoint] < cut.from; waypoint++)
+                shorter.push_back(path[waypoint]);
+            shorter.push_back(cut.start);
+            shorter.push_back(cut.end);
+            while (waypoint < path.size() && lengths[waypoint] <= cut.to)
+                waypoint++;
+        }
+        shorter.insert(shorter.end(), path.begin() + waypoint, path.end());
+        path = std::move(shorter);
+    }
+}
+
+#pragma region planner
+double path_length(const std::vector<std::array<float, 6>>& path) {
+    double length = 0.0;
+    for (size_t i = 1; i < path.size(); i++)
+        length += std::sqrt(distance_squared(path[i - 1], path[i]));
+    return length;
+}
+
+// RRT-Connect (Kuffner & LaValle 2000): each round one tree extends a step towards a random configuration and the other one then
+// connects greedily towards the new node, the trees swap roles every round, the path is found the moment they touch,
+// the straight edge is tried first (most motions in an open cell need no planning at all, and the longest edge is split across the cores),
+// then the jagged path is shortcut and comes out as few waypoints joined by straight joint space edges
+PlanResult plan_motion(const Robot& robot, const CollisionScene& scene, const std::array<float, 6>& start, const std::array<float, 6>& goal,
+                       const PlannerOptions& options) {
+    const auto planning_start = std::chrono::steady_clock::now();
+    auto elapsed = [](auto since) { return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count(); };
+    PlanResult result;
+    ConfigurationChecker checker(robot, scene, options.resolution);
+    std::minstd_rand random(options.seed);
+
+    if (!checker.free(start))
+        result.status = PlanStatus::StartColliding;
+    else if (!checker.free(goal))
+        result.status = PlanStatus::GoalColliding;
+    else if (checker.edge_free(start, goal)) {
+        result.status = PlanStatus::Found;
+        result.path = {start, goal};
+    } else {
+        JointTree start_tree, goal_tree;
+        insert_node(start_tree, start, -1);
+        insert_node(goal_tree, goal, -1);
+        JointTree* growing = &start_tree;
+        JointTree* connecting = &goal_tree;
+        std::array<std::uniform_real_distribution<float>, 6> joints;
+        for (int i = 0; i < 6; i++)
+            joints[i] = std::uniform_real_distribution<float>((float)robot.axes[i].minimum, (float)robot.axes[i].maximum);
+
+        for (int iteration = 0; start_tree.nodes.size() + goal_tree.nodes.size() < (size_t)options.max_nodes; iteration++) {
+            if (iteration % 64 == 0 && elapsed(planning_start) > options.max_milliseconds)
+                break;
+            Joints sample;
+            for (int i = 0; i < 6; i++)
+                sample[i] = joints[i](random);
+            if (extend(*growing, checker, sample, options) != Growth::Trapped
+                && connect(*connecting, checker, growing->nodes.back(), options) == Growth::Reached) {
+                // both trees end on the same configuration, walk each one back to its root and join them there
+                std::vector<Joints> from_start, from_goal;
+                for (int node = (int)start_tree.nodes.size() - 1; node >= 0; node = start_tree.parents[node])
+                    from_start.push_back(start_tree.nodes[node]);
+                for (int node = (int)goal_tree.nodes.size() - 1; node >= 0; node = goal_tree.parents[node])
+                    from_goal.push_back(goal_tree.nodes[node]);
+                result.path.assign(from_start.rbegin(), from_start.rend());
+                result.path.insert(result.path.end(), from_goal.begin() + 1, from_goal.end());
+                result.status = PlanStatus::Found;
+                break;
+            }
+            std::swap(growing, connecting);
+        }
+        result.nodes = (int)(start_tree.nodes.size() + goal_tree.nodes.size());
+    }
+    result.collision_checks = checker.checks;
+    result.planning_milliseconds = elapsed(planning_start);
+
+    const auto smoothing_start = std::chrono::steady_clock::now();
+    if (result.status == PlanStatus::Found)
+        shortcut(result.path, robot, scene, options, random, result.collision_checks);
+    result.smoothing_milliseconds = elapsed(smoothing_start);
+    return result;
+}
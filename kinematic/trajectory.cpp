@@ -0,0 +1,147 @@
+#include "kinematic.hpp"
+
+#pragma region trajectory utils
+// rest to rest over a distance of 1 (the edge's parameter) with the given limits, jerk 0 = unlimited, closed form
+// (Biagiotti & Melchiorri, Trajectory Planning for Automatic Machines and Robots 3.4):
+// - the acceleration phase reaches the velocity limit either through the acceleration limit (a jerk ramp, a flat top, a jerk ramp)
+//   or before it (two jerk ramps, acceleration peaking below the limit),
+// - whatever distance the speeding up and braking leave is cruised at the velocity limit,
+// - an edge too short to cruise peaks lower instead: acceleration limit still reached or not, same two cases
+// ex: an edge moving one joint by 2 at velocity 1.5, acceleration 3, jerk 15 (0.75, 1.5, 7.5 on the parameter)
+//     -> 0.2 s jerk ramps, 0.7 s speeding up, 0.63 s cruising, 2.03 s in all
+static SCurve s_curve(double velocity, double acceleration, double jerk) {
+    const bool jerk_limited = jerk > 0.0;
+    double jerk_time, acceleration_time;
+    if (!jerk_limited || velocity * jerk >= acceleration * acceleration) {
+        jerk_time = jerk_limited ? acceleration / jerk : 0.0;
+        acceleration_time = jerk_time + velocity / acceleration;
+    } else {
+        jerk_time = std::sqrt(velocity / jerk);
+        acceleration_time = 2.0 * jerk_time;
+    }
+    double cruise_time = 1.0 / velocity - acceleration_time;
+    if (cruise_time < 0.0) {
+        cruise_time = 0.0;
+        if (!jerk_limited || 1.0 >= 2.0 * acceleration * acceleration * acceleration / (jerk * jerk)) {
+            jerk_time = jerk_limited ? acceleration / jerk : 0.0;
+            acceleration_time = jerk_time / 2.0 + std::sqrt(jerk_time * jerk_time / 4.0 + 1.0 / acceleration);
+        } else {
+            jerk_time = std::cbrt(1.0 / (2.0 * jerk));
+            acceleration_time = 2.0 * jerk_time;
+        }
+    }
+    SCurve profile;
+    profile.jerk = jerk;
+    profile.acceleration = jerk_limited ? jerk * jerk_time : acceleration;
+    profile.velocity = (acceleration_time - jerk_time) * profile.acceleration;
+    profile.jerk_time = jerk_time;
+    profile.acceleration_time = acceleration_time;
+    profile.cruise_time = cruise_time;
+    profile.duration = 2.0 * acceleration_time + cruise_time;
+    return profile;
+}
+
+// position, velocity and acceleration along the edge's parameter while speeding up, time from the segment's start
+static void speeding_up(const SCurve& profile, double time, double& position, double& velocity, double& acceleration) {
+    const double jerk_time = profile.jerk_time, acceleration_time = profile.acceleration_time;
+    if (time < jerk_time) {
+        position = profile.jerk * time * time * time / 6.0;
+        velocity = profile.jerk * time * time / 2.0;
+        acceleration = profile.jerk * time;
+    } else if (time < acceleration_time - jerk_time) {
+        position = profile.acceleration / 6.0 * (3.0 * time * time - 3.0 * jerk_time * time + jerk_time * jerk_time);
+        velocity = profile.acceleration * (time - jerk_time / 2.0);
+        acceleration = profile.acceleration;
+    } else {
+        const double left = acceleration_time - time;
+        position = profile.velocity * acceleration_time / 2.0 - profile.velocity * left + profile.jerk * left * left * left / 6.0;
+        velocity = profile.velocity - profile.jerk * left * left / 2.0;
+        acceleration = profile.jerk * left;
+    }
+}
+
+// braking mirrors speeding up: the state time t before the end is the speeding up state t after the start, position from the far end
+static TrajectorySample sample_segment(const TrajectorySegment& segment, double time) {
+    const SCurve& profile = segment.profile;
+    const double local = std::clamp(time - segment.start_time, 0.0, profile.duration);
+    double position, velocity, acceleration;
+    if (local <= profile.acceleration_time) {
+        speeding_up(profile, local, position, velocity, acceleration);
+    } else if (local <= profile.acceleration_time + profile.cruise_time) {
+        position = profile.velocity * (profile.acceleration_time / 2.0 + local - profile.acceleration_time);
+        velocity = profile.velocity;
+        acceleration = 0.0;
+    } else {
+        speeding_up(profile, profile.duration - local, position, velocity, acceleration);
+        position = 1.0 - position;
+        acceleration = -acceleration;
+    }
+    TrajectorySample sample;
+    sample.time = time;
+    for (int i = 0; i < 6; i++) {
+        const double distance = segment.to[i] - segment.from[i];
+        sample.position[i] = (float)(segment.from[i] + distance * position);
+        sample.velocity[i] = (float)(distance * velocity);
+        sample.acceleration[i] = (float)(distance * acceleration);
+    }
+    return sample;
+}
+
+#pragma region trajectory
+// per edge the limits are brought onto its 0 to 1 parameter, joint i covers distance d_i so the parameter may go at most
+// max_velocity_i / d_i, same for acceleration and jerk, the smallest over the joints that move binds all of them,
+// the result is a few numbers per edge, generating it is nothing next to sampling it
+// ex: an edge moving axis 1 by 1.5 and axis 2 by 0.3 runs at axis 1's pace, axis 2 at a fifth of its limits
+Trajectory time_parameterize(const Robot& robot, const std::vector<std::array<float, 6>>& path, double speed_scale) {
+    if (speed_scale <= 0.0)
+        throw std::runtime_error("time_parameterize needs a positive speed scale");
+    Trajectory trajectory;
+    for (size_t i = 1; i < path.size(); i++) {
+        double velocity = std::numeric_limits<double>::infinity(), acceleration = velocity, jerk = velocity;
+        for (int j = 0; j < 6; j++) {
+            const double distance = std::abs(path[i][j] - path[i - 1][j]);
+            if (distance == 0.0)
+                continue;
+            const Axis& axis = robot.axes[j];
+            velocity = std::min(velocity, axis.max_velocity * speed_scale / distance);
+            acceleration = std::min(acceleration, axis.max_acceleration * speed_scale * speed_scale / distance);
+            if (axis.max_jerk > 0.0)
+                jerk = std::min(jerk, axis.max_jerk * speed_scale * speed_scale * speed_scale / distance);
+        }
+        if (std::isinf(velocity)) // the same waypoint twice
+            continue;
+        TrajectorySegment segment{path[i - 1], path[i], trajectory.duration, s_curve(velocity, acceleration, std::isinf(jerk) ? 0.0 : jerk)};
+        trajectory.duration += segment.profile.duration;
+        trajectory.segments.push_back(segment);
+    }
+    // a path that doesn't move still has somewhere to be
+    if (trajectory.segments.empty() && !path.empty())
+        trajectory.segments.push_back({path[0], path[0], 0.0, SCurve{}});
+    return trajectory;
+}
+
+TrajectorySample sample_trajectory(const Trajectory& trajectory, double time) {
+    if (trajectory.segments.empty())
+        throw std::runtime_error("sample_trajectory on an empty trajectory");
+    time = std::clamp(time, 0.0, trajectory.duration);
+    auto after = std::upper_bound(trajectory.segments.begin(), trajectory.segments.end(), time,
+                                  [](double time, const TrajectorySegment& segment) { return time < segment.start_time; });
+    return sample_segment(*std::prev(after), time);
+}
+
+// in one pass, the segment only ever moves forward
+void sample_trajectory(const Trajectory& trajectory, double period, std::vector<TrajectorySample>& samples) {
+    if (trajectory.segments.empty())
+        throw std::runtime_error("sample_trajectory on an empty trajectory");
+    if (period <= 0.0)
+        throw std::runtime_error("sample_trajectory needs a positive period");
+    const long long count = (long long)std::ceil(trajectory.duration / period - 1e-9) + 1;
+    samples.resize(count);
+    size_t segment = 0;
+    for (long long k = 0; k < count; k++) {
+        const double time = std::min(k * period, trajectory.duration);
+        while (segment + 1 < trajectory.segments.size() && trajectory.segments[segment + 1].start_time <= time)
+            segment++;
+        samples[k] = sample_segment(trajectory.segments[segment], time);
+    }
+}
@@ -0,0 +1,279 @@
+#include "kinematic.hpp"
+
+#pragma region workspace utils
+// configurations each map_workspace work unit draws, pushes through the batch kernel and bins, small enough to stay in cache
+// (6 + 9 floats each), each chunk seeds its own random stream from its index so the map doesn't depend on how many threads built it
+constexpr int workspace_chunk = 4096;
+
+// the chain's constants in floats, broadcast once per batch instead of once per configuration
+struct BatchChain {
+    float base_rotation[3][3], base_translation[3];
+    bool linear[6];
+    float pivot[6][3], normal[6][3];
+    float tip_position[3], tip_align[3], tip_side[3];
+};
+
+static BatchChain batch_chain(const Robot& robot, const Target& tip_target) {
+    BatchChain chain;
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++)
+            chain.base_rotation[row][column] = (float)robot.transform(row, column);
+        chain.base_translation[row] = (float)robot.transform(row, 3);
+    }
+    const Eigen::Matrix3d tip_orientation = fromAlignRoll(tip_target.align, tip_target.roll).toRotationMatrix();
+    for (int i = 0; i < 6; i++) {
+        chain.linear[i] = robot.axes[i].kind == Axis::Kind::Linear;
+        const Eigen::Vector3d normal = robot.axes[i].pivotNormal.normalized();
+        for (int j = 0; j < 3; j++) {
+            chain.pivot[i][j] = (float)robot.axes[i].pivot[j];
+            chain.normal[i][j] = (float)normal[j];
+        }
+    }
+    for (int j = 0; j < 3; j++) {
+        chain.tip_position[j] = (float)tip_target.position[j];
+        chain.tip_align[j] = (float)tip_orientation(j, 2);
+        chain.tip_side[j] = (float)tip_orientation(j, 0);
+    }
+    return chain;
+}
+
+// one configuration the plain way, for the batch's tail that doesn't fill a register and machines without AVX2,
+// the same Rodrigues construction as the vector path so both sides of the tail agree
+static void forward_one(const BatchChain& chain, const JointBatch& batch, PoseBatch& poses, size_t c) {
+    float r[3][3], t[3];
+    std::copy(&chain.base_rotation[0][0], &chain.base_rotation[0][0] + 9, &r[0][0]);
+    std::copy(chain.base_translation, chain.base_translation + 3, t);
+    for (int i = 0; i < 6; i++) {
+        const float q = batch.joints[i][c];
+        const float p[3] = {chain.pivot[i][0] + (chain.linear[i] ? q : 0.f), chain.pivot[i][1], chain.pivot[i][2]};
+        for (int row = 0; row < 3; row++)
+            t[row] += r[row][0] * p[0] + r[row][1] * p[1] + r[row][2] * p[2];
+        if (chain.linear[i])
+            continue;
+        const float s = std::sin(q), k = std::cos(q), v = 1.f - k;
+        const float nx = chain.normal[i][0], ny = chain.normal[i][1], nz = chain.normal[i][2];
+        const float rq[3][3] = {{k + v * nx * nx, v * nx * ny - s * nz, v * nx * nz + s * ny},
+                                {v * nx * ny + s * nz, k + v * ny * ny, v * ny * nz - s * nx},
+                                {v * nx * nz - s * ny, v * ny * nz + s * nx, k + v * nz * nz}};
+        float previous[3][3];
+        std::copy(&r[0][0], &r[0][0] + 9, &previous[0][0]);
+        for (int row = 0; row < 3; row++)
+            for (int column = 0; column < 3; column++)
+                r[row][column] = previous[row][0] * rq[0][column] + previous[row][1] * rq[1][column] + previous[row][2] * rq[2][column];
+    }
+    auto rotate = [&](const float* v, int row) { return r[row][0] * v[0] + r[row][1] * v[1] + r[row][2] * v[2]; };
+    poses.x[c] = rotate(chain.tip_position, 0) + t[0];
+    poses.y[c] = rotate(chain.tip_position, 1) + t[1];
+    poses.z[c] = rotate(chain.tip_position, 2) + t[2];
+    poses.align_x[c] = rotate(chain.tip_align, 0);
+    poses.align_y[c] = rotate(chain.tip_align, 1);
+    poses.align_z[c] = rotate(chain.tip_align, 2);
+    poses.side_x[c] = rotate(chain.tip_side, 0);
+    poses.side_y[c] = rotate(chain.tip_side, 1);
+    poses.side_z[c] = rotate(chain.tip_side, 2);
+}
+
+#ifdef __AVX2__
+// sine and cosine of 8 angles at once, there is no vector std::sin: the angle is brought back to [-π, π] (minus the nearest whole turn),
+// folded onto [-π/2, π/2] where sin(π - x) = sin(x) and cos(π - x) = -cos(x), then Taylor series up to x¹¹ and x¹², under 1e-7 off there,
+// float's own precision
+// ex: 3 rad -> folded to π - 3 = 0.14, sin = sin(0.14) = 0.141, cos = -cos(0.14) = -0.990
+static void sincos_ps(__m256 angle, __m256& sine, __m256& cosine) {
+    const __m256 turns = _mm256_round_ps(_mm256_mul_ps(angle, _mm256_set1_ps(0.5f / (float)M_PI)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 x = _mm256_sub_ps(angle, _mm256_mul_ps(turns, _mm256_set1_ps(2.f * (float)M_PI)));
+    const __m256 half_pi = _mm256_set1_ps(0.5f * (float)M_PI), pi = _mm256_set1_ps((float)M_PI);
+    const __m256 above = _mm256_cmp_ps(x, half_pi, _CMP_GT_OQ), below = _mm256_cmp_ps(x, _mm256_sub_ps(_mm256_setzero_ps(), half_pi), _CMP_LT_OQ);
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(pi, x), above);
+    x = _mm256_blendv_ps(x, _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), pi), x), below);
+    const __m256 x2 = _mm256_mul_ps(x, x);
+    auto horner = [&](std::initializer_list<float> coefficients) {
+        __m256 sum = _mm256_setzero_ps();
+        for (float coefficient : coefficients)
+            sum = _mm256_add_ps(_mm256_mul_ps(sum, x2), _mm256_set1_ps(coefficient));
+        return sum;
+    };
+    sine = _mm256_mul_ps(x, horner({-1.f / 39916800.f, 1.f / 362880.f, -1.f / 5040.f, 1.f / 120.f, -1.f / 6.f, 1.f}));
+    cosine = horner({1.f / 479001600.f, -1.f / 3628800.f, 1.f / 40320.f, -1.f / 720.f, 1.f / 24.f, -1.f / 2.f, 1.f});
+    // folded angles come back with their cosine's sign flipped
+    cosine = _mm256_blendv_ps(cosine, _mm256_sub_ps(_mm256_setzero_ps(), cosine), _mm256_or_ps(above, below));
+}
+
+// 8 configurations from c on: every coefficient of the cumulative rotation and translation is a register holding it for all 8,
+// a rotary link builds its Rodrigues rotation Rq = cos·I + sin·[n]× + (1 - cos)·n nᵀ lane by lane (n is the same for all 8),
+// then R·Rq and t += R·pivot exactly like the scalar chain
+static void forward_eight(const BatchChain& chain, const JointBatch& batch, PoseBatch& poses, size_t c) {
+    __m256 r[3][3], t[3];
+    for (int row = 0; row < 3; row++) {
+        for (int column = 0; column < 3; column++)
+            r[row][column] = _mm256_set1_ps(chain.base_rotation[row][column]);
+        t[row] = _mm256_set1_ps(chain.base_translation[row]);
+    }
+    auto multiply_add = [](__m256 a, __m256 b, __m256 sum) { return _mm256_add_ps(_mm256_mul_ps(a, b), sum); };
+    for (int i = 0; i < 6; i++) {
+        const __m256 q = _mm256_loadu_ps(batch.joints[i].data() + c);
+        __m256 p[3] = {_mm256_set1_ps(chain.pivot[i][0]), _mm256_set1_ps(chain.pivot[i][1]), _mm256_set1_ps(chain.pivot[i][2])};
+        if (chain.linear[i])
+            p[0] = _mm256_add_ps(p[0], q);
+        for (int row = 0; row < 3; row++)
+            t[row] = multiply_add(r[row][0], p[0], multiply_add(r[row][1], p[1], multiply_add(r[row][2], p[2], t[row])));
+        if (chain.linear[i])
+            continue;
+        __m256 s, k;
+        sincos_ps(q, s, k);
+        const __m256 v = _mm256_sub_ps(_mm256_set1_ps(1.f), k);
+        const float nx = chain.normal[i][0], ny = chain.normal[i][1], nz = chain.normal[i][2];
+        auto entry = [&](float outer, float cross) {
+            return _mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(outer)), _mm256_mul_ps(s, _mm256_set1_ps(cross)));
+        };
+        const __m256 rq[3][3] = {{_mm256_add_ps(k, entry(nx * nx, 0.f)), entry(nx * ny, -nz), entry(nx * nz, ny)},
+                                 {entry(nx * ny, nz), _mm256_add_ps(k, entry(ny * ny, 0.f)), entry(ny * nz, -nx)},
+                                 {entry(nx * nz, -ny), entry(ny * nz, nx), _mm256_add_ps(k, entry(nz * nz, 0.f))}};
+        for (int row = 0; row < 3; row++) {
+            const __m256 previous[3] = {r[row][0], r[row][1], r[row][2]};
+            for (int column = 0; column < 3; column++)
+                r[row][column] = multiply_add(previous[0], rq[0][column], multiply_add(previous[1], rq[1][column], _mm256_mul_ps(previous[2], rq[2][column])));
+        }
+    }
+    auto rotate = [&](const float* v, int row) {
+        return multiply_add(r[row][0], _mm256_set1_ps(v[0]), multiply_add(r[row][1], _mm256_set1_ps(v[1]), _mm256_mul_ps(r[row][2], _mm256_set1_ps(v[2]))));
+    };
+    _mm256_storeu_ps(poses.x.data() + c, _mm256_add_ps(rotate(chain.tip_position, 0), t[0]));
+    _mm256_storeu_ps(poses.y.data() + c, _mm256_add_ps(rotate(chain.tip_position, 1), t[1]));
+    _mm256_storeu_ps(poses.z.data() + c, _mm256_add_ps(rotate(chain.tip_position, 2), t[2]));
+    _mm256_storeu_ps(poses.align_x.data() + c, rotate(chain.tip_align, 0));
+    _mm256_storeu_ps(poses.align_y.data() + c, rotate(chain.tip_align, 1));
+    _mm256_storeu_ps(poses.align_z.data() + c, rotate(chain.tip_align, 2));
+    _mm256_storeu_ps(poses.side_x.data() + c, rotate(chain.tip_side, 0));
+    _mm256_storeu_ps(poses.side_y.data() + c, rotate(chain.tip_side, 1));
+    _mm256_storeu_ps(poses.side_z.data() + c, rotate(chain.tip_side, 2));
+}
+#endif
+
+// configurations [begin, end) on the calling thread, 8 at a time then the tail one by one
+static void forward_range(const BatchChain& chain, const JointBatch& batch, PoseBatch& poses, size_t begin, size_t end) {
+    size_t c = begin;
+#ifdef __AVX2__
+    for (; c + 8 <= end; c += 8)
+        forward_eight(chain, batch, poses, c);
+#endif
+    for (; c < end; c++)
+        forward_one(chain, batch, poses, c);
+}
+
+static void resize_poses(PoseBatch& poses, size_t count) {
+    for (std::vector<float>* component : {&poses.x, &poses.y, &poses.z, &poses.align_x, &poses.align_y, &poses.align_z, &poses.side_x, &poses.side_y, &poses.side_z})
+        component->resize(count);
+}
+
+// one of 64 equal-area bins on the sphere of directions: 8 bands of the vertical component (equal heights on a sphere cut equal areas,
+// Archimedes' hat-box theorem) times the 8 octants around the vertical, told apart by signs and which horizontal component is larger
+// so there's no atan2 per sample
+// ex: (0, 1, 0) straight up -> top band, (1, 0, 0) and (-1, 0, 0) -> same middle band, opposite octants
+static int direction_bin(float x, float y, float z) {
+    const int band = std::clamp((int)((y + 1.f) * 4.f), 0, 7);
+    const int octant = (x < 0.f) * 4 + (z < 0.f) * 2 + (std::abs(x) > std::abs(z));
+    return band * 8 + octant;
+}
+
+#pragma region workspace
+// batch.joints all the same length, poses resized to it, the configurations are split in contiguous runs of whole registers
+// across the cores (std::threads like the sonar's heavy loops), each thread writing only its own run
+void forward_batch(const Robot& robot, const Target& tip_target, const JointBatch& batch, PoseBatch& poses) {
+    const size_t count = batch.joints[0].size();
+    for (const auto& joint : batch.joints)
+        if (joint.size() != count)
+            throw std::runtime_error("forward_batch needs as many values for every joint");
+    resize_poses(poses, count);
+    const BatchChain chain = batch_chain(robot, tip_target);
+    const size_t registers = (count + 7) / 8;
+    const int thread_count = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), std::max<size_t>(registers / 1024, 1));
+    if (thread_count == 1) {
+        forward_range(chain, batch, poses, 0, count);
+        return;
+    }
+    std::vector<std::thread> workers;
+    for (int thread_id = 0; thread_id < thread_count; thread_id++)
+        workers.emplace_back([&, thread_id] {
+            forward_range(chain, batch, poses, std::min(count, registers * thread_id / thread_count * 8), std::min(count, registers * (thread_id + 1) / thread_count * 8));
+        });
+    for (auto& worker : workers)
+        worker.join();
+}
+
+// sample_count configurations drawn uniformly within the joint limits, pushed through the batch kernel chunk by chunk and binned:
+// the count of tips per voxel is the reachability, the direction bits the dexterity, the cube is centered on the robot's base and
+// big enough for the arm stretched out in any direction (every pivot and the tip end to end, plus the farthest a linear axis slides),
+// each thread fills its own map and they are summed at the end, there are no atomics in the binning loop
+WorkspaceMap map_workspace(const Robot& robot, const Target& tip_target, long long sample_count, int resolution, uint32_t seed) {
+    if (resolution <= 0 || sample_count <= 0)
+        throw std::runtime_error("map_workspace needs a positive resolution and sample count");
+    WorkspaceMap map;
+    map.resolution = resolution;
+    map.sample_count = sample_count;
+    double reach = tip_target.position.norm();
+    for (const Axis& axis : robot.axes)
+        reach += axis.pivot.norm() + (axis.kind == Axis::Kind::Linear ? std::max(std::abs(axis.minimum), std::abs(axis.maximum)) : 0.0);
+    map.minimum = robot.transform.block<3,1>(0,3) - Eigen::Vector3d::Constant(reach);
+    map.voxel_size = 2.0 * reach / resolution;
+    const size_t voxel_count = (size_t)resolution * resolution * resolution;
+
+    const BatchChain chain = batch_chain(robot, tip_target);
+    const long long chunk_count = (sample_count + workspace_chunk - 1) / workspace_chunk;
+    const int thread_count = (int)std::min<long long>(std::max(1u, std::thread::hardware_concurrency()), chunk_count);
+    std::vector<std::vector<uint32_t>> thread_counts(thread_count);
+    std::vector<std::vector<uint64_t>> thread_directions(thread_count);
+    auto work = [&](int thread_id) {
+        std::vector<uint32_t>& counts = thread_counts[thread_id];
+        std::vector<uint64_t>& directions = thread_directions[thread_id];
+        counts.assign(voxel_count, 0);
+        directions.assign(voxel_count, 0);
+        JointBatch batch;
+        PoseBatch poses;
+        for (long long chunk_id = thread_id; chunk_id < chunk_count; chunk_id += thread_count) {
+            const size_t count = (size_t)std::min<long long>(workspace_chunk, sample_count - chunk_id * workspace_chunk);
+            std::seed_seq sequence{seed, (uint32_t)chunk_id};
+            std::minstd_rand random(sequence);
+            for (int i = 0; i < 6; i++) {
+                std::uniform_real_distribution<float> joint((float)robot.axes[i].minimum, (float)robot.axes[i].maximum);
+                batch.joints[i].resize(count);
+                for (float& value : batch.joints[i])
+                    value = joint(random);
+            }
+            resize_poses(poses, count);
+            forward_range(chain, batch, poses, 0, count);
+            const float inverse_size = (float)(1.0 / map.voxel_size);
+            for (size_t c = 0; c < count; c++) {
+                const int vx = (int)((poses.x[c] - (float)map.minimum.x()) * inverse_size);
+                const int vy = (int)((poses.y[c] - (float)map.minimum.y()) * inverse_size);
+                const int vz = (int)((poses.z[c] - (float)map.minimum.z()) * inverse_size);
+                if (vx < 0 || vy < 0 || vz < 0 || vx >= resolution || vy >= resolution || vz >= resolution)
+                    continue;
+                const size_t voxel = ((size_t)vz * resolution + vy) * resolution + vx;
+                counts[voxel]++;
+                directions[voxel] |= uint64_t(1) << direction_bin(poses.align_x[c], poses.align_y[c], poses.align_z[c]);
+            }
+        }
+    };
+    if (thread_count == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> workers;
+        for (int thread_id = 0; thread_id < thread_count; thread_id++)
+            workers.emplace_back(work, thread_id);
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    map.counts = std::move(thread_counts[0]);
+    map.directions = std::move(thread_directions[0]);
+    for (int thread_id = 1; thread_id < thread_count; thread_id++)
+        for (size_t voxel = 0; voxel < voxel_count; voxel++) {
+            map.counts[voxel] += thread_counts[thread_id][voxel];
+            map.directions[voxel] |= thread_directions[thread_id][voxel];
+        }
+    return map;
+}
+
+float voxel_dexterity(const WorkspaceMap& map, size_t voxel) {
+    return std::popcount(map.directions[voxel]) / 64.f;
+}
@@ -3,24 +3,33 @@
 #include <Eigen/Dense>
 #include <algorithm>
 #include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <functional>
+#include <immintrin.h>
 #include <iostream>
 #include <limits>
 #include <list>
+#include <memory>
 #include <numeric>
+#include <optional>
 #include <random>
 #include <raylib.h>
 #include <raymath.h>
 #include <regex>
 #include <rlgl.h>
+#include <sstream>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -0,0 +1,295 @@
+#include "ppi.hpp"
+
+#pragma region array utils
+// every target radiates a few tonals (engine and propeller lines, the same frequencies for the whole run, that's its signature)
+// on top of broadband flow noise, broadband is approximated by a handful of tones at random frequencies with fresh phases every frame,
+// levels are in dB over the ambient noise of one hydrophone sample (σ = 1), so a target sits well below the noise on any single element,
+// only the array gain (128 elements) and the FFT gain (512 samples into 8 Hz bins) pull it out
+constexpr int tonalCount = 3;
+constexpr int broadbandToneCount = 8;
+constexpr float sourceLevelDecibels = 32.f; // puts contacts at 50 to 100 km some 10 to 15 dB over the background
+constexpr float broadbandLevelDecibels = -8.f; // each broadband tone relative to a tonal
+constexpr float detectionThresholdDecibels = 3.f; // beam power over the background, ~4σ of the noise-only fluctuation
+constexpr int beamHalfWidthBins = 10; // ±5°, roughly the main lobe of the circular array at mid band
+
+// one sinusoid arriving as a plane wave from (directionEast, directionNorth), phase at the frame's first sample on the array center
+struct ArrivingTone {
+    float amplitude, hertz, phase;
+    float directionEast, directionNorth;
+};
+
+// circular: elements evenly spaced on a ring, linear: a straight line across our ship (athwartships) centered on it,
+// east-west when heading north and turning with the ship, so the side it can't tell apart follows the heading,
+// half a wavelength apart at the top of the band either way
+static void placeElements(PassiveArray& array, float soundSpeed, float headingDegrees)
+{
+    constexpr int elementCount = PassiveArray::elementCount;
+    float spacingMeters = soundSpeed / (2.f * PassiveArray::highestHertz);
+    for (int elementId = 0; elementId < elementCount; ++elementId) {
+        if (array.geometry == ArrayGeometry::Circular) {
+            float ringRadius = elementCount * spacingMeters / (2.f * (float)M_PI);
+            float angle = elementId * 2.f * (float)M_PI / elementCount;
+            array.elementEastMeters[elementId] = ringRadius * std::sin(angle);
+            array.elementNorthMeters[elementId] = ringRadius * std::cos(angle);
+        } else {
+            float offsetMeters = (elementId - (elementCount - 1) / 2.f) * spacingMeters;
+            array.elementEastMeters[elementId] = offsetMeters * std::cos(headingDegrees * DEG2RAD);
+            array.elementNorthMeters[elementId] = -offsetMeters * std::sin(headingDegrees * DEG2RAD);
+        }
+    }
+}
+
+// a plane wave from direction u reaches an element at position p earlier by p·u / c than the array center,
+// so its delay is -p·u / c (negative = ahead of the center)
+static float elementDelaySeconds(const PassiveArray& array, int elementId, float directionEast, float directionNorth, float soundSpeed)
+{
+    return -(array.elementEastMeters[elementId] * directionEast + array.elementNorthMeters[elementId] * directionNorth) / soundSpeed;
+}
+
+// adds every tone to the time series of every element, time-major (sample n of element m at [n * elementCount + m]),
+// a delayed sinusoid is a rotating phasor: one complex multiply per sample per element instead of a sin(),
+// the inner loop runs over the 128 elements with no dependency between them so it compiles to AVX
+static void synthesizeTones(const PassiveArray& array, const std::vector<ArrivingTone>& tones, int firstTone, int toneStride, float soundSpeed,
+    std::vector<float>& timeSeries)
+{
+    constexpr int elementCount = PassiveArray::elementCount;
+    std::array<float, elementCount> phasorReal, phasorImag;
+    for (int toneId = firstTone; toneId < (int)tones.size(); toneId += toneStride) {
+        const ArrivingTone& tone = tones[toneId];
+        for (int elementId = 0; elementId < elementCount; ++elementId) {
+            float delay = elementDelaySeconds(array, elementId, tone.directionEast, tone.directionNorth, soundSpeed);
+            float phase = tone.phase - 2.f * (float)M_PI * tone.hertz * delay;
+            phasorReal[elementId] = tone.amplitude * std::cos(phase);
+            phasorImag[elementId] = tone.amplitude * std::sin(phase);
+        }
+        float stepAngle = 2.f * (float)M_PI * tone.hertz / PassiveArray::sampleRateHertz;
+        float stepReal = std::cos(stepAngle), stepImag = std::sin(stepAngle);
+        for (int sampleId = 0; sampleId < PassiveArray::sampleCount; ++sampleId) {
+            float* samples = timeSeries.data() + sampleId * elementCount;
+            for (int elementId = 0; elementId < elementCount; ++elementId) {
+                samples[elementId] += phasorReal[elementId];
+                float real = phasorReal[elementId] * stepReal - phasorImag[elementId] * stepImag;
+                phasorImag[elementId] = phasorReal[elementId] * stepImag + phasorImag[elementId] * stepReal;
+                phasorReal[elementId] = real;
+            }
+        }
+    }
+}
+
+// conventional (delay-and-sum) beamforming done in the frequency domain: a delay is a phase ramp there, so steering at a bearing
+// means multiplying each element's spectrum by e^(+2πi·f·τ) to undo its delay, then summing the elements,
+// sound from that bearing adds up in phase (power x 128²), noise and other bearings add up with random phases (power x 128),
+// the steering phasor of the next bin is the previous one times e^(2πi·Δf·τ), so no sin/cos in the loop,
+// elements are processed 8 at a time in AVX registers, returns the beam power summed over the band
+static float beamPower(const PassiveArray& array, int firstBin, int binCount, float bearingDegrees, float soundSpeed)
+{
+    constexpr int elementCount = PassiveArray::elementCount;
+    constexpr float binHertz = PassiveArray::sampleRateHertz / PassiveArray::sampleCount;
+    alignas(32) std::array<float, elementCount> steeringReal, steeringImag, stepReal, stepImag;
+    float directionEast = std::sin(bearingDegrees * DEG2RAD), directionNorth = std::cos(bearingDegrees * DEG2RAD);
+    for (int elementId = 0; elementId < elementCount; ++elementId) {
+        float delay = elementDelaySeconds(array, elementId, directionEast, directionNorth, soundSpeed);
+        float phase = 2.f * (float)M_PI * firstBin * binHertz * delay;
+        float step = 2.f * (float)M_PI * binHertz * delay;
+        steeringReal[elementId] = std::cos(phase);
+        steeringImag[elementId] = std::sin(phase);
+        stepReal[elementId] = std::cos(step);
+        stepImag[elementId] = std::sin(step);
+    }
+
+    float power = 0.f;
+    for (int bandBin = 0; bandBin < binCount; ++bandBin) {
+        const float* spectrumReal = array.spectrumReal.data() + bandBin * elementCount;
+        const float* spectrumImag = array.spectrumImag.data() + bandBin * elementCount;
+        float sumReal = 0.f, sumImag = 0.f;
+        int elementId = 0;
+#ifdef __AVX2__
+        __m256 accumulatorReal = _mm256_setzero_ps(), accumulatorImag = _mm256_setzero_ps();
+        for (; elementId + 8 <= elementCount; elementId += 8) {
+            __m256 xReal = _mm256_loadu_ps(spectrumReal + elementId), xImag = _mm256_loadu_ps(spectrumImag + elementId);
+            __m256 sReal = _mm256_load_ps(steeringReal.data() + elementId), sImag = _mm256_load_ps(steeringImag.data() + elementId);
+            accumulatorReal = _mm256_add_ps(accumulatorReal, _mm256_sub_ps(_mm256_mul_ps(xReal, sReal), _mm256_mul_ps(xImag, sImag)));
+            accumulatorImag = _mm256_add_ps(accumulatorImag, _mm256_add_ps(_mm256_mul_ps(xReal, sImag), _mm256_mul_ps(xImag, sReal)));
+            __m256 dReal = _mm256_load_ps(stepReal.data() + elementId), dImag = _mm256_load_ps(stepImag.data() + elementId);
+            _mm256_store_ps(steeringReal.data() + elementId, _mm256_sub_ps(_mm256_mul_ps(sReal, dReal), _mm256_mul_ps(sImag, dImag)));
+            _mm256_store_ps(steeringImag.data() + elementId, _mm256_add_ps(_mm256_mul_ps(sReal, dImag), _mm256_mul_ps(sImag, dReal)));
+        }
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, accumulatorReal);
+        for (float lane : lanes)
+            sumReal += lane;
+        _mm256_store_ps(lanes, accumulatorImag);
+        for (float lane : lanes)
+            sumImag += lane;
+#endif
+        for (; elementId < elementCount; ++elementId) {
+            float sReal = steeringReal[elementId], sImag = steeringImag[elementId];
+            sumReal += spectrumReal[elementId] * sReal - spectrumImag[elementId] * sImag;
+            sumImag += spectrumReal[elementId] * sImag + spectrumImag[elementId] * sReal;
+            steeringReal[elementId] = sReal * stepReal[elementId] - sImag * stepImag[elementId];
+            steeringImag[elementId] = sReal * stepImag[elementId] + sImag * stepReal[elementId];
+        }
+        power += sumReal * sumReal + sumImag * sumImag;
+    }
+    return power;
+}
+
+#pragma region array
+// one passive frame every sampleCount / sampleRateHertz seconds (only in passive mode):
+// 1. gather every tone reaching the array, amplitude from the source level minus the ray-traced transmission loss down to the target's depth
+// 2. synthesize each element's time series (tones split across threads, private buffers summed after) plus independent gaussian ambient noise
+// 3. Hann window and FFT every element, keep the lowestHertz..highestHertz bins
+// 4. beam power at all passiveBinCount bearings (bearings split across threads), expressed in dB over what noise alone would give
+// 5. light every bin above the threshold, colored after the loudest target within a beam width (ghosts and noise stay grey)
+void updatePassiveArray(SonarState& sonarState)
+{
+    PassiveArray& array = sonarState.passiveArray;
+    if (sonarState.activeMode || sonarState.elapsedSeconds < array.nextFrameSeconds)
+        return;
+    constexpr int elementCount = PassiveArray::elementCount;
+    constexpr int sampleCount = PassiveArray::sampleCount;
+    constexpr float frameSeconds = sampleCount / PassiveArray::sampleRateHertz;
+    array.nextFrameSeconds = sonarState.elapsedSeconds + frameSeconds;
+    if (array.plan.size == 0) {
+        array.plan = makeFftPlan(sampleCount);
+        std::seed_seq sequence { sonarState.seed, 0x50A5u };
+        array.noiseRandom.seed(sequence);
+    }
+    const float soundSpeed = soundSpeedMetersPerSecond(sourceDepthNormalized, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
+    placeElements(array, soundSpeed, sonarState.ownship.headingDegrees);
+
+    std::vector<ArrivingTone> tones;
+    std::vector<std::pair<float, int>> targetLevels; // (level dB, target index) of every target that reaches the array at all
+    const double frameStart = sonarState.elapsedSeconds - frameSeconds;
+    const OwnshipFrame& frame = transformToOwnship(sonarState);
+    TargetPaths& paths = sonarState.targetPaths;
+    clearTargetPaths(paths);
+    for (int targetIndex = 0; targetIndex < (int)sonarState.targets.size(); ++targetIndex) {
+        float rangeKilometers = frame.rangeKilometers[targetIndex];
+        if (rangeKilometers >= 0.5f && rangeKilometers <= maximumRangeKilometers)
+            addTargetPath(paths, targetIndex, rangeKilometers, frame.bearingDegrees[targetIndex], sonarState.targets[targetIndex].depthNormalized);
+    }
+    computeOwnPathLoss(sonarState, paths);
+    for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+        const int targetIndex = paths.targetIndices[pathId];
+        const Target& target = sonarState.targets[targetIndex];
+        const float rangeKilometers = paths.rangeKilometers[pathId];
+        float level = sourceLevelDecibels - paths.lossDecibels[pathId];
+        if (level < -60.f)
+            continue; // a thousandth of the noise amplitude, can't matter
+        targetLevels.push_back({ level, targetIndex });
+        float amplitude = std::pow(10.f, level / 20.f);
+        float directionEast = frame.eastKilometers[targetIndex] / rangeKilometers, directionNorth = frame.northKilometers[targetIndex] / rangeKilometers;
+        // the signature comes from its own stream (run seed, target id) so it never disturbs the target's motion draws
+        std::seed_seq sequence { sonarState.seed, (uint32_t)target.id, 0x70AEu };
+        std::minstd_rand signature(sequence);
+        for (int tonalId = 0; tonalId < tonalCount; ++tonalId) {
+            float hertz = PassiveArray::lowestHertz + 50.f + randomUnit(signature) * (PassiveArray::highestHertz - PassiveArray::lowestHertz - 100.f);
+            float phase = (float)std::fmod(2.0 * M_PI * hertz * frameStart, 2.0 * M_PI); // continuous from frame to frame
+            tones.push_back({ amplitude, hertz, phase, directionEast, directionNorth });
+        }
+        float broadbandAmplitude = amplitude * std::pow(10.f, broadbandLevelDecibels / 20.f);
+        for (int toneId = 0; toneId < broadbandToneCount; ++toneId) {
+            float hertz = PassiveArray::lowestHertz + randomUnit(array.noiseRandom) * (PassiveArray::highestHertz - PassiveArray::lowestHertz);
+            tones.push_back({ broadbandAmplitude, hertz, randomUnit(array.noiseRandom) * 2.f * (float)M_PI, directionEast, directionNorth });
+        }
+    }
+
+    // ambient noise first, it's the base every thread's share of tones gets added onto
+    std::vector<float> timeSeries(sampleCount * elementCount);
+    for (int sampleId = 0; sampleId < sampleCount * elementCount; sampleId += 2) {
+        // Box-Muller: two uniforms -> two independent unit gaussians
+        float radius = std::sqrt(-2.f * std::log(1.f - randomUnit(array.noiseRandom)));
+        float angle = 2.f * (float)M_PI * randomUnit(array.noiseRandom);
+        timeSeries[sampleId] = radius * std::cos(angle);
+        timeSeries[sampleId + 1] = radius * std::sin(angle);
+    }
+    const int synthesisThreadCount = (int)std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), tones.size());
+    if (synthesisThreadCount > 0) {
+        std::vector<std::vector<float>> threadSeries(synthesisThreadCount, std::vector<float>(sampleCount * elementCount, 0.f));
+        std::vector<std::thread> workers;
+        for (int threadId = 0; threadId < synthesisThreadCount; ++threadId)
+            workers.emplace_back(
+                [&, threadId] { synthesizeTones(array, tones, threadId, synthesisThreadCount, soundSpeed, threadSeries[threadId]); });
+        for (auto& worker : workers)
+            worker.join();
+        for (const auto& series : threadSeries)
+            for (int sampleId = 0; sampleId < sampleCount * elementCount; ++sampleId)
+                timeSeries[sampleId] += series[sampleId];
+    }
+
+    // Hann window tapers both ends of the frame so a tonal doesn't leak across the whole spectrum (the frame edge is a hard cut otherwise)
+    constexpr float binHertz = PassiveArray::sampleRateHertz / sampleCount;
+    const int firstBin = (int)std::ceil(PassiveArray::lowestHertz / binHertz);
+    const int binCount = (int)(PassiveArray::highestHertz / binHertz) - firstBin + 1;
+    array.spectrumReal.resize(binCount * elementCount);
+    array.spectrumImag.resize(binCount * elementCount);
+    std::vector<float> real(sampleCount), imag(sampleCount);
+    float windowEnergy = 0.f;
+    for (int elementId = 0; elementId < elementCount; ++elementId) {
+        for (int sampleId = 0; sampleId < sampleCount; ++sampleId) {
+            float window = 0.5f - 0.5f * std::cos(2.f * (float)M_PI * sampleId / sampleCount);
+            real[sampleId] = timeSeries[sampleId * elementCount + elementId] * window;
+            imag[sampleId] = 0.f;
+            if (elementId == 0)
+                windowEnergy += window * window;
+        }
+        fft(array.plan, real.data(), imag.data());
+        for (int bandBin = 0; bandBin < binCount; ++bandBin) {
+            array.spectrumReal[bandBin * elementCount + elementId] = real[firstBin + bandBin];
+            array.spectrumImag[bandBin * elementCount + elementId] = imag[firstBin + bandBin];
+        }
+    }
+
+    // unit noise gives E|X|² = Σ window² per element per bin, a beam sums elementCount of them incoherently, over binCount bins
+    const float noisePower = windowEnergy * elementCount * binCount;
+    std::array<float, passiveBinCount> powers;
+    const int beamThreadCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (int threadId = 0; threadId < beamThreadCount; ++threadId)
+        workers.emplace_back([&, threadId] {
+            for (int binId = threadId; binId < passiveBinCount; binId += beamThreadCount)
+                powers[binId] = beamPower(array, firstBin, binCount, binId * 360.f / passiveBinCount, soundSpeed);
+        });
+    for (auto& worker : workers)
+        worker.join();
+
+    // a loud contact leaks into every beam through the sidelobes, so what the operator compares against is the background:
+    // noise alone when it's quiet, the median beam once loud contacts raised the floor all around (a "noise normalizer"),
+    // the median ignores the few beams that actually point at something
+    std::array<float, passiveBinCount> sortedPowers = powers;
+    std::nth_element(sortedPowers.begin(), sortedPowers.begin() + passiveBinCount / 2, sortedPowers.end());
+    const float background = std::max(noisePower, sortedPowers[passiveBinCount / 2]);
+    for (int binId = 0; binId < passiveBinCount; ++binId)
+        array.beamSnrDecibels[binId] = 10.f * std::log10(std::max(powers[binId] / background, 1e-6f));
+
+    // loudest target first so it claims the bins around its bearing before quieter ones nearby
+    std::sort(targetLevels.begin(), targetLevels.end(), std::greater<>());
+    std::array<int, passiveBinCount> binTarget;
+    binTarget.fill(-1);
+    for (const auto& [level, targetIndex] : targetLevels) {
+        int centerBin = (int)(frame.bearingDegrees[targetIndex] / 360.f * passiveBinCount) % passiveBinCount;
+        for (int offset = -beamHalfWidthBins; offset <= beamHalfWidthBins; ++offset) {
+            int binId = (centerBin + offset + passiveBinCount) % passiveBinCount;
+            if (binTarget[binId] < 0)
+                binTarget[binId] = targetIndex;
+        }
+    }
+    for (int binId = 0; binId < passiveBinCount; ++binId) {
+        float excess = array.beamSnrDecibels[binId] - detectionThresholdDecibels;
+        if (excess <= 0.f)
+            continue;
+        PassiveBin& passiveBin = sonarState.passiveBins[binId];
+        // brightness follows the excess so the main lobe reads as a bright line and its shoulders and sidelobes as a faint fan
+        passiveBin.alpha = std::max(passiveBin.alpha, std::min(1.f, excess / 10.f));
+        passiveBin.color = binTarget[binId] >= 0 ? targetColors[sonarState.targets[binTarget[binId]].colorId] : Color { 170, 170, 170, 255 };
+    }
+}
+
+// strength of the last passive frame's beam at a bearing, 0 below the detection threshold, 1 at 12 dB above noise
+float passiveBeamStrength(const PassiveArray& array, float bearingDegrees)
+{
+    int binId = (int)(bearingDegrees / 360.f * passiveBinCount) % passiveBinCount;
+    float snr = array.beamSnrDecibels[binId];
+    return snr < detectionThresholdDecibels ? 0.f : std::clamp(snr / 12.f, 0.f, 1.f);
+}
@@ -0,0 +1,213 @@
+#include "ppi.hpp"
+
+#pragma region bench utils
+// one line of the report, every run is the same seeded scenario so two builds compare like for like
+struct BenchResult {
+    std::string mode;
+    int targetCount;
+    float sweepSpeedDegreesPerSecond;
+    double wallSeconds;
+    double simulatedSeconds;
+    long long tickCount;
+    long long detectionCount;
+    long long blipsCreated, blipsExpired;
+    size_t peakBlipCount;
+    size_t stateBytes;
+};
+
+// "10,100,1000" -> { 10, 100, 1000 }, throws on anything that isn't a comma separated list of numbers
+template <typename T> static std::vector<T> parseList(const std::string& text, const std::string& option)
+{
+    std::vector<T> values;
+    std::istringstream items(text);
+    std::string item;
+    while (std::getline(items, item, ',')) {
+        std::istringstream number(item);
+        T value;
+        if (!(number >> value))
+            throw std::runtime_error(option + " needs a comma separated list, got: " + text);
+        values.push_back(value);
+    }
+    if (values.empty())
+        throw std::runtime_error(option + " needs at least one value");
+    return values;
+}
+
+// heap the simulation holds on to, summed from container capacities (what was allocated, not just what's used),
+// portable and exact for the big buffers, it misses allocator overhead and the small fixed-size members
+static size_t stateBytes(const SonarState& sonarState)
+{
+    auto bytes = [](const auto& container) { return container.capacity() * sizeof(typename std::decay_t<decltype(container)>::value_type); };
+    auto pathBytes = [&](const TargetPaths& paths) {
+        return bytes(paths.targetIndices) + bytes(paths.rangeKilometers) + bytes(paths.bearingDegrees) + bytes(paths.depthNormalized)
+            + bytes(paths.lossDecibels) + bytes(paths.sortedPaths) + bytes(paths.sortedRanges) + bytes(paths.sortedDepths) + bytes(paths.sortedLosses);
+    };
+    size_t total = sizeof(SonarState) + bytes(sonarState.targets) + bytes(sonarState.pendingSpawns) + bytes(sonarState.detections)
+        + bytes(sonarState.blips) + pathBytes(sonarState.targetPaths) + bytes(sonarState.pendingOrders);
+    const OwnshipFrame& frame = sonarState.ownshipFrame;
+    total += bytes(frame.eastKilometers) + bytes(frame.northKilometers) + bytes(frame.rangeKilometers) + bytes(frame.bearingDegrees);
+    const Tracker& tracker = sonarState.tracker;
+    total += bytes(tracker.tracks) + bytes(tracker.pendingDetections) + bytes(tracker.cellStart) + bytes(tracker.cellDetections)
+        + bytes(tracker.cellFill) + bytes(tracker.candidates) + bytes(tracker.trackTaken) + bytes(tracker.detectionTaken);
+    const PassiveArray& array = sonarState.passiveArray;
+    total += bytes(array.spectrumReal) + bytes(array.spectrumImag) + bytes(array.plan.bitReverse) + bytes(array.plan.twiddleReal)
+        + bytes(array.plan.twiddleImag);
+    const ActiveProcessor& processor = sonarState.activeProcessor;
+    total += bytes(processor.pulseSpectrumReal) + bytes(processor.pulseSpectrumImag) + bytes(processor.filterSpectrumReal)
+        + bytes(processor.filterSpectrumImag) + bytes(processor.pendingBeams) + bytes(processor.targetBearings) + bytes(processor.targetLevels)
+        + bytes(processor.targetCells) + bytes(processor.targetIndices) + bytes(processor.plan.bitReverse) + bytes(processor.plan.twiddleReal)
+        + bytes(processor.plan.twiddleImag);
+    for (const auto& [key, amplitude] : processor.reverberationAmplitudes)
+        total += bytes(amplitude);
+    const ClutterField& clutter = sonarState.clutter;
+    total += bytes(clutter.scatterers) + bytes(clutter.cellStart) + bytes(clutter.cellScatterers) + bytes(clutter.cellFill) + bytes(clutter.returns)
+        + pathBytes(clutter.paths);
+    for (const Sensor& sensor : sonarState.sensors)
+        total += sizeof(Sensor) + bytes(sensor.lastDetectionSeconds) + bytes(sensor.detections) + bytes(sensor.bearings) + pathBytes(sensor.paths);
+    const Fusion& fusion = sonarState.fusion;
+    total += bytes(fusion.bearings) + bytes(fusion.cellSensors) + bytes(fusion.candidates) + bytes(fusion.candidateLineStart)
+        + bytes(fusion.candidateLines) + bytes(fusion.lineTaken) + bytes(fusion.fixes);
+    // traced fields are shared, each one is counted once whoever points at it
+    std::unordered_set<const TransmissionLossField*> fields;
+    for (const auto& [key, field] : sonarState.transmissionLossCache)
+        fields.insert(field.get());
+    for (const auto& field : sonarState.transmissionLossSectors.fields)
+        fields.insert(field.get());
+    for (const Sensor& sensor : sonarState.sensors)
+        for (const auto& field : sensor.sectors.fields)
+            fields.insert(field.get());
+    fields.erase(nullptr);
+    total += fields.size() * (sizeof(TransmissionLossField) + TransmissionLossField::rangeBinCount * TransmissionLossField::depthBinCount * sizeof(float));
+    if (sonarState.environment)
+        total += sizeof(OceanEnvironment) + bytes(sonarState.environment->speedCentimeters);
+    return total;
+}
+
+// peak resident memory of the whole process in KB, where the OS tells us cheaply (Linux), -1 elsewhere
+static long peakResidentKilobytes()
+{
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+        if (line.rfind("VmHWM:", 0) == 0)
+            return std::stol(line.substr(6));
+    return -1;
+}
+
+#pragma region bench
+// one run: the base scenario with targetCount random targets, the given mode and sweep, warmed up then timed for durationSeconds,
+// warm-up covers what happens once per run and would swamp short runs (FFT plans, the first ray traces, the first allocations),
+// blips are only ever created next to a detection of ours or a sensor's (active contacts), so created = active detections of the tick
+// and expired = whatever the fade removed on top, churn is what the renderer re-uploads every frame
+static BenchResult runBench(Scenario scenario, const std::string& mode, int targetCount, float sweepSpeed, double durationSeconds)
+{
+    scenario.activeMode = mode != "passive";
+    scenario.multiBeamCount = mode == "multibeam" ? 128 : 0;
+    scenario.sweepSpeedDegreesPerSecond = sweepSpeed;
+    scenario.randomTargetCount = targetCount;
+    scenario.spawns.clear(); // scheduled spawns would change the target count mid-run
+    SonarState sonarState;
+    applyScenario(sonarState, scenario);
+    constexpr double warmUpSeconds = 5.0;
+    for (long long tickId = 0; tickId < std::llround(warmUpSeconds / simulationTickSeconds); ++tickId)
+        updateSonar(sonarState, (float)simulationTickSeconds);
+
+    BenchResult result { mode, targetCount, sweepSpeed, 0.0, durationSeconds, std::llround(durationSeconds / simulationTickSeconds), 0, 0, 0, 0, 0 };
+    const auto wallStart = std::chrono::steady_clock::now();
+    for (long long tickId = 0; tickId < result.tickCount; ++tickId) {
+        size_t blipsBefore = sonarState.blips.size();
+        updateSonar(sonarState, (float)simulationTickSeconds);
+        long long created = std::count_if(sonarState.detections.begin(), sonarState.detections.end(), [](const Detection& detection) { return detection.active; });
+        result.detectionCount += (long long)sonarState.detections.size();
+        result.blipsCreated += created;
+        result.blipsExpired += (long long)blipsBefore + created - (long long)sonarState.blips.size();
+        result.peakBlipCount = std::max(result.peakBlipCount, sonarState.blips.size());
+    }
+    result.wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    result.stateBytes = stateBytes(sonarState);
+    return result;
+}
+
+static void printResult(const BenchResult& result)
+{
+    double tickNanoseconds = result.wallSeconds * 1e9 / result.tickCount;
+    std::printf("%-10s %7d %6.0f %10.0f %12.2f %11.1f %10.1f %10.1f %8zu %9.1f %8.1fx\n", result.mode.c_str(), result.targetCount,
+        result.sweepSpeedDegreesPerSecond, tickNanoseconds, tickNanoseconds / std::max(result.targetCount, 1),
+        result.detectionCount / result.simulatedSeconds, result.blipsCreated / result.simulatedSeconds, result.blipsExpired / result.simulatedSeconds,
+        result.peakBlipCount, result.stateBytes / 1024.0, result.simulatedSeconds / std::max(result.wallSeconds, 1e-9));
+}
+
+#pragma region main
+// ppi_bench                                          -> active, passive and multi-beam at 10, 100 and 1000 targets, 90°/s, 60 s each
+// ppi_bench --targets 100,5000 --mode active         -> only those
+// ppi_bench --sweep 45,180 --seconds 300 --seed 7    -> sweep speeds, simulated seconds per run, run seed
+// ppi_bench --clutter 20000,10000                    -> seabed and biologic scatterers on top
+// ppi_bench --ownship 45,0.5                         -> our ship under way (course, km/s) instead of stopped
+// ppi_bench --scenario ppi/scenario.txt              -> start from a scenario (its sensors, environment, water), targets still come from --targets
+// per run: ns per tick, ns per target per tick (flat = the tick scales linearly with targets), detections/s, blips created and expired/s,
+// peak live blips, simulation state KB, how many times faster than real time, then the process' peak resident memory
+int main(int argc, char** argv)
+{
+    std::vector<int> targetCounts { 10, 100, 1000 };
+    std::vector<float> sweepSpeeds { 90.f };
+    std::vector<std::string> modes { "active", "passive", "multibeam" };
+    double durationSeconds = 60.0;
+    Scenario scenario;
+    std::optional<uint32_t> seed;
+    try {
+        for (int argumentId = 1; argumentId < argc; ++argumentId) {
+            std::string option = argv[argumentId];
+            if (argumentId + 1 >= argc)
+                throw std::runtime_error(option + " needs a value");
+            std::string value = argv[++argumentId];
+            if (option == "--targets")
+                targetCounts = parseList<int>(value, option);
+            else if (option == "--sweep")
+                sweepSpeeds = parseList<float>(value, option);
+            else if (option == "--mode") {
+                modes.clear();
+                std::istringstream items(value);
+                std::string item;
+                while (std::getline(items, item, ','))
+                    if (item == "active" || item == "passive" || item == "multibeam")
+                        modes.push_back(item);
+                    else
+                        throw std::runtime_error("--mode takes active, passive and/or multibeam, got: " + item);
+            } else if (option == "--seconds") {
+                durationSeconds = parseList<double>(value, option)[0];
+                if (durationSeconds <= 0.0)
+                    throw std::runtime_error("--seconds needs a positive duration");
+            } else if (option == "--seed")
+                seed = (uint32_t)parseList<unsigned long>(value, option)[0];
+            else if (option == "--clutter") {
+                std::vector<int> counts = parseList<int>(value, option);
+                scenario.seabedScattererCount = counts[0];
+                scenario.biologicScattererCount = counts.size() > 1 ? counts[1] : 0;
+            } else if (option == "--ownship") {
+                std::vector<float> order = parseList<float>(value, option);
+                if (order.size() != 2 || order[1] < 0.f || order[1] > maximumOwnshipSpeed)
+                    throw std::runtime_error("--ownship needs <course deg>,<speed km/s up to 0.6>");
+                scenario.ownshipOrders = { { 0.0, order[0], order[1] } };
+            } else if (option == "--scenario")
+                scenario = loadScenario(value);
+            else
+                throw std::runtime_error("unknown option " + option);
+        }
+        if (seed)
+            scenario.seed = *seed; // wins over the scenario's own whichever came first
+
+        std::printf("%-10s %7s %6s %10s %12s %11s %10s %10s %8s %9s %9s\n", "mode", "targets", "sweep", "ns/tick", "ns/target", "detect/s",
+            "blips+/s", "blips-/s", "peak", "state KB", "realtime");
+        for (const std::string& mode : modes)
+            for (float sweepSpeed : sweepSpeeds)
+                for (int targetCount : targetCounts)
+                    printResult(runBench(scenario, mode, targetCount, sweepSpeed, durationSeconds));
+    } catch (const std::exception& e) {
+        std::cerr << "Benchmark failed: " << e.what() << std::endl;
+        return 1;
+    }
+    long peakKilobytes = peakResidentKilobytes();
+    if (peakKilobytes >= 0)
+        std::printf("peak resident memory %.1f MB\n", peakKilobytes / 1024.0);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include "ppi.hpp"
+
+#pragma region clutter utils
+// the grid is rebuilt this often, a school drifting 0.5 m/s moves 5 m in between, a tenth of a range cell
+constexpr double reindexSeconds = 10.0;
+// and whenever our ship moved this far from where the grid was centered, a scatterer then sits at most a beam off its column from 7 km out
+constexpr float reindexKilometers = 0.25f;
+// how many scatterers share a patch on average, the seabed comes in ridges and rock fields, biologics in schools
+constexpr int seabedPatchSize = 100;
+constexpr int biologicPatchSize = 50;
+
+// unit gaussian (Box-Muller, one of the pair), exact tails unlike the sensors' 3-uniform sum, patches spread wide
+static float boxMullerGaussian(std::minstd_rand& random)
+{
+    return std::sqrt(-2.f * std::log(1.f - randomUnit(random))) * std::cos(2.f * (float)M_PI * randomUnit(random));
+}
+
+// count scatterers gathered in patches scattered uniformly over the disc (radius = max range · √u so the density is even),
+// each one a gaussian offset from its patch center, makePatch and makeScatterer fill in what kind of scatterer it is
+template <typename MakePatch, typename MakeScatterer>
+static void scatterPatches(ClutterField& clutter, int count, int patchSize, MakePatch makePatch, MakeScatterer makeScatterer)
+{
+    if (count <= 0)
+        return;
+    std::minstd_rand& random = clutter.random;
+    struct Patch {
+        float xKilometers, yKilometers, sigmaKilometers, velocityX, velocityY;
+    };
+    std::vector<Patch> patches((count + patchSize - 1) / patchSize);
+    for (Patch& patch : patches) {
+        float angle = randomUnit(random) * 2.f * (float)M_PI, distance = maximumRangeKilometers * std::sqrt(randomUnit(random));
+        patch.xKilometers = std::sin(angle) * distance;
+        patch.yKilometers = std::cos(angle) * distance;
+        makePatch(patch.sigmaKilometers, patch.velocityX, patch.velocityY);
+    }
+    for (int scattererId = 0; scattererId < count; ++scattererId) {
+        const Patch& patch = patches[std::min((int)(randomUnit(random) * patches.size()), (int)patches.size() - 1)];
+        Scatterer scatterer;
+        scatterer.xKilometers = patch.xKilometers + patch.sigmaKilometers * boxMullerGaussian(random);
+        scatterer.yKilometers = patch.yKilometers + patch.sigmaKilometers * boxMullerGaussian(random);
+        scatterer.velocityX = patch.velocityX;
+        scatterer.velocityY = patch.velocityY;
+        makeScatterer(scatterer);
+        clutter.scatterers.push_back(scatterer);
+    }
+}
+
+// advances every scatterer to now, then counting-sorts them into the polar grid around our ship: count per cell, prefix sum, fill,
+// scatterers outside the display (drifted away, or our ship sailed off) stay in the list but not in the grid until they're back in range
+static void reindexClutter(ClutterField& clutter, double now, const Ownship& ownship)
+{
+    constexpr int cellCount = ClutterField::columnCount * ClutterField::ringCount;
+    float elapsed = clutter.indexSeconds < 0.0 ? 0.f : (float)(now - clutter.indexSeconds);
+    clutter.indexSeconds = now;
+    clutter.indexXKilometers = ownship.xKilometers;
+    clutter.indexYKilometers = ownship.yKilometers;
+    auto cellOf = [&](const Scatterer& scatterer) {
+        float eastKilometers = scatterer.xKilometers - ownship.xKilometers, northKilometers = scatterer.yKilometers - ownship.yKilometers;
+        float rangeKilometers = std::hypot(eastKilometers, northKilometers);
+        if (rangeKilometers >= maximumRangeKilometers)
+            return -1;
+        float bearing = std::fmod(std::atan2(eastKilometers, northKilometers) * RAD2DEG + 360.f, 360.f);
+        int column = std::min((int)(bearing / ActiveProcessor::beamWidthDegrees), ClutterField::columnCount - 1);
+        return column * ClutterField::ringCount + (int)(rangeKilometers / ClutterField::ringKilometers);
+    };
+
+    clutter.cellStart.assign(cellCount + 1, 0);
+    for (Scatterer& scatterer : clutter.scatterers) {
+        scatterer.xKilometers += scatterer.velocityX * elapsed;
+        scatterer.yKilometers += scatterer.velocityY * elapsed;
+        int cell = cellOf(scatterer);
+        if (cell >= 0)
+            ++clutter.cellStart[cell + 1];
+    }
+    for (int cell = 0; cell < cellCount; ++cell)
+        clutter.cellStart[cell + 1] += clutter.cellStart[cell];
+    clutter.cellFill.assign(clutter.cellStart.begin(), clutter.cellStart.end() - 1);
+    clutter.cellScatterers.resize(clutter.cellStart[cellCount]);
+    for (int scattererId = 0; scattererId < (int)clutter.scatterers.size(); ++scattererId) {
+        int cell = cellOf(clutter.scatterers[scattererId]);
+        if (cell >= 0)
+            clutter.cellScatterers[clutter.cellFill[cell]++] = scattererId;
+    }
+}
+
+#pragma region clutter
+// seabed: rock fields and ridges 0.5 to 3 km across on the bottom, -20 to -10 dB under a target, answer 30 to 90% of pings,
+// biologics: schools 0.2 to 1 km across between 100 and 350 m deep (the deep scattering layer), -30 to -15 dB, answer 20 to 70% of pings,
+// each school drifts as one at up to 0.5 m/s,
+// all of it over the 100 km disc around where the run starts, a ship sailing out of it leaves the clutter behind,
+// every draw comes from the field's own stream seeded from the run seed, so the same seed lays out the same seabed
+void generateClutter(ClutterField& clutter, uint32_t seed, int seabedCount, int biologicCount)
+{
+    clutter = ClutterField {};
+    std::seed_seq sequence { seed, 0xC177u };
+    clutter.random.seed(sequence);
+    std::minstd_rand& random = clutter.random;
+    clutter.scatterers.reserve(std::max(seabedCount, 0) + std::max(biologicCount, 0));
+    scatterPatches(
+        clutter, seabedCount, seabedPatchSize,
+        [&](float& sigmaKilometers, float& velocityX, float& velocityY) {
+            sigmaKilometers = 0.5f + 2.5f * randomUnit(random);
+            velocityX = velocityY = 0.f;
+        },
+        [&](Scatterer& scatterer) {
+            scatterer.depthNormalized = 1.f;
+            scatterer.strengthDecibels = -20.f + 10.f * randomUnit(random);
+            scatterer.returnProbability = 0.3f + 0.6f * randomUnit(random);
+        });
+    scatterPatches(
+        clutter, biologicCount, biologicPatchSize,
+        [&](float& sigmaKilometers, float& velocityX, float& velocityY) {
+            sigmaKilometers = 0.2f + 0.8f * randomUnit(random);
+            float course = randomUnit(random) * 2.f * (float)M_PI, speed = 0.0005f * randomUnit(random);
+            velocityX = std::sin(course) * speed;
+            velocityY = std::cos(course) * speed;
+        },
+        [&](Scatterer& scatterer) {
+            scatterer.depthNormalized = 0.1f + 0.25f * randomUnit(random);
+            scatterer.strengthDecibels = -30.f + 15.f * randomUnit(random);
+            scatterer.returnProbability = 0.2f + 0.5f * randomUnit(random);
+        });
+}
+
+// what the scatterers in the given grid columns (2° beams, empty = every column, the whole circle for the fixed beams) sent back to one ping:
+// walks only those columns' cells, looks up every scatterer's two-way loss in one batch like the targets', then each one answers
+// with its return probability and a Rayleigh-fading level (power exponentially distributed around its mean, 10·log10 of a unit exponential),
+// returns land in clutter.returns in column then ring order, drawn from the field's stream on the simulation thread so a run stays reproducible
+void queryClutter(SonarState& sonarState, const std::vector<int>& columns)
+{
+    ClutterField& clutter = sonarState.clutter;
+    std::vector<ClutterReturn>& returns = clutter.returns;
+    returns.clear();
+    if (clutter.scatterers.empty())
+        return;
+    const Ownship& ownship = sonarState.ownship;
+    if (clutter.indexSeconds < 0.0 || sonarState.elapsedSeconds - clutter.indexSeconds >= reindexSeconds
+        || std::hypot(ownship.xKilometers - clutter.indexXKilometers, ownship.yKilometers - clutter.indexYKilometers) > reindexKilometers)
+        reindexClutter(clutter, sonarState.elapsedSeconds, ownship);
+
+    TargetPaths& paths = clutter.paths;
+    clearTargetPaths(paths);
+    auto addColumn = [&](int column) {
+        for (int slot = clutter.cellStart[column * ClutterField::ringCount]; slot < clutter.cellStart[(column + 1) * ClutterField::ringCount]; ++slot) {
+            int scattererId = clutter.cellScatterers[slot];
+            const Scatterer& scatterer = clutter.scatterers[scattererId];
+            float eastKilometers = scatterer.xKilometers - ownship.xKilometers, northKilometers = scatterer.yKilometers - ownship.yKilometers;
+            float rangeKilometers = std::hypot(eastKilometers, northKilometers);
+            if (rangeKilometers < 0.5f || rangeKilometers > maximumRangeKilometers)
+                continue; // inside our own ship's blanking, or left behind since the grid was built
+            addTargetPath(paths, scattererId, rangeKilometers, std::fmod(std::atan2(eastKilometers, northKilometers) * RAD2DEG + 360.f, 360.f),
+                scatterer.depthNormalized);
+        }
+    };
+    if (columns.empty())
+        for (int column = 0; column < ClutterField::columnCount; ++column)
+            addColumn(column);
+    else
+        for (int column : columns)
+            addColumn(column);
+    computeOwnPathLoss(sonarState, paths);
+
+    for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+        const Scatterer& scatterer = clutter.scatterers[paths.targetIndices[pathId]];
+        if (randomUnit(clutter.random) >= scatterer.returnProbability)
+            continue;
+        float fading = 10.f * std::log10(std::max(-std::log(1.f - randomUnit(clutter.random)), 1e-6f));
+        returns.push_back({ paths.bearingDegrees[pathId], paths.rangeKilometers[pathId], scatterer.strengthDecibels + fading - 2.f * paths.lossDecibels[pathId] });
+    }
+}
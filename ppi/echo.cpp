@@ -0,0 +1,415 @@
+#include "ppi.hpp"
+
+#pragma region echo utils
+// an echo travels to the target and back so it pays the one-way transmission loss twice (40 dB per decade of range instead of 20),
+// levels are in dB over the receiver noise of one sample, an echo at 2·TL = 78 dB comes out of the matched filter ~15 dB over the noise,
+// about where the old 78 dB figure of merit put the edge of detection
+constexpr float echoLevelDecibels = 75.f;
+// the seabed and the water volume scatter a little of every ping back at us, weaker the further but from a wider patch (+10·log10(r)),
+// that's reverberation, it fills the near ranges with a grainy floor that moves with the environment, CFAR has to see through it
+constexpr float scatteringStrengthDecibels = -35.f;
+// CA-CFAR: each cell is compared to the average of trainingCells cells on both sides, skipping guardCells right next to it
+// (an echo spreads a little over its neighbours after the matched filter, they'd inflate its own noise estimate)
+constexpr int guardCells = 4;
+constexpr int trainingCells = 16;
+// designed for 1e-7, the matched filter correlates neighbouring noise cells which makes the average noisier and lands nearer 1e-6 in practice
+constexpr double falseAlarmProbability = 1e-7;
+constexpr double pingBatchSeconds = 0.05; // finished beams are pinged in batches so they can be processed in parallel
+constexpr int associationCells = 2; // a detection within this many cells of an echo we placed is attributed to that target
+constexpr double multiBeamPingSeconds = 1.0; // every fixed beam pings together this often, 4 full pictures per default revolution
+
+// an echo we place in a beam's range window, integer cell (50 m quantization, like the receiver's own sampling)
+struct BeamEcho {
+    int rangeCell;
+    float amplitude;
+    int targetIndex;
+};
+
+// what CFAR found in one beam
+struct BeamContact {
+    float rangeKilometers;
+    float excessDecibels; // how far over the CFAR threshold
+    int targetIndex; // -1 for a false alarm (noise, reverberation or clutter)
+};
+
+// complex gaussian with E|z|² = 1 (Box-Muller, σ = 1/√2 per component)
+static void complexGaussian(std::minstd_rand& random, float& real, float& imag)
+{
+    float radius = std::sqrt(-std::log(1.f - randomUnit(random)));
+    float angle = 2.f * (float)M_PI * randomUnit(random);
+    real = radius * std::cos(angle);
+    imag = radius * std::sin(angle);
+}
+
+// the transmitted ping: an up-chirp sweeping the whole baseband (-fs/2 to +fs/2) over pulseSampleCount samples,
+// phase π·(n - L/2)² / L so the instantaneous frequency (n - L/2) / L cycles per sample grows linearly,
+// a long chirp carries L times the energy of a single-sample click yet compresses back to one cell, that's the whole point of LFM,
+// the matched filter is the chirp itself, conjugated in the frequency domain (correlation), Hamming-weighted to push the range
+// sidelobes from -13 dB down to ~-40 dB so a loud echo doesn't raise false contacts a few cells away
+static void buildPulse(ActiveProcessor& processor)
+{
+    constexpr int fftSize = ActiveProcessor::fftSize;
+    constexpr int pulseSampleCount = ActiveProcessor::pulseSampleCount;
+    processor.plan = makeFftPlan(fftSize);
+    processor.pulseSpectrumReal.assign(fftSize, 0.f);
+    processor.pulseSpectrumImag.assign(fftSize, 0.f);
+    processor.filterSpectrumReal.assign(fftSize, 0.f);
+    processor.filterSpectrumImag.assign(fftSize, 0.f);
+    float weightEnergy = 0.f;
+    for (int sampleId = 0; sampleId < pulseSampleCount; ++sampleId) {
+        float offset = sampleId - pulseSampleCount / 2.f;
+        float phase = (float)M_PI * offset * offset / pulseSampleCount;
+        float weight = 0.54f - 0.46f * std::cos(2.f * (float)M_PI * sampleId / (pulseSampleCount - 1));
+        processor.pulseSpectrumReal[sampleId] = std::cos(phase);
+        processor.pulseSpectrumImag[sampleId] = std::sin(phase);
+        processor.filterSpectrumReal[sampleId] = weight * std::cos(phase);
+        processor.filterSpectrumImag[sampleId] = weight * std::sin(phase);
+        weightEnergy += weight * weight;
+    }
+    fft(processor.plan, processor.pulseSpectrumReal.data(), processor.pulseSpectrumImag.data());
+    fft(processor.plan, processor.filterSpectrumReal.data(), processor.filterSpectrumImag.data());
+    // conjugate for the correlation, normalized so unit noise stays unit power after filtering
+    float scale = 1.f / std::sqrt(weightEnergy);
+    for (int binId = 0; binId < fftSize; ++binId) {
+        processor.filterSpectrumReal[binId] *= scale;
+        processor.filterSpectrumImag[binId] *= -scale;
+    }
+}
+
+// reverberation amplitude per range cell for a field, computed once per field key and kept, a gridded environment has one field
+// per bearing sector so beams looking different ways see different reverberation
+static const std::vector<float>& reverberationFor(ActiveProcessor& processor, const TransmissionLossField& field)
+{
+    std::vector<float>& amplitude = processor.reverberationAmplitudes[field.key];
+    if (!amplitude.empty())
+        return amplitude;
+    amplitude.assign(ActiveProcessor::rangeCellCount, 0.f);
+    for (int cellId = 0; cellId < ActiveProcessor::rangeCellCount; ++cellId) {
+        float rangeKilometers = (cellId + 0.5f) * ActiveProcessor::rangeCellKilometers;
+        if (rangeKilometers < 0.5f)
+            continue; // inside our own ship's blanking
+        float level = echoLevelDecibels - 2.f * transmissionLossDecibels(field, rangeKilometers, targetDepthNormalized) + scatteringStrengthDecibels
+            + 10.f * std::log10(rangeKilometers);
+        amplitude[cellId] = std::pow(10.f, level / 20.f);
+    }
+    return amplitude;
+}
+
+// one ping of one beam, start to finish:
+// 1. received signal = noise + (echoes and reverberation scatterers) convolved with the ping, the convolution is a product
+//    in the frequency domain so the scatterers are laid out as impulses, FFT'd and multiplied by the ping's spectrum
+// 2. matched filter = multiply by the filter spectrum, inverse FFT, each echo collapses back to a sharp peak at its range cell
+// 3. CA-CFAR over the range cells using prefix sums (each cell's training windows in O(1)), local maxima over the threshold are contacts
+// only reads the processor and writes its own output so any number of beams can run at once on different threads
+static void pingBeam(const ActiveProcessor& processor, const std::vector<float>& reverberationAmplitude, const std::vector<BeamEcho>& echoes,
+    std::minstd_rand random, std::vector<BeamContact>& contacts)
+{
+    constexpr int fftSize = ActiveProcessor::fftSize;
+    constexpr int rangeCellCount = ActiveProcessor::rangeCellCount;
+    std::vector<float> scatterReal(fftSize, 0.f), scatterImag(fftSize, 0.f), noiseReal(fftSize, 0.f), noiseImag(fftSize, 0.f);
+    for (int cellId = 0; cellId < rangeCellCount; ++cellId) {
+        float real, imag;
+        complexGaussian(random, real, imag);
+        scatterReal[cellId] = real * reverberationAmplitude[cellId];
+        scatterImag[cellId] = imag * reverberationAmplitude[cellId];
+        complexGaussian(random, noiseReal[cellId], noiseImag[cellId]);
+    }
+    // each echo comes back with a random phase (the target's exact range within the cell, its aspect...)
+    for (const BeamEcho& echo : echoes) {
+        float phase = 2.f * (float)M_PI * randomUnit(random);
+        scatterReal[echo.rangeCell] += echo.amplitude * std::cos(phase);
+        scatterImag[echo.rangeCell] += echo.amplitude * std::sin(phase);
+    }
+    fft(processor.plan, scatterReal.data(), scatterImag.data());
+    fft(processor.plan, noiseReal.data(), noiseImag.data());
+
+    // received = noise + scatter·pulse, then times the matched filter, all bin by bin (contiguous so it vectorizes)
+    for (int binId = 0; binId < fftSize; ++binId) {
+        float receivedReal = noiseReal[binId] + scatterReal[binId] * processor.pulseSpectrumReal[binId] - scatterImag[binId] * processor.pulseSpectrumImag[binId];
+        float receivedImag = noiseImag[binId] + scatterReal[binId] * processor.pulseSpectrumImag[binId] + scatterImag[binId] * processor.pulseSpectrumReal[binId];
+        noiseReal[binId] = receivedReal * processor.filterSpectrumReal[binId] - receivedImag * processor.filterSpectrumImag[binId];
+        noiseImag[binId] = receivedReal * processor.filterSpectrumImag[binId] + receivedImag * processor.filterSpectrumReal[binId];
+    }
+    inverseFft(processor.plan, noiseReal.data(), noiseImag.data());
+
+    std::vector<float> power(rangeCellCount);
+    std::vector<double> prefix(rangeCellCount + 1, 0.0);
+    for (int cellId = 0; cellId < rangeCellCount; ++cellId) {
+        power[cellId] = noiseReal[cellId] * noiseReal[cellId] + noiseImag[cellId] * noiseImag[cellId];
+        prefix[cellId + 1] = prefix[cellId] + power[cellId];
+    }
+
+    // for exponentially distributed noise power, averaging n training cells and scaling by n·(Pfa^(-1/n) - 1)
+    // gives exactly falseAlarmProbability whatever the local noise level is, that's what makes it "constant false alarm rate"
+    constexpr int windowCells = 2 * trainingCells;
+    static const float thresholdFactor = (float)(windowCells * (std::pow(falseAlarmProbability, -1.0 / windowCells) - 1.0));
+    const int firstCell = (int)(0.5f / ActiveProcessor::rangeCellKilometers);
+    const int lastCell = std::min(rangeCellCount - 1, (int)(maximumRangeKilometers / ActiveProcessor::rangeCellKilometers));
+    for (int cellId = firstCell; cellId <= lastCell; ++cellId) {
+        int leadStart = std::max(0, cellId - guardCells - trainingCells), leadEnd = std::max(0, cellId - guardCells);
+        int lagStart = std::min(rangeCellCount, cellId + guardCells + 1), lagEnd = std::min(rangeCellCount, cellId + guardCells + 1 + trainingCells);
+        int count = (leadEnd - leadStart) + (lagEnd - lagStart);
+        float noiseEstimate = (float)((prefix[leadEnd] - prefix[leadStart] + prefix[lagEnd] - prefix[lagStart]) / std::max(count, 1));
+        float threshold = thresholdFactor * noiseEstimate;
+        if (power[cellId] <= threshold)
+            continue;
+        // one contact per peak, not one per cell of the peak's skirt
+        bool localMaximum = true;
+        for (int neighbour = std::max(0, cellId - guardCells); neighbour <= std::min(rangeCellCount - 1, cellId + guardCells); ++neighbour)
+            localMaximum = localMaximum && power[neighbour] <= power[cellId];
+        if (!localMaximum)
+            continue;
+
+        int targetIndex = -1;
+        int closestCells = associationCells + 1;
+        for (const BeamEcho& echo : echoes)
+            if (std::abs(echo.rangeCell - cellId) < closestCells) {
+                closestCells = std::abs(echo.rangeCell - cellId);
+                targetIndex = echo.targetIndex;
+            }
+        contacts.push_back({ (cellId + 0.5f) * ActiveProcessor::rangeCellKilometers, 10.f * std::log10(power[cellId] / threshold), targetIndex });
+    }
+}
+
+#pragma region pings
+// pings the given beams at once, split across threads (each ping is independent), contacts come back per beam in beam order,
+// each beam pings into the reverberation of the field it looks along
+static std::vector<std::vector<BeamContact>> pingBeams(
+    SonarState& sonarState, const std::vector<std::vector<BeamEcho>>& beamEchoes, const std::vector<const std::vector<float>*>& beamReverberation)
+{
+    ActiveProcessor& processor = sonarState.activeProcessor;
+    const int beamBatchCount = (int)beamEchoes.size();
+    std::vector<std::minstd_rand> beamRandoms;
+    for (int slot = 0; slot < beamBatchCount; ++slot) {
+        std::seed_seq sequence { sonarState.seed, 0xEC40u, processor.pingCount++ };
+        beamRandoms.emplace_back(sequence);
+    }
+    std::vector<std::vector<BeamContact>> beamContacts(beamBatchCount);
+    const int threadCount = std::min(beamBatchCount, (int)std::max(1u, std::thread::hardware_concurrency()));
+    if (threadCount == 1) {
+        for (int slot = 0; slot < beamBatchCount; ++slot)
+            pingBeam(processor, *beamReverberation[slot], beamEchoes[slot], beamRandoms[slot], beamContacts[slot]);
+    } else {
+        std::vector<std::thread> workers;
+        for (int threadId = 0; threadId < threadCount; ++threadId)
+            workers.emplace_back([&, threadId] {
+                for (int slot = threadId; slot < beamBatchCount; slot += threadCount)
+                    pingBeam(processor, *beamReverberation[slot], beamEchoes[slot], beamRandoms[slot], beamContacts[slot]);
+            });
+        for (auto& worker : workers)
+            worker.join();
+    }
+    return beamContacts;
+}
+
+// a contact becomes a blip and a detection at the given bearing and its CFAR range, so what ends up on the screen is what the processing found,
+// not the truth: a target can be missed in the reverberation, a false alarm can pop up, and positions are quantized to the beam and the range cell,
+// the blip goes down in the world frame, measured from where our ship is now
+static void reportContact(SonarState& sonarState, const BeamContact& contact, float bearing, float beamWidth)
+{
+    const Ownship& ownship = sonarState.ownship;
+    float xKilometers = ownship.xKilometers + std::sin(bearing * DEG2RAD) * contact.rangeKilometers;
+    float yKilometers = ownship.yKilometers + std::cos(bearing * DEG2RAD) * contact.rangeKilometers;
+    const Target* target = contact.targetIndex >= 0 ? &sonarState.targets[contact.targetIndex] : nullptr;
+    Color color = target ? targetColors[target->colorId] : Color { 170, 170, 170, 255 };
+    float signalStrength = std::clamp(contact.excessDecibels / 30.f, 0.f, 1.f);
+    sonarState.blips.push_back({ xKilometers, yKilometers, 1.0f, color });
+    sonarState.detections.push_back(
+        { sonarState.elapsedSeconds, target ? target->id : -1, true, bearing, contact.rangeKilometers, signalStrength, 0, ownship.xKilometers, ownship.yKilometers,
+            beamWidth });
+}
+
+// multi-beam mode: beamCount fixed beams cover the whole circle and all of them ping together every multiBeamPingSeconds,
+// a full-circle picture per ping instead of one per revolution, the sweep arm plays no part,
+// every target's echo level goes into every beam through the beam pattern, a gaussian main lobe -3 dB at the beam's edges
+// (-12 dB per beam width squared off its axis), so a target between two beams shows in both a little weaker like a real one,
+// that's beams x targets gains per ping, computed 8 targets at a time from SoA arrays (bearing, level) with AVX,
+// pairs that come out under -40 dB (two beams away and more) are dropped right there, the rest become echoes of their beam
+static void pingMultiBeam(SonarState& sonarState)
+{
+    ActiveProcessor& processor = sonarState.activeProcessor;
+    if (sonarState.elapsedSeconds - processor.lastMultiBeamPingSeconds < multiBeamPingSeconds)
+        return;
+    processor.lastMultiBeamPingSeconds = sonarState.elapsedSeconds;
+
+    processor.targetBearings.clear();
+    processor.targetLevels.clear();
+    processor.targetCells.clear();
+    processor.targetIndices.clear();
+    TargetPaths& paths = sonarState.targetPaths;
+    clearTargetPaths(paths);
+    const OwnshipFrame& frame = transformToOwnship(sonarState);
+    for (int targetIndex = 0; targetIndex < (int)sonarState.targets.size(); ++targetIndex) {
+        float rangeKilometers = frame.rangeKilometers[targetIndex];
+        if (rangeKilometers >= 0.5f && rangeKilometers <= maximumRangeKilometers)
+            addTargetPath(paths, targetIndex, rangeKilometers, frame.bearingDegrees[targetIndex], sonarState.targets[targetIndex].depthNormalized);
+    }
+    computeOwnPathLoss(sonarState, paths);
+    for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+        float level = echoLevelDecibels - 2.f * paths.lossDecibels[pathId];
+        if (level < -40.f)
+            continue;
+        processor.targetBearings.push_back(paths.bearingDegrees[pathId]);
+        processor.targetLevels.push_back(level);
+        processor.targetCells.push_back((int)(paths.rangeKilometers[pathId] / ActiveProcessor::rangeCellKilometers));
+        processor.targetIndices.push_back(paths.targetIndices[pathId]);
+    }
+    // the fixed beams cover the whole circle so every scatterer in range is asked, they ride the same beam pattern as targets
+    queryClutter(sonarState, {});
+    for (const ClutterReturn& clutterReturn : sonarState.clutter.returns) {
+        float level = echoLevelDecibels + clutterReturn.echoOffsetDecibels;
+        if (level < -40.f)
+            continue;
+        processor.targetBearings.push_back(clutterReturn.bearingDegrees);
+        processor.targetLevels.push_back(level);
+        processor.targetCells.push_back((int)(clutterReturn.rangeKilometers / ActiveProcessor::rangeCellKilometers));
+        processor.targetIndices.push_back(-1);
+    }
+
+    const int beamCount = sonarState.multiBeamCount;
+    const float beamWidth = 360.f / beamCount;
+    const float lobeScale = -12.f / (beamWidth * beamWidth);
+    const int targetCount = (int)processor.targetBearings.size();
+    std::vector<float> beamBearings(beamCount);
+    std::vector<const std::vector<float>*> beamReverberation(beamCount);
+    std::vector<std::vector<BeamEcho>> beamEchoes(beamCount);
+    auto addEcho = [&](int beamId, int slot, float level) {
+        beamEchoes[beamId].push_back({ processor.targetCells[slot], std::pow(10.f, level / 20.f), processor.targetIndices[slot] });
+    };
+    for (int beamId = 0; beamId < beamCount; ++beamId) {
+        const float beamBearing = beamBearings[beamId] = (beamId + 0.5f) * beamWidth;
+        beamReverberation[beamId] = &reverberationFor(processor, transmissionLossToward(sonarState, beamBearing));
+        int slot = 0;
+#ifdef __AVX2__
+        const __m256 center = _mm256_set1_ps(beamBearing), full = _mm256_set1_ps(360.f);
+        const __m256 scale = _mm256_set1_ps(lobeScale), floor = _mm256_set1_ps(-40.f), sign = _mm256_set1_ps(-0.f);
+        for (; slot + 8 <= targetCount; slot += 8) {
+            // |Δ| folded into [0, 180]: |b - c|, then 360 - that when it went the long way round
+            __m256 offset = _mm256_andnot_ps(sign, _mm256_sub_ps(_mm256_loadu_ps(&processor.targetBearings[slot]), center));
+            offset = _mm256_min_ps(offset, _mm256_sub_ps(full, offset));
+            __m256 level = _mm256_add_ps(_mm256_loadu_ps(&processor.targetLevels[slot]), _mm256_mul_ps(scale, _mm256_mul_ps(offset, offset)));
+            int audible = _mm256_movemask_ps(_mm256_cmp_ps(level, floor, _CMP_GT_OQ));
+            if (audible == 0)
+                continue; // the usual case, most targets are nowhere near most beams
+            alignas(32) float levels[8];
+            _mm256_store_ps(levels, level);
+            for (; audible; audible &= audible - 1)
+                addEcho(beamId, slot + std::countr_zero((unsigned)audible), levels[std::countr_zero((unsigned)audible)]);
+        }
+#endif
+        for (; slot < targetCount; ++slot) {
+            float offset = std::abs(processor.targetBearings[slot] - beamBearing);
+            offset = std::min(offset, 360.f - offset);
+            float level = processor.targetLevels[slot] + lobeScale * offset * offset;
+            if (level > -40.f)
+                addEcho(beamId, slot, level);
+        }
+    }
+    std::vector<std::vector<BeamContact>> beamContacts = pingBeams(sonarState, beamEchoes, beamReverberation);
+
+    // a target between two beams is heard by both, one contact per target is kept: the one whose neighbours at the same range are weaker,
+    // and since the lobe is a parabola in dB its bearing is interpolated from a neighbour's level: with levels a (ours) and b (a neighbour
+    // one beam width w away) of a target d off our axis, a = L + s·d² and b = L + s·(d - w)², so d = (a - b) / (2·s·w) + w/2
+    for (int beamId = 0; beamId < beamCount; ++beamId)
+        for (const BeamContact& contact : beamContacts[beamId]) {
+            bool strongest = true;
+            float neighbourExcess = -1e9f;
+            float neighbourSide = 0.f;
+            for (int side : { -1, 1 }) {
+                int neighbourId = (beamId + side + beamCount) % beamCount;
+                for (const BeamContact& neighbour : beamContacts[neighbourId]) {
+                    if (std::abs(neighbour.rangeKilometers - contact.rangeKilometers) > associationCells * ActiveProcessor::rangeCellKilometers)
+                        continue;
+                    strongest = strongest
+                        && (neighbour.excessDecibels < contact.excessDecibels || (neighbour.excessDecibels == contact.excessDecibels && neighbourId > beamId));
+                    if (neighbour.excessDecibels > neighbourExcess) {
+                        neighbourExcess = neighbour.excessDecibels;
+                        neighbourSide = (float)side;
+                    }
+                }
+            }
+            if (!strongest)
+                continue;
+            float offset = 0.f;
+            if (neighbourSide != 0.f)
+                offset = std::clamp((contact.excessDecibels - neighbourExcess) / (2.f * lobeScale * beamWidth) + beamWidth / 2.f, 0.f, beamWidth / 2.f);
+            reportContact(sonarState, contact, std::fmod(beamBearings[beamId] + neighbourSide * offset + 360.f, 360.f), beamWidth);
+        }
+}
+
+#pragma region echo
+// rotating sweep: collects the beams the sweep arm finished this tick, then every pingBatchSeconds pings all of them at once,
+// every target sitting in one of those beams returns an echo at its range, two-way transmission loss from the ray-traced field at its depth,
+// and so do the clutter scatterers there (see clutter.cpp), CFAR can't tell them apart, they come out as grey contacts,
+// multi-beam mode pings every fixed beam together instead (see pingMultiBeam)
+void updateActivePings(SonarState& sonarState)
+{
+    ActiveProcessor& processor = sonarState.activeProcessor;
+    if (!sonarState.activeMode) {
+        processor.pendingBeams.clear();
+        return;
+    }
+    if (processor.plan.size == 0)
+        buildPulse(processor);
+    // every field ever seen keeps its profile, an environment moving under a travelling ship would pile them up
+    if (processor.reverberationAmplitudes.size() > 64)
+        processor.reverberationAmplitudes.clear();
+    if (sonarState.multiBeamCount > 0) {
+        processor.pendingBeams.clear();
+        pingMultiBeam(sonarState);
+        return;
+    }
+
+    constexpr float beamWidth = ActiveProcessor::beamWidthDegrees;
+    for (int beamId = (int)(sonarState.previousSweepDegrees / beamWidth) % ActiveProcessor::beamCount;
+         beamId != (int)(sonarState.sweepAngleDegrees / beamWidth) % ActiveProcessor::beamCount; beamId = (beamId + 1) % ActiveProcessor::beamCount)
+        processor.pendingBeams.push_back(beamId);
+    if (sonarState.elapsedSeconds - processor.lastBatchSeconds < pingBatchSeconds || processor.pendingBeams.empty())
+        return;
+    processor.lastBatchSeconds = sonarState.elapsedSeconds;
+
+    // which pending slot (if any) each beam is, then bucket every target into its beam
+    const int beamBatchCount = (int)processor.pendingBeams.size();
+    std::array<int, ActiveProcessor::beamCount> beamSlot;
+    beamSlot.fill(-1);
+    for (int slot = 0; slot < beamBatchCount; ++slot)
+        beamSlot[processor.pendingBeams[slot]] = slot;
+    std::vector<std::vector<BeamEcho>> beamEchoes(beamBatchCount);
+    TargetPaths& paths = sonarState.targetPaths;
+    clearTargetPaths(paths);
+    const OwnshipFrame& frame = transformToOwnship(sonarState);
+    for (int targetIndex = 0; targetIndex < (int)sonarState.targets.size(); ++targetIndex) {
+        float bearing = frame.bearingDegrees[targetIndex];
+        if (beamSlot[(int)(bearing / beamWidth) % ActiveProcessor::beamCount] < 0)
+            continue;
+        float rangeKilometers = frame.rangeKilometers[targetIndex];
+        if (rangeKilometers >= 0.5f && rangeKilometers <= maximumRangeKilometers)
+            addTargetPath(paths, targetIndex, rangeKilometers, bearing, sonarState.targets[targetIndex].depthNormalized);
+    }
+    computeOwnPathLoss(sonarState, paths);
+    for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+        float level = echoLevelDecibels - 2.f * paths.lossDecibels[pathId];
+        if (level < -40.f)
+            continue; // a hundredth of the noise, can't matter
+        int slot = beamSlot[(int)(paths.bearingDegrees[pathId] / beamWidth) % ActiveProcessor::beamCount];
+        beamEchoes[slot].push_back(
+            { (int)(paths.rangeKilometers[pathId] / ActiveProcessor::rangeCellKilometers), std::pow(10.f, level / 20.f), paths.targetIndices[pathId] });
+    }
+    // clutter of the swept beams only, through the polar grid
+    queryClutter(sonarState, processor.pendingBeams);
+    for (const ClutterReturn& clutterReturn : sonarState.clutter.returns) {
+        float level = echoLevelDecibels + clutterReturn.echoOffsetDecibels;
+        int slot = beamSlot[(int)(clutterReturn.bearingDegrees / beamWidth) % ActiveProcessor::beamCount];
+        if (level >= -40.f && slot >= 0)
+            beamEchoes[slot].push_back({ (int)(clutterReturn.rangeKilometers / ActiveProcessor::rangeCellKilometers), std::pow(10.f, level / 20.f), -1 });
+    }
+
+    std::vector<const std::vector<float>*> beamReverberation(beamBatchCount);
+    for (int slot = 0; slot < beamBatchCount; ++slot)
+        beamReverberation[slot] = &reverberationFor(processor, transmissionLossToward(sonarState, (processor.pendingBeams[slot] + 0.5f) * beamWidth));
+    std::vector<std::vector<BeamContact>> beamContacts = pingBeams(sonarState, beamEchoes, beamReverberation);
+    for (int slot = 0; slot < beamBatchCount; ++slot)
+        for (const BeamContact& contact : beamContacts[slot])
+            reportContact(sonarState, contact, (processor.pendingBeams[slot] + 0.5f) * beamWidth, beamWidth);
+    processor.pendingBeams.clear();
+}
@@ -0,0 +1,101 @@
+#include "ppi.hpp"
+
+#pragma region environment
+// reads a gridded sound speed file, same "keyword values..." lines as scenarios, # starts a comment (see ppi/environment.txt), ex:
+//   grid 17 17 11 12.5            -> 17 columns east x 17 north, 12.5 km apart, each a profile of 11 depths from surface to bottom
+//   default 1523 1505 ... 1482    -> the profile of every column not given below (11 speeds in m/s, surface first)
+//   column 3 12 1524 1512 ... 1490 -> the profile of column 3 east, 12 north (0, 0 is the south-west corner)
+// speeds are stored as cm/s off 1500 m/s in 16 bits, every column must end up with a profile, unknown keywords throw with the line number
+std::shared_ptr<const OceanEnvironment> loadEnvironment(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open: " + path);
+
+    auto environment = std::make_shared<OceanEnvironment>();
+    std::vector<char> columnSet;
+    std::vector<float> defaultProfile;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword))
+            continue;
+        auto fail = [&](const std::string& reason) { throw std::runtime_error(path + ":" + std::to_string(lineNumber) + " " + reason); };
+        auto readProfile = [&](std::vector<float>& profile) {
+            profile.resize(environment->depthCount);
+            for (float& speed : profile)
+                if (!(words >> speed) || speed < 1400.f || speed > 1600.f)
+                    fail("a profile needs " + std::to_string(environment->depthCount) + " speeds between 1400 and 1600 m/s");
+        };
+
+        if (keyword == "grid") {
+            if (environment->depthCount > 0)
+                fail("grid given twice");
+            if (!(words >> environment->eastCount >> environment->northCount >> environment->depthCount >> environment->cellKilometers)
+                || environment->eastCount < 1 || environment->northCount < 1 || environment->depthCount < 2 || environment->cellKilometers <= 0.f)
+                fail("grid needs <east columns> <north columns> <depth samples (2+)> <cell km>");
+            environment->speedCentimeters.assign((size_t)environment->eastCount * environment->northCount * environment->depthCount, 0);
+            columnSet.assign((size_t)environment->eastCount * environment->northCount, 0);
+        } else if (keyword == "default" || keyword == "column") {
+            if (environment->depthCount == 0)
+                fail(keyword + " before grid");
+            if (keyword == "default") {
+                readProfile(defaultProfile);
+                continue;
+            }
+            int east, north;
+            if (!(words >> east >> north) || east < 0 || north < 0 || east >= environment->eastCount || north >= environment->northCount)
+                fail("column needs <east index> <north index> inside the grid, then its profile");
+            std::vector<float> profile;
+            readProfile(profile);
+            int columnId = north * environment->eastCount + east;
+            for (int depthId = 0; depthId < environment->depthCount; ++depthId)
+                environment->speedCentimeters[(size_t)columnId * environment->depthCount + depthId] = (int16_t)std::lround((profile[depthId] - 1500.f) * 100.f);
+            columnSet[columnId] = 1;
+        } else {
+            fail("unknown keyword " + keyword);
+        }
+    }
+    if (environment->depthCount == 0)
+        throw std::runtime_error(path + " has no grid line");
+    for (int columnId = 0; columnId < (int)columnSet.size(); ++columnId) {
+        if (columnSet[columnId])
+            continue;
+        if (defaultProfile.empty())
+            throw std::runtime_error(path + " leaves column " + std::to_string(columnId % environment->eastCount) + " "
+                + std::to_string(columnId / environment->eastCount) + " without a profile and has no default");
+        for (int depthId = 0; depthId < environment->depthCount; ++depthId)
+            environment->speedCentimeters[(size_t)columnId * environment->depthCount + depthId] = (int16_t)std::lround((defaultProfile[depthId] - 1500.f) * 100.f);
+    }
+    return environment;
+}
+
+// trilinear interpolation between the 8 samples around a point, the grid is centered on our ship's starting point
+// so column (east, north) sits at ((east - (eastCount - 1) / 2) · cell, (north - (northCount - 1) / 2) · cell) km,
+// points outside the grid take the nearest edge column (the water carries on as it was at the edge)
+float environmentSpeedMetersPerSecond(const OceanEnvironment& environment, float xKilometers, float yKilometers, float normalizedDepth)
+{
+    auto position = [](float kilometers, float cellKilometers, int count, int& index, float& blend) {
+        float cell = std::clamp(kilometers / cellKilometers + (count - 1) / 2.f, 0.f, count - 1.f);
+        index = std::min((int)cell, std::max(count - 2, 0));
+        blend = cell - index;
+    };
+    int east, north, depth;
+    float eastBlend, northBlend, depthBlend;
+    position(xKilometers, environment.cellKilometers, environment.eastCount, east, eastBlend);
+    position(yKilometers, environment.cellKilometers, environment.northCount, north, northBlend);
+    float depthPosition = std::clamp(normalizedDepth, 0.f, 1.f) * (environment.depthCount - 1);
+    depth = std::min((int)depthPosition, environment.depthCount - 2);
+    depthBlend = depthPosition - depth;
+    const int eastStep = environment.eastCount > 1 ? environment.depthCount : 0;
+    const int northStep = environment.northCount > 1 ? environment.eastCount * environment.depthCount : 0;
+    const int16_t* sample = &environment.speedCentimeters[((size_t)north * environment.eastCount + east) * environment.depthCount + depth];
+    auto alongDepth = [&](const int16_t* column) { return column[0] + (column[1] - column[0]) * depthBlend; };
+    float south = alongDepth(sample) + (alongDepth(sample + eastStep) - alongDepth(sample)) * eastBlend;
+    float northSide = alongDepth(sample + northStep) + (alongDepth(sample + northStep + eastStep) - alongDepth(sample + northStep)) * eastBlend;
+    return 1500.f + (south + (northSide - south) * northBlend) / 100.f;
+}
@@ -0,0 +1,93 @@
+#include "ppi.hpp"
+
+#pragma region fft
+// precomputes everything a size-n FFT needs so each call is only butterflies:
+// - the bit-reversal permutation (index 6 = 110b of an 8-point FFT swaps with 011b = 3), the iterative FFT wants its input in that order
+// - the twiddle factors e^(-2πi·j / 2h) of every stage, stage with half-size h stored at [h - 1, 2h - 1) so a stage reads them contiguously
+FftPlan makeFftPlan(int size)
+{
+    if (size < 2 || (size & (size - 1)) != 0)
+        throw std::runtime_error("FFT size must be a power of two: " + std::to_string(size));
+    FftPlan plan;
+    plan.size = size;
+    int bitCount = 0;
+    while ((1 << bitCount) < size)
+        ++bitCount;
+    plan.bitReverse.resize(size);
+    for (int index = 0; index < size; ++index) {
+        int reversed = 0;
+        for (int bit = 0; bit < bitCount; ++bit)
+            reversed |= ((index >> bit) & 1) << (bitCount - 1 - bit);
+        plan.bitReverse[index] = reversed;
+    }
+    plan.twiddleReal.resize(size - 1);
+    plan.twiddleImag.resize(size - 1);
+    for (int half = 1; half < size; half *= 2)
+        for (int twiddleId = 0; twiddleId < half; ++twiddleId) {
+            double angle = -M_PI * twiddleId / half;
+            plan.twiddleReal[half - 1 + twiddleId] = (float)std::cos(angle);
+            plan.twiddleImag[half - 1 + twiddleId] = (float)std::sin(angle);
+        }
+    return plan;
+}
+
+// in-place radix-2 decimation-in-time FFT on split real/imaginary arrays, X(k) = Σ x(n)·e^(-2πi·kn/N),
+// each stage combines pairs of half-size transforms h apart: top = a + w·b, bottom = a - w·b (the "butterfly"),
+// keeping real and imaginary parts in separate arrays means 8 consecutive butterflies are exactly one AVX register per quantity,
+// so every stage from h = 8 up runs 8 butterflies per instruction, the first three stages (h = 1, 2, 4) are too short and stay scalar
+void fft(const FftPlan& plan, float* real, float* imag)
+{
+    const int size = plan.size;
+    for (int index = 0; index < size; ++index) {
+        int reversed = plan.bitReverse[index];
+        if (index < reversed) {
+            std::swap(real[index], real[reversed]);
+            std::swap(imag[index], imag[reversed]);
+        }
+    }
+
+    for (int half = 1; half < size; half *= 2) {
+        const float* twiddleReal = plan.twiddleReal.data() + half - 1;
+        const float* twiddleImag = plan.twiddleImag.data() + half - 1;
+        for (int start = 0; start < size; start += 2 * half) {
+            float* topReal = real + start;
+            float* topImag = imag + start;
+            float* bottomReal = topReal + half;
+            float* bottomImag = topImag + half;
+            int pairId = 0;
+#ifdef __AVX2__
+            for (; pairId + 8 <= half; pairId += 8) {
+                __m256 wReal = _mm256_loadu_ps(twiddleReal + pairId), wImag = _mm256_loadu_ps(twiddleImag + pairId);
+                __m256 bReal = _mm256_loadu_ps(bottomReal + pairId), bImag = _mm256_loadu_ps(bottomImag + pairId);
+                __m256 productReal = _mm256_sub_ps(_mm256_mul_ps(bReal, wReal), _mm256_mul_ps(bImag, wImag));
+                __m256 productImag = _mm256_add_ps(_mm256_mul_ps(bReal, wImag), _mm256_mul_ps(bImag, wReal));
+                __m256 aReal = _mm256_loadu_ps(topReal + pairId), aImag = _mm256_loadu_ps(topImag + pairId);
+                _mm256_storeu_ps(topReal + pairId, _mm256_add_ps(aReal, productReal));
+                _mm256_storeu_ps(topImag + pairId, _mm256_add_ps(aImag, productImag));
+                _mm256_storeu_ps(bottomReal + pairId, _mm256_sub_ps(aReal, productReal));
+                _mm256_storeu_ps(bottomImag + pairId, _mm256_sub_ps(aImag, productImag));
+            }
+#endif
+            for (; pairId < half; ++pairId) {
+                float productReal = bottomReal[pairId] * twiddleReal[pairId] - bottomImag[pairId] * twiddleImag[pairId];
+                float productImag = bottomReal[pairId] * twiddleImag[pairId] + bottomImag[pairId] * twiddleReal[pairId];
+                bottomReal[pairId] = topReal[pairId] - productReal;
+                bottomImag[pairId] = topImag[pairId] - productImag;
+                topReal[pairId] += productReal;
+                topImag[pairId] += productImag;
+            }
+        }
+    }
+}
+
+// the inverse transform is the forward one with real and imaginary swapped on the way in and out (conj(FFT(conj(x))) / N),
+// swapping the two array pointers does that for free
+void inverseFft(const FftPlan& plan, float* real, float* imag)
+{
+    fft(plan, imag, real);
+    const float scale = 1.f / plan.size;
+    for (int index = 0; index < plan.size; ++index) {
+        real[index] *= scale;
+        imag[index] *= scale;
+    }
+}
@@ -0,0 +1,200 @@
+#include "ppi.hpp"
+
+#pragma region fusion utils
+// a passive bearing alone says "something is along this line", two sensors' lines cross at a point, which is a position fix,
+// but with many contacts every pair of lines crosses somewhere, mostly at ghosts where no contact is, a third sensor's line
+// through the same point is what tells a real contact from a ghost, so fixes need three sensors whenever three are listening,
+// testing every line against every other is (sensors x contacts)² pairs, instead every line is drawn into a grid and each cell
+// collects one bit per sensor that crossed it, the cells crossed by enough sensors are where fixes can be
+constexpr double fusionBatchSeconds = 0.25; // one per frame of the passive sensors, all their bearings are from the same instant
+constexpr float fusionCellKilometers = 2.f; // wide enough that a 0.5° bearing error at 100 km (0.9 km) stays in the crossing cell
+constexpr int fusionGridSide = (int)(2.f * maximumRangeKilometers / fusionCellKilometers); // 100x100 cells over ±100 km around our ship
+constexpr float fixGateKilometers = 1.f; // a line further than that from the refined fix is another contact's line, ~2σ at 100 km
+// with many sensors listening three lines meet by chance all over the plot, but a real contact is heard by most sensors around it,
+// so a crossing also needs at least half of the listening sensors within this range of it
+constexpr float hearingRangeKilometers = 50.f;
+// the display lights a bin from 3 dB but every noise ripple over that would become a line here, a bearing has to stand out more
+// and be the peak of its ±2° so the skirt of one loud beam doesn't give several
+constexpr float ownShipThresholdDecibels = 6.f;
+constexpr int ownShipPeakBins = 4;
+
+// the bearing of sensor s closest to the direction from that sensor to a point, binary search in the sensor's sorted bearings
+// with both ends checked across north (359.8° is right next to 0.1°)
+static const BearingLine* nearestBearing(const Fusion& fusion, int sensorId, float xKilometers, float yKilometers)
+{
+    const BearingLine* first = fusion.bearings.data() + fusion.sensorStart[sensorId];
+    const BearingLine* last = fusion.bearings.data() + fusion.sensorStart[sensorId + 1];
+    if (first == last)
+        return nullptr;
+    float direction = std::fmod(std::atan2(xKilometers - first->sensorXKilometers, yKilometers - first->sensorYKilometers) * RAD2DEG + 360.f, 360.f);
+    const BearingLine* above = std::lower_bound(first, last, direction, [](const BearingLine& line, float bearing) { return line.bearingDegrees < bearing; });
+    const BearingLine* below = above == first ? last - 1 : above - 1;
+    if (above == last)
+        above = first;
+    auto gap = [&](const BearingLine* line) { return 180.f - std::abs(std::fmod(std::abs(line->bearingDegrees - direction), 360.f) - 180.f); };
+    return gap(below) < gap(above) ? below : above;
+}
+
+// least-squares crossing point of the given sensors' lines near a starting point: the point minimizing the summed squared perpendicular
+// distances to lines (s, d) solves Σ(I - d·dᵀ)·p = Σ(I - d·dᵀ)·s, I - d·dᵀ projects onto the line's normal,
+// each pass re-picks every sensor's line nearest to the current estimate and drops lines beyond the gate,
+// fails when too few lines remain or they're close to parallel (two sensors looking along the same line can't place anything on it),
+// on success the indices of the lines the fix rests on are appended to candidateLines
+static bool refineFix(Fusion& fusion, uint64_t sensorMask, int minimumSensors, Eigen::Vector2f position, Fix& fix)
+{
+    const size_t firstLine = fusion.candidateLines.size();
+    for (int pass = 0; pass < 3; ++pass) {
+        fusion.candidateLines.resize(firstLine);
+        Eigen::Matrix2f normalSum = Eigen::Matrix2f::Zero();
+        Eigen::Vector2f rightSide = Eigen::Vector2f::Zero();
+        int lineCount = 0;
+        float worstKilometers = 0.f;
+        for (uint64_t remaining = sensorMask; remaining; remaining &= remaining - 1) {
+            int sensorId = std::countr_zero(remaining);
+            const BearingLine* line = nearestBearing(fusion, sensorId, position.x(), position.y());
+            Eigen::Vector2f origin(line->sensorXKilometers, line->sensorYKilometers);
+            Eigen::Vector2f direction(std::sin(line->bearingDegrees * DEG2RAD), std::cos(line->bearingDegrees * DEG2RAD));
+            Eigen::Vector2f offset = position - origin;
+            float distance = std::abs(offset.x() * direction.y() - offset.y() * direction.x());
+            if ((pass > 0 && distance > fixGateKilometers) || offset.dot(direction) < 0.f)
+                continue; // first pass keeps every line through the cell, it's the cell center we start from that's coarse
+            Eigen::Matrix2f projection = Eigen::Matrix2f::Identity() - direction * direction.transpose();
+            normalSum += projection;
+            rightSide += projection * origin;
+            worstKilometers = std::max(worstKilometers, distance);
+            fusion.candidateLines.push_back((int)(line - fusion.bearings.data()));
+            ++lineCount;
+        }
+        if (lineCount < minimumSensors || normalSum.determinant() < 0.05f) {
+            fusion.candidateLines.resize(firstLine);
+            return false;
+        }
+        position = normalSum.inverse() * rightSide;
+        fix = { position.x(), position.y(), lineCount, worstKilometers };
+    }
+    if (fix.residualKilometers > fixGateKilometers) {
+        fusion.candidateLines.resize(firstLine);
+        return false;
+    }
+    return true;
+}
+
+#pragma region fusion
+// every fusionBatchSeconds gathers the latest passive bearings of every listening sensor (ours from the beamformer's peaks, the remote ones
+// from their last frame), rasterizes each line into the grid by stepping a quarter cell at a time from its sensor out to maximum range,
+// then every cell crossed by enough sensors that is also the best of its 3x3 neighbourhood is refined into a fix,
+// the bits don't say which of a sensor's lines crossed the cell, refineFix finds out with a binary search per sensor
+void updateFusion(SonarState& sonarState)
+{
+    Fusion& fusion = sonarState.fusion;
+    if (sonarState.elapsedSeconds - fusion.lastBatchSeconds < fusionBatchSeconds)
+        return;
+    fusion.lastBatchSeconds = sonarState.elapsedSeconds;
+    fusion.bearings.clear();
+    fusion.fixes.clear();
+
+    // our ship: a peak of the beam excess is a bearing, the beamformer doesn't know which target it is either
+    if (!sonarState.activeMode && sonarState.passiveArray.plan.size > 0) {
+        const auto& snr = sonarState.passiveArray.beamSnrDecibels;
+        for (int binId = 0; binId < passiveBinCount; ++binId) {
+            if (snr[binId] <= ownShipThresholdDecibels)
+                continue;
+            bool peak = true;
+            for (int offset = 1; offset <= ownShipPeakBins; ++offset)
+                peak = peak && snr[binId] >= snr[(binId + passiveBinCount - offset) % passiveBinCount] && snr[binId] > snr[(binId + offset) % passiveBinCount];
+            if (peak)
+                fusion.bearings.push_back({ sonarState.ownship.xKilometers, sonarState.ownship.yKilometers, binId * 360.f / passiveBinCount, 0 });
+        }
+    }
+    for (const Sensor& sensor : sonarState.sensors)
+        if (!sensor.activeMode)
+            for (float bearing : sensor.bearings)
+                fusion.bearings.push_back({ sensor.xKilometers, sensor.yKilometers, bearing, sensor.id });
+    std::sort(fusion.bearings.begin(), fusion.bearings.end(), [](const BearingLine& first, const BearingLine& second) {
+        return std::tie(first.sensorId, first.bearingDegrees) < std::tie(second.sensorId, second.bearingDegrees);
+    });
+    fusion.sensorStart.fill(0);
+    for (const BearingLine& line : fusion.bearings)
+        ++fusion.sensorStart[line.sensorId + 1];
+    std::vector<Eigen::Vector2f> listeningPositions;
+    for (int sensorId = 0; sensorId < maximumSensorCount; ++sensorId) {
+        if (fusion.sensorStart[sensorId + 1] > 0)
+            listeningPositions.emplace_back(fusion.bearings[fusion.sensorStart[sensorId]].sensorXKilometers, fusion.bearings[fusion.sensorStart[sensorId]].sensorYKilometers);
+        fusion.sensorStart[sensorId + 1] += fusion.sensorStart[sensorId];
+    }
+    const int listeningSensors = (int)listeningPositions.size();
+    if (listeningSensors < 2)
+        return;
+    const int minimumSensors = std::min(listeningSensors, 3);
+
+    // the grid is centered on our ship, a sensor our ship sailed away from can sit outside it with its lines reaching in
+    const float gridLeft = sonarState.ownship.xKilometers - maximumRangeKilometers, gridBottom = sonarState.ownship.yKilometers - maximumRangeKilometers;
+    fusion.cellSensors.assign(fusionGridSide * fusionGridSide, 0);
+    constexpr float stepKilometers = fusionCellKilometers / 4.f;
+    for (const BearingLine& line : fusion.bearings) {
+        float directionX = std::sin(line.bearingDegrees * DEG2RAD), directionY = std::cos(line.bearingDegrees * DEG2RAD);
+        uint64_t sensorBit = 1ull << line.sensorId;
+        bool entered = false;
+        for (float distance = 0.f; distance <= maximumRangeKilometers; distance += stepKilometers) {
+            int column = (int)std::floor((line.sensorXKilometers + directionX * distance - gridLeft) / fusionCellKilometers);
+            int row = (int)std::floor((line.sensorYKilometers + directionY * distance - gridBottom) / fusionCellKilometers);
+            if (column < 0 || row < 0 || column >= fusionGridSide || row >= fusionGridSide) {
+                if (entered)
+                    break; // the grid is convex, a line that left it never comes back
+                continue;
+            }
+            entered = true;
+            fusion.cellSensors[row * fusionGridSide + column] |= sensorBit;
+        }
+    }
+
+    fusion.candidates.clear();
+    fusion.candidateLineStart.assign(1, 0);
+    fusion.candidateLines.clear();
+    for (int cellId = 0; cellId < fusionGridSide * fusionGridSide; ++cellId) {
+        int count = std::popcount(fusion.cellSensors[cellId]);
+        if (count < minimumSensors)
+            continue;
+        // one candidate per crossing, ties between neighbours go to the lower cell index
+        int row = cellId / fusionGridSide, column = cellId % fusionGridSide;
+        bool best = true;
+        for (int neighbourRow = std::max(0, row - 1); neighbourRow <= std::min(fusionGridSide - 1, row + 1); ++neighbourRow)
+            for (int neighbourColumn = std::max(0, column - 1); neighbourColumn <= std::min(fusionGridSide - 1, column + 1); ++neighbourColumn) {
+                int neighbour = neighbourRow * fusionGridSide + neighbourColumn;
+                int neighbourCount = std::popcount(fusion.cellSensors[neighbour]);
+                best = best && (neighbourCount < count || (neighbourCount == count && neighbour >= cellId));
+            }
+        if (!best)
+            continue;
+
+        Eigen::Vector2f cellCenter(gridLeft + (column + 0.5f) * fusionCellKilometers, gridBottom + (row + 0.5f) * fusionCellKilometers);
+        int nearbySensors = (int)std::count_if(listeningPositions.begin(), listeningPositions.end(),
+            [&](const Eigen::Vector2f& position) { return (position - cellCenter).norm() < hearingRangeKilometers; });
+        int requiredSensors = std::max(minimumSensors, (nearbySensors + 1) / 2);
+        Fix fix;
+        if (count < requiredSensors || !refineFix(fusion, fusion.cellSensors[cellId], requiredSensors, cellCenter, fix))
+            continue;
+        fusion.candidates.push_back(fix);
+        fusion.candidateLineStart.push_back((int)fusion.candidateLines.size());
+    }
+
+    // a bearing is one contact's, so a line can support one fix only: candidates are taken best first (most sensors, then tightest)
+    // and any candidate reusing a line already taken is dropped, most ghosts are made of lines that really belong to other fixes
+    // (the same greedy assignment the tracker does between tracks and detections)
+    std::vector<int> order(fusion.candidates.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int first, int second) {
+        return std::make_tuple(-fusion.candidates[first].sensorCount, fusion.candidates[first].residualKilometers, first)
+            < std::make_tuple(-fusion.candidates[second].sensorCount, fusion.candidates[second].residualKilometers, second);
+    });
+    fusion.lineTaken.assign(fusion.bearings.size(), 0);
+    for (int candidateId : order) {
+        const int* first = fusion.candidateLines.data() + fusion.candidateLineStart[candidateId];
+        const int* last = fusion.candidateLines.data() + fusion.candidateLineStart[candidateId + 1];
+        if (std::any_of(first, last, [&](int lineId) { return fusion.lineTaken[lineId]; }))
+            continue; // also removes neighbouring candidates of one crossing that refined to the same lines
+        for (const int* lineId = first; lineId != last; ++lineId)
+            fusion.lineTaken[*lineId] = 1;
+        fusion.fixes.push_back(fusion.candidates[candidateId]);
+    }
+}
@@ -1,6 +1,6 @@
 #include "ppi.hpp"
 
-#pragma region update utils
+#pragma region draw utils
 // converts bearing (angle) to unit 2D vector pointing in that direction so we can scale it by a distance and get a position,
 // ex: bearing 0° (north) -> (0, -1) in screen space because screen y increases downward, so "up" on screen is negative y,
 // ex: bearing 90° (east) -> (1, 0),  bearing 270° (west) -> (-1, 0)
@@ -11,205 +11,39 @@ static Vector2 bearingToDirection(float bearingDegrees)
     return { std::sin(radians), -std::cos(radians) };
 }
 
-// checks whether a target's bearing falls inside the "slice of pie" the sweep arm just rotated through,
-// we need this because at high frame rates the arm moves only a tiny arc per frame, but we still need to detect
-// every target the arm passes over, so instead of checking one exact angle we check an arc,
-// all three angles are normalised into [0°, 360°) first to handle wrap-around (ex: 365° -> 5°),
-// then we measure the clockwise arc length from arcStart to arcEnd, and check whether the clockwise distance from arcStart to bearing fits inside that arc
-// ex: arcStart=355°, arcEnd=5°, bearing=2° -> arcLength=10°, offsetToBearing=7° -> 7<=10 -> true (inside)
-static bool bearingInArc(float bearing, float arcStart, float arcEnd)
-{
-    bearing = std::fmod(bearing + 360.f, 360.f);
-    arcStart = std::fmod(arcStart + 360.f, 360.f);
-    arcEnd = std::fmod(arcEnd + 360.f, 360.f);
-    float arcLength = std::fmod(arcEnd - arcStart + 360.f, 360.f);
-    float offsetToBearing = std::fmod(bearing - arcStart + 360.f, 360.f);
-    return offsetToBearing <= arcLength;
-}
-
-// returns the sound speed at a given normalizedDepth (0.0 = surface, 1.0 = deepest),
-// above the thermocline: speed linearly drops from surfaceSpeed down to minimumSpeed as you go deeper,
-// below the thermocline: speed linearly rises from minimumSpeed back up toward deepSpeed (the SOFAR channel effect),
-// the 1e-4 added to each denominator prevents a divide-by-zero when the thermocline is at exactly 0 or 1
-static float soundSpeedMetersPerSecond(float normalizedDepth, float thermoclineNormalized, float deepSpeedBoost)
-{
-    float surfaceSpeed = 1450.f + 3.5f * surfaceTemperature; // warmer surface = faster sound
-    float minimumSpeed = surfaceSpeed - 80.f; // the slowest point, right at the thermocline boundary
-    float deepSpeed = minimumSpeed + deepSpeedBoost * 100.f; // how much speed recovers in the deep layer
-    if (normalizedDepth <= thermoclineNormalized)
-        return surfaceSpeed - (surfaceSpeed - minimumSpeed) * (normalizedDepth / (thermoclineNormalized + 1e-4f));
-    return minimumSpeed + (deepSpeed - minimumSpeed) * ((normalizedDepth - thermoclineNormalized) / (1.f - thermoclineNormalized + 1e-4f));
-}
-
-// the thermocline creates a "shadow zone", when a ping or noise crosses it, some of the sound energy is
-// refracted (bent) sideways and never reaches the other side, this returns extra signal loss in decibels (dB) for a target beyond the shadow boundary,
-// decibels are logarithmic: +10 dB ≈ 10x more power lost, so even 18 dB of extra loss cuts signal severely,
-// no loss at all if the target is closer than the shadow edge, or if the thermocline is negligibly shallow
-static float shadowLossDecibels(float rangeKilometers, float thermoclineNormalized, float deepSpeedBoost)
-{
-    float shadowKilometers = thermoclineNormalized * maximumRangeKilometers; // where the shadow zone begins
-    if (rangeKilometers <= shadowKilometers || shadowKilometers < 1.f)
-        return 0.f;
-    // log10(range/shadow) grows slowly: at 2x the shadow range -> ~5 dB, at 10x -> ~18 dB
-    return 18.f * (1.f - deepSpeedBoost) * std::log10(rangeKilometers / shadowKilometers);
-}
-
-// sound spreading in 3D (spherical) follows 20·log10(r), but because the sound travels to target then back to us,
-// the signal degrades much faster than passive (40 dB per decade vs 20),
-// the 78 dB Figure of Merit (FOM) means a ping that travels far enough loses all detectable energy,
-// 40·log10(100) = 80 dB active loss, so FOM needs to be just above 80 to detect at 100km, 78 means you start losing 100km contacts first
-// returns a 0 to 1 fraction where 1.0 = perfect echo, 0.0 = completely lost in noise,
-// the 40*log10 term is called "two-way transmission loss", doubling the range loses ~12 dB in this model,
-// (real active sonar also accounts for sea-state noise, target strength, and reverberation, but this is a clean sim)
-static float activeSignalStrength(float rangeKilometers, float thermoclineNormalized, float deepSpeedBoost)
-{
-    if (rangeKilometers < 0.1f)
-        return 1.f; // essentially on top of us, perfect signal
-    float transmissionLoss = 40.f * std::log10(rangeKilometers) + shadowLossDecibels(rangeKilometers, thermoclineNormalized, deepSpeedBoost);
-    return std::max(0.f, (78.f - transmissionLoss) / 78.f); // clamp to 0 if loss exceeds budget
-}
-
-// since sound only travels one way (target to us), the loss is half as severe (20 dB per decade vs 40),
-// and the shadow loss is halved too, less total path through the thermocline,
-// the 62 dB budget reflects that we are only fighting one-way spreading loss, 20·log10(100) = 40 dB, so 62 gives comfortable margin
-// that passive reaches a bit further than active, which is realistic (passive has no two-way loss penalty)
-static float passiveSignalStrength(float rangeKilometers, float thermoclineNormalized, float deepSpeedBoost)
+// how the PPI maps the world onto the screen this frame: centered on our ship, turned by rotationDegrees (0 north-up, our heading head-up),
+// built once per frame so every blip, track and line goes through the same two multiplies and no trigonometry of its own
+struct DisplayFrame {
+    Vector2 center;
+    float pixelsPerKilometer;
+    float originXKilometers, originYKilometers; // our ship
+    float rotationDegrees;
+    float cosine, sine; // of the rotation
+};
+
+static DisplayFrame makeDisplayFrame(const SonarSnapshot& snapshot, bool headUp, Vector2 center, float radius)
 {
-    if (rangeKilometers < 0.1f)
-        return 1.f;
-    // passive having half the path through the thermocline means half the refraction loss, hence the 0.5 factor
-    float transmissionLoss = 20.f * std::log10(rangeKilometers) + shadowLossDecibels(rangeKilometers, thermoclineNormalized, deepSpeedBoost) * 0.5f;
-    return std::max(0.f, (62.f - transmissionLoss) / 62.f);
+    float rotationDegrees = headUp ? snapshot.ownship.headingDegrees : 0.f;
+    return { center, radius / maximumRangeKilometers, snapshot.ownship.xKilometers, snapshot.ownship.yKilometers, rotationDegrees,
+        std::cos(rotationDegrees * DEG2RAD), std::sin(rotationDegrees * DEG2RAD) };
 }
 
-// spawns a target at a random position and heading somewhere in the operational area
-static Target makeTarget(int colorId)
+// world km -> screen pixels: the offset from our ship turned back by the rotation (so what's dead ahead ends up screen-up in head-up),
+// right = east·cos - north·sin, up = east·sin + north·cos, then scaled, screen y grows downward so up is subtracted,
+// ex: head-up heading 90°, a contact 10 km due east -> right 0, up 10 -> straight above our ship
+static Vector2 worldToScreen(const DisplayFrame& frame, float xKilometers, float yKilometers)
 {
-    float angle = (std::rand() % 3600) * (float)M_PI / 1800.f; // 0 to 2pi, random spawn direction
-    float distance = 15.f + std::rand() % 70; // 15 to 85 km from center
-    float speed = 1.2f + (std::rand() % 1000) * 0.001f * 3.2f; // 1.2 to 4.4 km/s
-    float course = (std::rand() % 3600) * (float)M_PI / 1800.f; // random initial heading
-    return { std::sin(angle) * distance, std::cos(angle) * distance, // initial position
-        std::sin(course) * speed, std::cos(course) * speed, // initial velocity
-        colorId, -999.f };
+    float east = xKilometers - frame.originXKilometers, north = yKilometers - frame.originYKilometers;
+    float right = east * frame.cosine - north * frame.sine, up = east * frame.sine + north * frame.cosine;
+    return { frame.center.x + right * frame.pixelsPerKilometer, frame.center.y - up * frame.pixelsPerKilometer };
 }
 
-// adjusts the live target list to match the desired count without rebuilding everything
-static void setTargetCount(SonarState& sonarState, int count)
+// a true bearing as a screen direction, the display's rotation taken off first
+static Vector2 bearingToScreen(const DisplayFrame& frame, float bearingDegrees)
 {
-    count = std::clamp(count, 1, 10);
-    while ((int)sonarState.targets.size() < count)
-        sonarState.targets.push_back(makeTarget((int)sonarState.targets.size()));
-    while ((int)sonarState.targets.size() > count)
-        sonarState.targets.pop_back();
-    sonarState.targetCount = count;
+    return bearingToDirection(bearingDegrees - frame.rotationDegrees);
 }
 
-#pragma region updates
-// moves every target forward by one time step using dead-reckoning (position += velocity * time),
-// "dead reckoning" is the nautical term for estimating current position based on last known position plus speed and heading
-// speedScale ties target movement to the sweep speed so faster sweeps feel like a more active simulation,
-// if a target drifts past 88% of the maximum range it is near the edge of the display,
-// so we redirect its heading back toward center with up to 30° of random wobble to keep contacts visible
-static void updateTargets(SonarState& sonarState, float deltaTime)
-{
-    float speedScale = sonarState.sweepSpeedDegreesPerSecond / 90.f; // 1.0 at default 90 dps
-    for (auto& target : sonarState.targets) {
-        target.xKilometers += target.velocityX * speedScale * deltaTime;
-        target.yKilometers += target.velocityY * speedScale * deltaTime;
-        float distance = std::hypot(target.xKilometers, target.yKilometers); // straight-line dist from center
-        if (distance > maximumRangeKilometers * 0.88f) {
-            // atan2 of the negated position gives the inward-pointing bearing (back toward center),
-            // then add up to 30 degrees of random wobble so targets don't all funnel to the same spot
-            float angle = std::atan2(-target.xKilometers, -target.yKilometers) + ((std::rand() % 60) - 30) * DEG2RAD;
-            float speed = std::hypot(target.velocityX, target.velocityY); // preserve the target's current speed
-            target.velocityX = std::sin(angle) * speed;
-            target.velocityY = std::cos(angle) * speed;
-        }
-    }
-}
-
-// for each target, checks whether the sweep arm just crossed its bearing, if so, records an echo (active mode) or a directional hit (passive mode)
-// detection only registers if the arm's arc this frame covered that bearing + enough time has passed since the last detection on this target
-// (prevents re-firing every frame),
-// active mode -> compute screen pixel position from bearing + range, push a fading blip dot at that location,
-// passive mode -> map bearing to one of the 720 angular bins and light that bin up,
-static void updateDetections(SonarState& sonarState, Vector2 center, float radius)
-{
-    // one full revolution takes 360/sweepSpeed seconds, require 85% of that before re-detecting the same target
-    // this mimics real PPI behavior where a contact appears once per sweep, not continuously on every frame
-    float revolutionSeconds = 360.f / sonarState.sweepSpeedDegreesPerSecond;
-    float minimumInterval = revolutionSeconds * 0.85f;
-
-    for (auto& target : sonarState.targets) {
-        float rangeKilometers = std::hypot(target.xKilometers, target.yKilometers);
-        // too close (inside own-ship noise floor) or too far (off the display)
-        if (rangeKilometers < 0.5f || rangeKilometers > maximumRangeKilometers)
-            continue;
-
-        // reverse of bearingToDirection, given a position in (x km east, y km north) relative to our ship, compute the compass bearing to it,
-        // atan2(x, y) gives the clockwise-from-north angle in radians (x first then y is deliberate, standard atan2 is from-east,
-        // we want from-north so we swap), the +360 then fmod(360) ensures the result is always in [0°, 360°) with no negative values
-        // ex: a target at (1, 0) due east -> bearing 90°,  target at (0, -1) due south -> bearing 180°
-        float bearing = std::fmod(std::atan2(target.xKilometers, target.yKilometers) * RAD2DEG + 360.f, 360.f);
-
-        if (!bearingInArc(bearing, sonarState.previousSweepDegrees, sonarState.sweepAngleDegrees))
-            continue;
-        if (sonarState.elapsedSeconds - target.lastDetectionTime < minimumInterval)
-            continue; // too soon since the last ping on this target
-        target.lastDetectionTime = sonarState.elapsedSeconds;
-
-        Color color = targetColors[target.colorId];
-
-        if (sonarState.activeMode) {
-            float signalStrength = activeSignalStrength(rangeKilometers, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
-            if (signalStrength <= 0.f)
-                continue; // echo too weak to register on the display
-            Vector2 direction = bearingToDirection(bearing);
-            // scale range in km to screen pixels: 100 km maps to the full disc radius in pixels
-            float rangePixels = (rangeKilometers / maximumRangeKilometers) * radius;
-            sonarState.blips.push_back({ center.x + direction.x * rangePixels, center.y + direction.y * rangePixels, 1.0f, color });
-        } else {
-            float signalStrength = passiveSignalStrength(rangeKilometers, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
-            if (signalStrength <= 0.f)
-                continue;
-            // map bearing (0-360) to one of 720 bins by simple proportion, ex: bearing 180 deg -> bin 360
-            int binId = (int)(bearing / 360.f * passiveBinCount) % passiveBinCount;
-            sonarState.passiveBins[binId].alpha = 1.0f;
-            sonarState.passiveBins[binId].color = color;
-        }
-    }
-}
-
-// advances the sweep arm angle, fades out old blips and passive bins, then moves targets and checks for new detections,
-// fade rate is proportional to sweep speed: faster sweep -> contacts fade faster, keeping the display
-// consistent regardless of rotation speed (a full revolution always clears the previous contacts),
-// the erase-remove_if pattern is the standard C++ idiom for deleting items from a vector in one pass
-// mark the ones to remove (alpha < 0.01), shift everything else forward, then truncate the tail
-static void updateSonar(SonarState& sonarState, float deltaTime, Vector2 center, float radius)
-{
-    sonarState.elapsedSeconds += deltaTime;
-    sonarState.previousSweepDegrees = sonarState.sweepAngleDegrees;
-    sonarState.sweepAngleDegrees = std::fmod(sonarState.sweepAngleDegrees + sonarState.sweepSpeedDegreesPerSecond * deltaTime, 360.f);
-
-    // at 90 dps: fadeRate = 0.25/s -> a blip at alpha 1.0 fully disappears after 4 seconds (one revolution),
-    // so the natural "sweep lifetime" of a contact exactly matches one full rotation
-    float fadeRate = sonarState.sweepSpeedDegreesPerSecond / 360.f;
-
-    for (auto& blip : sonarState.blips)
-        blip.alpha = std::max(0.f, blip.alpha - fadeRate * deltaTime);
-    sonarState.blips.erase(
-        std::remove_if(sonarState.blips.begin(), sonarState.blips.end(), [](const Blip& blip) { return blip.alpha < 0.01f; }), sonarState.blips.end());
-
-    for (auto& passiveBin : sonarState.passiveBins)
-        passiveBin.alpha = std::max(0.f, passiveBin.alpha - fadeRate * deltaTime);
-
-    updateTargets(sonarState, deltaTime);
-    updateDetections(sonarState, center, radius);
-}
-
-#pragma region draw utils
-
 // horizontal clickable slider: a label above it, a dark bar with a colored fill proportional to value,
 // and the current numeric value to the right, if the user clicks or drags inside the bar, we read the mouse x position,
 // map it linearly into [valueMin, valueMax] and return the new value, otherwise we return the unchanged value,
@@ -241,38 +75,214 @@ static void drawReadout(float x, float y, float width, const char* label, const
     DrawText(value, (int)(readoutRect.x + readoutRect.width - textWidth - 6), (int)(readoutRect.y + 1), 12, { 0, 220, 0, 220 });
 }
 
+#pragma region batch
+// points the instance attributes at the instance buffer currently bound, one step per instance (divisor 1) instead of per vertex
+static void bindInstanceAttributes(const SonarDisplay& sonarDisplay)
+{
+    int segmentLocation = GetShaderLocationAttrib(sonarDisplay.ppiShader, "instanceSegment");
+    int radiusLocation = GetShaderLocationAttrib(sonarDisplay.ppiShader, "instanceRadius");
+    int colorLocation = GetShaderLocationAttrib(sonarDisplay.ppiShader, "instanceColor");
+    rlSetVertexAttribute(segmentLocation, 4, RL_FLOAT, false, sizeof(PpiInstance), offsetof(PpiInstance, ax));
+    rlSetVertexAttribute(radiusLocation, 1, RL_FLOAT, false, sizeof(PpiInstance), offsetof(PpiInstance, radius));
+    rlSetVertexAttribute(colorLocation, 4, RL_UNSIGNED_BYTE, true, sizeof(PpiInstance), offsetof(PpiInstance, color)); // 0-255 -> 0-1
+    for (int location : { segmentLocation, radiusLocation, colorLocation }) {
+        rlEnableVertexAttribute(location);
+        rlSetVertexAttributeDivisor(location, 1);
+    }
+}
+
+// each PPI element is drawn as one instance of a single quad, the vertex shader stretches the quad around the capsule
+// (along the segment by half its length + radius, across it by the radius, +1 px for antialiasing) and places it on screen,
+// cornerPosition is -1 to 1 on both axes, screen pixels go to NDC by hand since this bypasses raylib's matrices
+static const char* ppiVertexShader = R"GLSL(
+#version 330
+in vec2 cornerPosition;
+in vec4 instanceSegment;
+in float instanceRadius;
+in vec4 instanceColor;
+uniform vec2 screenSize;
+out vec2 localPosition; // pixel offset from the capsule center, x along the segment
+out float halfLength;
+out float radius;
+out vec4 color;
+void main() {
+    vec2 delta = instanceSegment.zw - instanceSegment.xy;
+    float segmentLength = length(delta);
+    vec2 axis = segmentLength > 1e-4 ? delta / segmentLength : vec2(1.0, 0.0);
+    vec2 normal = vec2(-axis.y, axis.x);
+    halfLength = 0.5 * segmentLength;
+    radius = instanceRadius;
+    localPosition = cornerPosition * vec2(halfLength + radius + 1.0, radius + 1.0);
+    vec2 pixel = 0.5 * (instanceSegment.xy + instanceSegment.zw) + axis * localPosition.x + normal * localPosition.y;
+    gl_Position = vec4(pixel.x / screenSize.x * 2.0 - 1.0, 1.0 - pixel.y / screenSize.y * 2.0, 0.0, 1.0);
+    color = instanceColor;
+}
+)GLSL";
+
+// signed distance to the capsule: distance to the segment minus the radius, negative inside,
+// coverage ramps over one pixel across the edge so circles and lines come out antialiased without any tessellation
+static const char* ppiFragmentShader = R"GLSL(
+#version 330
+in vec2 localPosition;
+in float halfLength;
+in float radius;
+in vec4 color;
+out vec4 outColor;
+void main() {
+    float distance = length(vec2(max(abs(localPosition.x) - halfLength, 0.0), localPosition.y)) - radius;
+    float coverage = clamp(0.5 - distance, 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+    outColor = vec4(color.rgb, color.a * coverage);
+}
+)GLSL";
+
+// builds the shader and the vertex array once: a static 6-vertex quad (two triangles) shared by every instance,
+// plus a dynamic instance buffer that grows (doubling) whenever a frame has more instances than it holds
+static void loadInstanceBatch(SonarDisplay& sonarDisplay)
+{
+    sonarDisplay.ppiShader = LoadShaderFromMemory(ppiVertexShader, ppiFragmentShader);
+    static const float corners[] = { -1, -1, 1, -1, 1, 1, -1, -1, 1, 1, -1, 1 };
+    sonarDisplay.instanceArray = rlLoadVertexArray();
+    rlEnableVertexArray(sonarDisplay.instanceArray);
+    sonarDisplay.cornerBuffer = rlLoadVertexBuffer(corners, sizeof(corners), false);
+    int cornerLocation = GetShaderLocationAttrib(sonarDisplay.ppiShader, "cornerPosition");
+    rlSetVertexAttribute(cornerLocation, 2, RL_FLOAT, false, 0, 0);
+    rlEnableVertexAttribute(cornerLocation);
+    sonarDisplay.instanceCapacity = 4096;
+    sonarDisplay.instanceBuffer = rlLoadVertexBuffer(nullptr, sonarDisplay.instanceCapacity * sizeof(PpiInstance), true);
+    bindInstanceAttributes(sonarDisplay);
+    rlDisableVertexArray();
+}
+
+static void unloadInstanceBatch(SonarDisplay& sonarDisplay)
+{
+    rlUnloadVertexBuffer(sonarDisplay.instanceBuffer);
+    rlUnloadVertexBuffer(sonarDisplay.cornerBuffer);
+    rlUnloadVertexArray(sonarDisplay.instanceArray);
+    UnloadShader(sonarDisplay.ppiShader);
+}
+
+// uploads this frame's instances and draws them all in one instanced call,
+// whatever raylib batched so far (the disc background) is flushed first so it stays underneath
+static void drawInstances(SonarDisplay& sonarDisplay)
+{
+    int instanceCount = (int)sonarDisplay.instances.size();
+    if (instanceCount == 0)
+        return;
+    rlDrawRenderBatchActive();
+    rlEnableVertexArray(sonarDisplay.instanceArray);
+    if (instanceCount > sonarDisplay.instanceCapacity) {
+        while (sonarDisplay.instanceCapacity < instanceCount)
+            sonarDisplay.instanceCapacity *= 2;
+        rlUnloadVertexBuffer(sonarDisplay.instanceBuffer);
+        sonarDisplay.instanceBuffer = rlLoadVertexBuffer(nullptr, sonarDisplay.instanceCapacity * sizeof(PpiInstance), true);
+        bindInstanceAttributes(sonarDisplay);
+    }
+    rlUpdateVertexBuffer(sonarDisplay.instanceBuffer, sonarDisplay.instances.data(), instanceCount * sizeof(PpiInstance), 0);
+    float screenSize[2] = { (float)GetScreenWidth(), (float)GetScreenHeight() };
+    SetShaderValue(sonarDisplay.ppiShader, GetShaderLocation(sonarDisplay.ppiShader, "screenSize"), screenSize, SHADER_UNIFORM_VEC2);
+    rlEnableShader(sonarDisplay.ppiShader.id);
+    rlDrawVertexArrayInstanced(0, 6, instanceCount);
+    rlDisableShader();
+    rlDisableVertexArray();
+}
+
 #pragma region draws
 // PPI = Plan Position Indicator, the classic round green sonar scope, ship is always at the exact center,
-// the sweep arm rotates clockwise, whatever the arm "illuminates" on each pass gets painted on screen and then slowly fades
-// this function draws in order: the dark green disc background, the fading contacts (blips or passive lines),
+// the sweep arm rotates clockwise, whatever the arm "illuminates" on each pass gets painted on screen and then slowly fades,
+// everything is stored in the world frame (true bearings, world km) and placed through the frame's transform (see DisplayFrame),
+// so switching north-up/head-up or our ship moving on never touches the history, only where it's drawn
+// this function draws in order: the dark green disc background, the fading contacts (passive lines, remote bearings and blips),
+// tracks, passive fixes and remote sensors,
 // the concentric range rings (25/50/75/100 km), the cardinal direction labels (N/S/E/W),
 // the faint crosshair, the bright green sweep arm, and then updates the mouse cursor readout for the UI panel
-static void drawPPI(SonarState& sonarState, Vector2 center, float radius)
+static void drawPPI(const SonarSnapshot& snapshot, SonarDisplay& sonarDisplay, Vector2 center, float radius)
 {
+    const DisplayFrame frame = makeDisplayFrame(snapshot, sonarDisplay.headUp, center, radius);
     DrawCircleV(center, radius, { 0, 15, 0, 255 }); // dark green phosphor CRT screen effect
 
-    // passive mode: draw a radial line from center to the disc edge for each lit bin,
+    // passive bins and blips are not drawn one by one, each becomes one capsule instance and they all go out in a single draw call
+    // (see drawInstances), so the cost is filling a vector, whether there are 10 or 100k of them
+    sonarDisplay.instances.clear();
+
+    // passive mode: a radial line from center to the disc edge for each lit bin (a capsule 1 px thick),
     // the line goes all the way to the edge because passive sonar has no range information
-    if (!sonarState.activeMode) {
+    if (!snapshot.activeMode) {
         for (int binId = 0; binId < passiveBinCount; ++binId) {
-            if (sonarState.passiveBins[binId].alpha < 0.01f)
+            if (snapshot.passiveBins[binId].alpha < 0.01f)
                 continue;
             float bearing = binId * 360.f / passiveBinCount;
-            Vector2 direction = bearingToDirection(bearing);
-            Vector2 endpoint = { center.x + direction.x * radius, center.y + direction.y * radius };
-            Color color = sonarState.passiveBins[binId].color;
-            color.a = (unsigned char)(sonarState.passiveBins[binId].alpha * 235);
-            DrawLineV(center, endpoint, color);
+            Vector2 direction = bearingToScreen(frame, bearing);
+            Color color = snapshot.passiveBins[binId].color;
+            color.a = (unsigned char)(snapshot.passiveBins[binId].alpha * 235);
+            sonarDisplay.instances.push_back({ center.x, center.y, center.x + direction.x * radius, center.y + direction.y * radius, 0.5f, color });
         }
     }
 
-    // active mode: draw each echo as a small circle whose radius shrinks as it fades,
-    if (sonarState.activeMode) {
-        for (const auto& blip : sonarState.blips) {
-            Color color = blip.color;
-            color.a = (unsigned char)(blip.alpha * 240);
-            // size: starts at 6px (4.5+1.5) when fresh, shrinks to 1.5px when nearly invisible
-            DrawCircleV({ blip.xPixels, blip.yPixels }, 4.5f * blip.alpha + 1.5f, color);
+    // remote passive sensors: a faint line along each bearing they hear, from the sensor to where the line leaves the disc,
+    // the exit distance solves |sensor + t·direction| = 100 km for t with the sensor taken relative to our ship (a rotation doesn't change it),
+    // a sensor our ship left outside the disc enters it at the smaller root, one whose line misses the disc draws nothing
+    for (const BearingLine& line : snapshot.bearings) {
+        if (line.sensorId == 0)
+            continue; // ours are the bins above
+        float directionX = std::sin(line.bearingDegrees * DEG2RAD), directionY = std::cos(line.bearingDegrees * DEG2RAD);
+        float eastKilometers = line.sensorXKilometers - frame.originXKilometers, northKilometers = line.sensorYKilometers - frame.originYKilometers;
+        float along = eastKilometers * directionX + northKilometers * directionY;
+        float discriminant = along * along - (eastKilometers * eastKilometers + northKilometers * northKilometers) + maximumRangeKilometers * maximumRangeKilometers;
+        if (discriminant <= 0.f)
+            continue;
+        float entryKilometers = std::max(0.f, -along - std::sqrt(discriminant));
+        float exitKilometers = std::min(-along + std::sqrt(discriminant), maximumRangeKilometers);
+        if (exitKilometers <= entryKilometers)
+            continue;
+        Vector2 start = worldToScreen(frame, line.sensorXKilometers + directionX * entryKilometers, line.sensorYKilometers + directionY * entryKilometers);
+        Vector2 end = worldToScreen(frame, line.sensorXKilometers + directionX * exitKilometers, line.sensorYKilometers + directionY * exitKilometers);
+        sonarDisplay.instances.push_back({ start.x, start.y, end.x, end.y, 0.5f, { 150, 190, 255, 60 } });
+    }
+
+    // echoes (ours in active mode, and the active remote sensors' in any mode): each is a small circle (a capsule with both ends together)
+    // whose radius shrinks as it fades, blips live in world km so each goes through the frame's transform, 100 km from our ship
+    // maps to the full disc radius in pixels, our ship sailing on leaves old blips where the contact was, off the disc ones are skipped
+    for (const auto& blip : snapshot.blips) {
+        Color color = blip.color;
+        color.a = (unsigned char)(blip.alpha * 240);
+        // size: starts at 6px (4.5+1.5) when fresh, shrinks to 1.5px when nearly invisible
+        Vector2 position = worldToScreen(frame, blip.xKilometers, blip.yKilometers);
+        if (std::hypot(position.x - center.x, position.y - center.y) > radius)
+            continue;
+        sonarDisplay.instances.push_back({ position.x, position.y, position.x, position.y, 4.5f * blip.alpha + 1.5f, color });
+    }
+    drawInstances(sonarDisplay);
+
+    // confirmed tracks: a small square on the estimated position with a leader line showing where it'll be in leaderSeconds,
+    // tentative ones are not drawn, they're mostly a blip or two waiting to prove they're not noise
+    constexpr float leaderSeconds = 4.f;
+    for (const TrackMark& track : snapshot.tracks) {
+        if (!track.confirmed)
+            continue;
+        Vector2 position = worldToScreen(frame, track.xKilometers, track.yKilometers);
+        Vector2 leaderTip = worldToScreen(frame, track.xKilometers + track.velocityX * leaderSeconds, track.yKilometers + track.velocityY * leaderSeconds);
+        DrawRectangleLines((int)position.x - 4, (int)position.y - 4, 9, 9, { 255, 255, 255, 200 });
+        DrawLineV(position, leaderTip, { 255, 255, 255, 160 });
+    }
+
+    // passive fixes: a yellow X where the bearings of several sensors cross
+    for (const Fix& fix : snapshot.fixes) {
+        Vector2 position = worldToScreen(frame, fix.xKilometers, fix.yKilometers);
+        DrawLineV({ position.x - 4, position.y - 4 }, { position.x + 4, position.y + 4 }, { 255, 230, 90, 230 });
+        DrawLineV({ position.x - 4, position.y + 4 }, { position.x + 4, position.y - 4 }, { 255, 230, 90, 230 });
+    }
+
+    // remote sensors: a small triangle, active ones with a short stub of their own sweep arm
+    for (const SensorMark& sensor : snapshot.sensors) {
+        Vector2 position = worldToScreen(frame, sensor.xKilometers, sensor.yKilometers);
+        if (std::hypot(position.x - center.x, position.y - center.y) > radius)
+            continue;
+        DrawTriangle({ position.x, position.y - 6 }, { position.x - 5, position.y + 4 }, { position.x + 5, position.y + 4 }, { 150, 190, 255, 230 });
+        if (sensor.activeMode) {
+            Vector2 direction = bearingToScreen(frame, sensor.sweepAngleDegrees);
+            DrawLineV(position, { position.x + direction.x * 14.f, position.y + direction.y * 14.f }, { 0, 255, 80, 210 });
         }
     }
 
@@ -287,35 +297,48 @@ static void drawPPI(SonarState& sonarState, Vector2 center, float radius)
         DrawText(label, (int)(center.x + rangePixels) - textWidth - 5, (int)center.y - 15, 11, { 0, 130, 0, 200 });
     }
 
-    // cardinal compass labels just outside the disc edge (N/S/E/W),
-    // cardinalMargin pushes them beyond the radius so they sit clearly outside the green circle
+    // cardinal compass labels just outside the disc edge (N/S/E/W), they go round the disc with the display's rotation in head-up,
+    // cardinalMargin pushes them beyond the radius so they sit clearly outside the green circle, each centered on its own spot
     float cardinalMargin = 16.f;
-    DrawText("N", center.x - 6, center.y - radius - cardinalMargin, 13, { 0, 200, 0, 255 });
-    DrawText("S", center.x - 5, center.y + radius + cardinalMargin - 13, 13, { 0, 200, 0, 255 });
-    DrawText("E", center.x + radius + cardinalMargin, center.y - 6, 13, { 0, 200, 0, 255 });
-    DrawText("W", center.x - radius - cardinalMargin - 12, center.y - 6, 13, { 0, 200, 0, 255 });
+    const char* cardinals[] = { "N", "E", "S", "W" };
+    for (int cardinalId = 0; cardinalId < 4; ++cardinalId) {
+        Vector2 direction = bearingToScreen(frame, cardinalId * 90.f);
+        Vector2 position = { center.x + direction.x * (radius + cardinalMargin), center.y + direction.y * (radius + cardinalMargin) };
+        DrawText(cardinals[cardinalId], (int)(position.x - MeasureText(cardinals[cardinalId], 13) / 2.f), (int)(position.y - 6.f), 13, { 0, 200, 0, 255 });
+    }
+
+    // faint crosshair lines through center for orientation (north-south and east-west axes, turned with the display)
+    for (float bearing : { 0.f, 90.f }) {
+        Vector2 direction = bearingToScreen(frame, bearing);
+        DrawLineV({ center.x - direction.x * radius, center.y - direction.y * radius }, { center.x + direction.x * radius, center.y + direction.y * radius },
+            { 0, 50, 0, 100 });
+    }
 
-    // faint crosshair lines through center for orientation (north-south and east-west axes)
-    DrawLine(center.x, center.y - radius, center.x, center.y + radius, { 0, 50, 0, 100 });
-    DrawLine(center.x - radius, center.y, center.x + radius, center.y, { 0, 50, 0, 100 });
+    // our ship's heading line, a short white stub from the center along the bow (straight up in head-up)
+    Vector2 bowDirection = bearingToScreen(frame, snapshot.ownship.headingDegrees);
+    DrawLineV(center, { center.x + bowDirection.x * 24.f, center.y + bowDirection.y * 24.f }, { 255, 255, 255, 200 });
 
-    // the rotating sweep arm: a bright green line from center out to the disc edge at the current angle
-    Vector2 sweepDirection = bearingToDirection(sonarState.sweepAngleDegrees);
-    Vector2 sweepTip = { center.x + sweepDirection.x * radius, center.y + sweepDirection.y * radius };
-    DrawLineV(center, sweepTip, { 0, 255, 80, 210 });
+    // the rotating sweep arm: a bright green line from center out to the disc edge at the current angle,
+    // fixed multi-beam pings see all around at once so there's no arm to draw
+    if (!snapshot.activeMode || snapshot.multiBeamCount == 0) {
+        Vector2 sweepDirection = bearingToScreen(frame, snapshot.sweepAngleDegrees);
+        Vector2 sweepTip = { center.x + sweepDirection.x * radius, center.y + sweepDirection.y * radius };
+        DrawLineV(center, sweepTip, { 0, 255, 80, 210 });
+    }
 
     // convert the cursor's screen pixel offset from center into bearing and range,
     // atan2(dx, -dy) gives clockwise-from-north angle in screen space (dy is negated because screen y is flipped
-    // positive y goes down, but north is up), result wrapped to [0, 360) with fmod+offset,
+    // positive y goes down, but screen-up is north or our bow), the display's rotation is added back so it reads as a true bearing,
+    // result wrapped to [0, 360) with fmod+offset,
     // this is updated here so the UI panel can read the values without extra passing
     Vector2 mousePosition = GetMousePosition();
     float mouseDeltaX = mousePosition.x - center.x;
     float mouseDeltaY = mousePosition.y - center.y;
     float mouseDistancePixels = std::hypot(mouseDeltaX, mouseDeltaY);
-    sonarState.mouseOnPPI = mouseDistancePixels <= radius;
-    if (sonarState.mouseOnPPI) {
-        sonarState.mouseRange = (mouseDistancePixels / radius) * maximumRangeKilometers;
-        sonarState.mouseBearing = std::fmod(std::atan2(mouseDeltaX, -mouseDeltaY) * RAD2DEG + 360.f, 360.f);
+    sonarDisplay.mouseOnPPI = mouseDistancePixels <= radius;
+    if (sonarDisplay.mouseOnPPI) {
+        sonarDisplay.mouseRange = (mouseDistancePixels / radius) * maximumRangeKilometers;
+        sonarDisplay.mouseBearing = std::fmod(std::atan2(mouseDeltaX, -mouseDeltaY) * RAD2DEG + frame.rotationDegrees + 360.f, 360.f);
     }
 }
 
@@ -324,8 +347,9 @@ static void drawPPI(SonarState& sonarState, Vector2 center, float radius)
 // the curve is built from 100 short connected line segments computed by sampling soundSpeedMetersPerSecond,
 // the orange horizontal line shows the thermocline, the kink in the curve appears right at that depth,
 // helps the operator understand why distant contacts are harder to detect
-// the dip in the curve at the thermocline is exactly where sound bends away and creates the shadow zone
-static void drawSoundSpeedProfile(const SonarState& sonarState, float x, float y, float width, float height)
+// the dip in the curve at the thermocline is exactly where sound bends away and creates the shadow zone,
+// with a gridded environment loaded it's the column under our ship instead and the sliders' thermocline line goes away
+static void drawSoundSpeedProfile(const SonarSnapshot& snapshot, float x, float y, float width, float height)
 {
     DrawText("SOUND SPEED PROFILE", (int)x, (int)(y - 15), 12, ColorAlpha(WHITE, 0.7f));
     DrawRectangle((int)x, (int)y, (int)width, (int)height, ColorAlpha(BLACK, 0.5f));
@@ -351,8 +375,12 @@ static void drawSoundSpeedProfile(const SonarState& sonarState, float x, float y
     for (int segmentId = 1; segmentId <= segmentCount; ++segmentId) {
         float depthStart = (segmentId - 1) / (float)segmentCount;
         float depthEnd = segmentId / (float)segmentCount;
-        float speedStart = soundSpeedMetersPerSecond(depthStart, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
-        float speedEnd = soundSpeedMetersPerSecond(depthEnd, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
+        float speedStart = snapshot.environment
+            ? environmentSpeedMetersPerSecond(*snapshot.environment, snapshot.ownship.xKilometers, snapshot.ownship.yKilometers, depthStart)
+                                                : soundSpeedMetersPerSecond(depthStart, snapshot.thermoclineNormalized, snapshot.deepSpeedBoost);
+        float speedEnd = snapshot.environment
+            ? environmentSpeedMetersPerSecond(*snapshot.environment, snapshot.ownship.xKilometers, snapshot.ownship.yKilometers, depthEnd)
+            : soundSpeedMetersPerSecond(depthEnd, snapshot.thermoclineNormalized, snapshot.deepSpeedBoost);
         // (speed - axisMin) / axisRange maps m/s value to a 0 to 1 position, then scale to pixel width
         float pixelXStart = leftEdge + (speedStart - minimumSpeedAxis) / speedAxisRange * (rightEdge - leftEdge);
         float pixelYStart = topEdge + depthStart * (bottomEdge - topEdge);
@@ -362,12 +390,87 @@ static void drawSoundSpeedProfile(const SonarState& sonarState, float x, float y
     }
 
     // orange line marking the thermocline depth, the curve kinks visibly right here
-    float thermoclineY = topEdge + sonarState.thermoclineNormalized * (bottomEdge - topEdge);
+    if (snapshot.environment)
+        return;
+    float thermoclineY = topEdge + snapshot.thermoclineNormalized * (bottomEdge - topEdge);
     DrawLine((int)(x + 2), (int)thermoclineY, (int)(x + width - 2), (int)thermoclineY, ColorAlpha(ORANGE, 0.65f));
     DrawText("thermo", (int)(x + 4), (int)(thermoclineY - 10), 9, ColorAlpha(ORANGE, 0.85f));
 }
 
-static void drawUI(SonarState& sonarState, int panelWidth, int screenHeight)
+// heatmap of the ray-traced transmission loss, horizontal axis = range (0 to 100 km), vertical axis = depth (same as the profile above it),
+// bright yellow = loud (little loss), dark blue = quiet, black = shadow zone no ray reaches, the texture is only re-uploaded when
+// the sliders land on another cached field, colored dots = every target at its range and depth,
+// in a gridded environment it's the field of the sector the sweep arm is in, so it changes as the arm goes round
+static void drawTransmissionLoss(const SonarSnapshot& snapshot, SonarDisplay& sonarDisplay, float x, float y, float width, float height)
+{
+    DrawText(snapshot.environment ? "TRANSMISSION LOSS (SWEEP SECTOR)" : "TRANSMISSION LOSS", (int)x, (int)(y - 15), 12, ColorAlpha(WHITE, 0.7f));
+    const TransmissionLossField& field = *snapshot.transmissionLoss;
+    if (sonarDisplay.uploadedFieldKey != field.key) {
+        static Color pixels[TransmissionLossField::rangeBinCount * TransmissionLossField::depthBinCount];
+        for (size_t cellId = 0; cellId < field.lossDecibels.size(); ++cellId) {
+            // 0 dB (or less, closer than 1 km) -> 1.0, 60 dB and beyond -> 0.0, same span as the 62 dB passive budget
+            float loudness = std::clamp(1.f - field.lossDecibels[cellId] / 60.f, 0.f, 1.f);
+            pixels[cellId] = field.lossDecibels[cellId] >= TransmissionLossField::maximumLossDecibels
+                ? BLACK
+                : Color { (unsigned char)(255 * loudness), (unsigned char)(220 * loudness * loudness), (unsigned char)(140 * (1.f - loudness) + 40), 255 };
+        }
+        UpdateTexture(sonarDisplay.transmissionLossTexture, pixels);
+        sonarDisplay.uploadedFieldKey = field.key;
+    }
+    Texture2D& texture = sonarDisplay.transmissionLossTexture;
+    DrawTexturePro(texture, { 0, 0, (float)texture.width, (float)texture.height }, { x, y, width, height }, { 0, 0 }, 0.f, WHITE);
+    DrawRectangleLinesEx({ x, y, width, height }, 1, ColorAlpha(SKYBLUE, 0.35f));
+
+    if (!snapshot.environment) {
+        float thermoclineY = y + snapshot.thermoclineNormalized * height;
+        DrawLine((int)x, (int)thermoclineY, (int)(x + width), (int)thermoclineY, ColorAlpha(ORANGE, 0.65f));
+    }
+    // every target at its range and depth, a dot in the black is a target the shadow zone hides from us
+    for (const Target& target : snapshot.targets) {
+        float rangeKilometers = std::hypot(target.xKilometers - snapshot.ownship.xKilometers, target.yKilometers - snapshot.ownship.yKilometers);
+        if (rangeKilometers <= maximumRangeKilometers)
+            DrawRectangle((int)(x + rangeKilometers / maximumRangeKilometers * width) - 1, (int)(y + target.depthNormalized * height) - 1, 3, 3,
+                targetColors[target.colorId]);
+    }
+    DrawText("0", (int)(x + 2), (int)(y + height + 2), 9, ColorAlpha(WHITE, 0.35f));
+    DrawText("100km", (int)(x + width - 28), (int)(y + height + 2), 9, ColorAlpha(WHITE, 0.35f));
+}
+
+// bearing-time waterfall: one row per sweep revolution, newest at the top, bearing 0 to 360 left to right,
+// the texture is a ring buffer, a finished revolution overwrites only its own row (one 720 px sub-rectangle upload, ~3 KB),
+// past rows never get touched again, drawing scrolls by offsetting the source rectangle instead of moving any pixel:
+// it starts rowCount - historyRows rows "before" the texture and the repeat wrap mode folds that back onto the ring,
+// the negative source height flips it so the newest row lands on top
+static void drawWaterfall(const SonarSnapshot& snapshot, SonarDisplay& sonarDisplay, float x, float y, float width, float height)
+{
+    Texture2D& texture = sonarDisplay.waterfallTexture;
+    if (snapshot.waterfallRowCount > sonarDisplay.uploadedWaterfallRows) {
+        int row = (int)((snapshot.waterfallRowCount - 1) % waterfallHistoryRows);
+        rlUpdateTexture(texture.id, 0, row, passiveBinCount, 1, texture.format, snapshot.waterfallRow.data());
+        sonarDisplay.uploadedWaterfallRows = snapshot.waterfallRowCount;
+    }
+
+    DrawText("BEARING-TIME", (int)x, (int)(y - 15), 12, ColorAlpha(WHITE, 0.7f));
+    Rectangle source = { 0.f, (float)(sonarDisplay.uploadedWaterfallRows - waterfallHistoryRows), (float)passiveBinCount, -(float)waterfallHistoryRows };
+    DrawTexturePro(texture, source, { x, y, width, height }, { 0, 0 }, 0.f, WHITE);
+    DrawRectangleLinesEx({ x, y, width, height }, 1, ColorAlpha(SKYBLUE, 0.35f));
+
+    // bearing ticks every 90° under the panel, and how many revolutions it spans top to bottom
+    for (int bearing = 0; bearing <= 360; bearing += 90) {
+        float tickX = x + bearing / 360.f * width;
+        DrawLine((int)tickX, (int)(y + height), (int)tickX, (int)(y + height + 4), ColorAlpha(WHITE, 0.35f));
+        char label[8];
+        std::snprintf(label, sizeof(label), "%d", bearing);
+        DrawText(label, (int)tickX - MeasureText(label, 9) / 2, (int)(y + height + 6), 9, ColorAlpha(WHITE, 0.35f));
+    }
+    char span[32];
+    std::snprintf(span, sizeof(span), "%d revolutions", waterfallHistoryRows);
+    DrawText(span, (int)(x + width - MeasureText(span, 9)), (int)(y - 13), 9, ColorAlpha(WHITE, 0.35f));
+}
+
+// the panel writes straight into the shared controls, the simulation picks them up on its next tick,
+// everything that reflects the simulation itself (profile, heatmap) is drawn from the snapshot
+static void drawUI(const SonarSnapshot& snapshot, SonarControls& controls, SonarDisplay& sonarDisplay, int panelWidth, int screenHeight)
 {
     DrawRectangle(0, 0, panelWidth, screenHeight, ColorAlpha(BLACK, 0.65f)); // translucent dark panel background
 
@@ -380,8 +483,8 @@ static void drawUI(SonarState& sonarState, int panelWidth, int screenHeight)
     // bearing readout
     {
         char valueText[16];
-        if (sonarState.mouseOnPPI)
-            std::snprintf(valueText, sizeof(valueText), "%06.2f deg", sonarState.mouseBearing);
+        if (sonarDisplay.mouseOnPPI)
+            std::snprintf(valueText, sizeof(valueText), "%06.2f deg", sonarDisplay.mouseBearing);
         else
             std::strcpy(valueText, "---.-- deg");
         drawReadout(x, y, sliderWidth, "BEARING", valueText);
@@ -391,8 +494,8 @@ static void drawUI(SonarState& sonarState, int panelWidth, int screenHeight)
     // range readout
     {
         char valueText[16];
-        if (sonarState.mouseOnPPI)
-            std::snprintf(valueText, sizeof(valueText), "%06.2f km", sonarState.mouseRange);
+        if (sonarDisplay.mouseOnPPI)
+            std::snprintf(valueText, sizeof(valueText), "%06.2f km", sonarDisplay.mouseRange);
         else
             std::strcpy(valueText, "---.-- km");
         drawReadout(x, y, sliderWidth, "RANGE", valueText);
@@ -402,33 +505,84 @@ static void drawUI(SonarState& sonarState, int panelWidth, int screenHeight)
     // mode toggle button
     y += 4.f;
     Rectangle modeToggle = { x, y, sliderWidth + 20.f, 28.f };
-    DrawRectangleRec(modeToggle, sonarState.activeMode ? Color { 25, 100, 25, 255 } : Color { 40, 40, 90, 255 });
+    bool activeMode = controls.activeMode.load();
+    DrawRectangleRec(modeToggle, activeMode ? Color { 25, 100, 25, 255 } : Color { 40, 40, 90, 255 });
     DrawRectangleLinesEx(modeToggle, 1, ColorAlpha(WHITE, 0.25f));
-    DrawText(sonarState.activeMode ? "MODE: ACTIVE" : "MODE: PASSIVE", (int)(modeToggle.x + 10), (int)(modeToggle.y + 8), 13, WHITE);
+    DrawText(activeMode ? "MODE: ACTIVE" : "MODE: PASSIVE", (int)(modeToggle.x + 10), (int)(modeToggle.y + 8), 13, WHITE);
     if (CheckCollisionPointRec(GetMousePosition(), modeToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
-        sonarState.activeMode = !sonarState.activeMode;
-    y += 28.f + rowHeight - 14.f;
+        controls.activeMode = !activeMode;
+    y += 28.f + 6.f;
+
+    // hydrophone array layout used by passive mode, the linear one shows every contact mirrored across the line (east-west when heading north)
+    Rectangle arrayToggle = { x, y, sliderWidth + 20.f, 20.f };
+    bool linearArray = controls.arrayGeometry.load() == ArrayGeometry::Linear;
+    DrawRectangleRec(arrayToggle, { 40, 40, 90, 255 });
+    DrawRectangleLinesEx(arrayToggle, 1, ColorAlpha(WHITE, 0.25f));
+    DrawText(linearArray ? "ARRAY: LINEAR" : "ARRAY: CIRCULAR", (int)(arrayToggle.x + 10), (int)(arrayToggle.y + 5), 11, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), arrayToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        controls.arrayGeometry = linearArray ? ArrayGeometry::Circular : ArrayGeometry::Linear;
+    y += 20.f + 6.f;
+
+    // active beams, each click cycles rotating sweep -> 64 -> 128 -> 256 fixed beams -> rotating sweep
+    Rectangle beamToggle = { x, y, sliderWidth + 20.f, 20.f };
+    int multiBeamCount = controls.multiBeamCount.load();
+    DrawRectangleRec(beamToggle, { 25, 100, 25, 255 });
+    DrawRectangleLinesEx(beamToggle, 1, ColorAlpha(WHITE, 0.25f));
+    char beamText[32];
+    if (multiBeamCount > 0)
+        std::snprintf(beamText, sizeof(beamText), "BEAMS: %d FIXED", multiBeamCount);
+    else
+        std::strcpy(beamText, "BEAMS: SWEEP");
+    DrawText(beamText, (int)(beamToggle.x + 10), (int)(beamToggle.y + 5), 11, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), beamToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        controls.multiBeamCount = multiBeamCount == 0 ? 64 : multiBeamCount >= 256 ? 0 : multiBeamCount * 2;
+    y += 20.f + 6.f;
+
+    // seabed and biologic scatterers echoing active pings, grey contacts the tracker has to live with
+    Rectangle clutterToggle = { x, y, sliderWidth + 20.f, 20.f };
+    bool clutterEnabled = controls.clutterEnabled.load();
+    DrawRectangleRec(clutterToggle, clutterEnabled ? Color { 25, 100, 25, 255 } : Color { 40, 40, 40, 255 });
+    DrawRectangleLinesEx(clutterToggle, 1, ColorAlpha(WHITE, 0.25f));
+    DrawText(clutterEnabled ? "CLUTTER: ON" : "CLUTTER: OFF", (int)(clutterToggle.x + 10), (int)(clutterToggle.y + 5), 11, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), clutterToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        controls.clutterEnabled = !clutterEnabled;
+    y += 20.f + 6.f;
+
+    // display orientation, north-up or head-up (ship-stabilized), only the drawing changes so it's the display's, not the simulation's
+    Rectangle orientationToggle = { x, y, sliderWidth + 20.f, 20.f };
+    DrawRectangleRec(orientationToggle, { 40, 40, 90, 255 });
+    DrawRectangleLinesEx(orientationToggle, 1, ColorAlpha(WHITE, 0.25f));
+    DrawText(sonarDisplay.headUp ? "DISPLAY: HEAD UP" : "DISPLAY: NORTH UP", (int)(orientationToggle.x + 10), (int)(orientationToggle.y + 5), 11, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), orientationToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        sonarDisplay.headUp = !sonarDisplay.headUp;
+    y += 20.f + rowHeight - 14.f;
+
+    // our ship's ordered course and speed, it turns and speeds up into them on its own (see updateOwnship)
+    controls.orderedCourseDegrees = drawSlider(x, y, sliderWidth, "COURSE  deg", controls.orderedCourseDegrees, 0.f, 360.f, { 200, 200, 200, 255 });
+    y += rowHeight;
+    controls.orderedSpeed = drawSlider(x, y, sliderWidth, "SPEED  km/s", controls.orderedSpeed, 0.f, maximumOwnshipSpeed, { 200, 200, 200, 255 });
+    y += rowHeight;
 
     // sweep speed slider from 10 degrees to a full revolution per sec
-    sonarState.sweepSpeedDegreesPerSecond
-        = drawSlider(x, y, sliderWidth, "SWEEP  deg/s", sonarState.sweepSpeedDegreesPerSecond, 10.f, 360.f, { 30, 175, 30, 255 });
+    controls.sweepSpeedDegreesPerSecond
+        = drawSlider(x, y, sliderWidth, "SWEEP  deg/s", controls.sweepSpeedDegreesPerSecond, 10.f, 360.f, { 30, 175, 30, 255 });
     y += rowHeight;
 
     // targets slider from 1 to 10 (rounded)
     {
+        int targetCount = controls.targetCount.load();
         DrawText("TARGETS", (int)x, (int)(y - 15), 12, ColorAlpha(WHITE, 0.7f));
         Rectangle targetRect = { x, y, sliderWidth, 14.f };
         DrawRectangleRec(targetRect, ColorAlpha(BLACK, 0.45f));
         DrawRectangle(
-            (int)targetRect.x, (int)targetRect.y, (int)(targetRect.width * (sonarState.targetCount - 1) / 9.f), (int)targetRect.height, { 180, 100, 30, 255 });
+            (int)targetRect.x, (int)targetRect.y, (int)(targetRect.width * std::min(1.f, (targetCount - 1) / 9.f)), (int)targetRect.height, { 180, 100, 30, 255 });
         DrawRectangleLinesEx(targetRect, 1, ColorAlpha(WHITE, 0.2f));
         char valueText[4];
-        std::snprintf(valueText, sizeof(valueText), "%d", sonarState.targetCount);
+        std::snprintf(valueText, sizeof(valueText), "%d", targetCount);
         DrawText(valueText, (int)(x + sliderWidth + 6), (int)y, 11, ColorAlpha(WHITE, 0.6f));
         if (CheckCollisionPointRec(GetMousePosition(), targetRect) && IsMouseButtonDown(MOUSE_BUTTON_LEFT)) {
             int newCount = std::clamp(1 + (int)std::round((GetMousePosition().x - targetRect.x) / targetRect.width * 9.f), 1, 10);
-            if (newCount != sonarState.targetCount)
-                setTargetCount(sonarState, newCount);
+            controls.targetCount = newCount; // the simulation spawns/removes targets on its side
         }
         y += rowHeight;
     }
@@ -436,49 +590,125 @@ static void drawUI(SonarState& sonarState, int panelWidth, int screenHeight)
     // thermocline depth slider, moves the temperature boundary layer up or down the water column,
     // 0.05 = very shallow thermocline (shadow zone starts close, most of the range area is affected),
     // 0.95 = very deep (nearly the entire depth is warm surface water, almost no shadow zone)
-    sonarState.thermoclineNormalized
-        = drawSlider(x, y, sliderWidth, "THERMOCLINE DEPTH", sonarState.thermoclineNormalized, 0.05f, 0.95f, { 255, 160, 30, 255 });
+    controls.thermoclineNormalized
+        = drawSlider(x, y, sliderWidth, "THERMOCLINE DEPTH", controls.thermoclineNormalized, 0.05f, 0.95f, { 255, 160, 30, 255 });
     y += rowHeight;
 
     // deep speed boost slider, how strongly sound speeds back up below the thermocline (SOFAR channel strength),
     // 0.0 = no recovery (deep water stays slow, shadow zone loss is severe),
     // 1.0 = strong SOFAR channel (deep speed nearly recovers to surface level, shadow loss nearly cancels out)
-    sonarState.deepSpeedBoost = drawSlider(x, y, sliderWidth, "DEEP SPEED BOOST", sonarState.deepSpeedBoost, 0.f, 1.f, { 100, 200, 255, 255 });
+    controls.deepSpeedBoost = drawSlider(x, y, sliderWidth, "DEEP SPEED BOOST", controls.deepSpeedBoost, 0.f, 1.f, { 100, 200, 255, 255 });
     y += rowHeight + 8.f;
 
     // fills whatever vertical space remains at the bottom of the panel,
     // minimum 60px to remain legible, capped at 150px so it does not crowd the sliders above
     float chartHeight = std::min(150.f, (float)screenHeight - y - 12.f);
-    if (chartHeight > 60.f)
-        drawSoundSpeedProfile(sonarState, x, y, (float)(panelWidth - 25), chartHeight);
+    if (chartHeight > 60.f) {
+        drawSoundSpeedProfile(snapshot, x, y, (float)(panelWidth - 25), chartHeight);
+        y += chartHeight + 10.f;
+    }
+
+    // transmission loss heatmap toggle, then the heatmap itself in whatever room is left, same 60px legibility rule
+    Rectangle heatmapToggle = { x, y, sliderWidth + 20.f, 20.f };
+    DrawRectangleRec(heatmapToggle, sonarDisplay.showTransmissionLoss ? Color { 90, 70, 20, 255 } : Color { 40, 40, 40, 255 });
+    DrawRectangleLinesEx(heatmapToggle, 1, ColorAlpha(WHITE, 0.25f));
+    DrawText(sonarDisplay.showTransmissionLoss ? "TL FIELD: SHOWN" : "TL FIELD: HIDDEN", (int)(heatmapToggle.x + 10), (int)(heatmapToggle.y + 5), 11, WHITE);
+    if (CheckCollisionPointRec(GetMousePosition(), heatmapToggle) && IsMouseButtonPressed(MOUSE_BUTTON_LEFT))
+        sonarDisplay.showTransmissionLoss = !sonarDisplay.showTransmissionLoss;
+    y += 20.f + 26.f;
+    float heatmapHeight = std::min(120.f, (float)screenHeight - y - 24.f);
+    if (sonarDisplay.showTransmissionLoss && heatmapHeight > 60.f)
+        drawTransmissionLoss(snapshot, sonarDisplay, x, y, (float)(panelWidth - 25), heatmapHeight);
 }
 
 #pragma region main
-int main()
+// ppi                                  -> live display, random seed so every launch is a new run
+// ppi scenario.txt                     -> live display of that scenario
+// ppi --headless scenario.txt [log]    -> no window, runs the scenario's duration as fast as possible, detections to log (detections.csv)
+int main(int argc, char** argv)
 {
+    std::vector<std::string> arguments(argv + 1, argv + argc);
+    bool headless = !arguments.empty() && arguments[0] == "--headless";
+    if (headless)
+        arguments.erase(arguments.begin());
+    Scenario scenario;
+    try {
+        if (!arguments.empty())
+            scenario = loadScenario(arguments[0]);
+        if (headless) {
+            runHeadless(scenario, arguments.size() > 1 ? arguments[1] : "detections.csv");
+            return 0;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Scenario failed: " << e.what() << std::endl;
+        return 1;
+    }
+
     const int panelWidth = 220;
     const int screenHeight = 900;
     const float radius = (screenHeight - 80.f) / 2.f; // 410 px
-    const int screenWidth = panelWidth + (int)(2.f * radius) + 60; // panel + disc diameter + margins
-    const Vector2 center = { panelWidth + (screenWidth - panelWidth) / 2.f, screenHeight / 2.f };
+    const int waterfallWidth = 360; // 2 bearing bins per pixel
+    const int screenWidth = panelWidth + (int)(2.f * radius) + 60 + waterfallWidth + 20; // panel + disc diameter + margins + waterfall
+    const Vector2 center = { panelWidth + (2.f * radius + 60.f) / 2.f, screenHeight / 2.f };
 
     InitWindow(screenWidth, screenHeight, "SONAR PPI");
     SetTargetFPS(120);
 
+    // the simulation state belongs to the simulation thread from here on, the render loop only talks to it through
+    // controls (UI -> simulation) and snapshots (simulation -> UI), one tick is run and published up front so the first frame has something to draw
     SonarState sonarState;
-    setTargetCount(sonarState, sonarState.targetCount); // spawn the initial 5 targets
+    SonarControls controls;
+    SnapshotBuffer<SonarSnapshot> snapshots;
+    if (arguments.empty()) {
+        sonarState.seed = std::random_device {}();
+        setTargetCount(sonarState, sonarState.targetCount); // spawn the initial 5 targets
+    } else {
+        applyScenario(sonarState, scenario);
+        controls.sweepSpeedDegreesPerSecond = sonarState.sweepSpeedDegreesPerSecond;
+        controls.activeMode = sonarState.activeMode;
+        controls.multiBeamCount = sonarState.multiBeamCount;
+        controls.clutterEnabled = !sonarState.clutter.scatterers.empty();
+        controls.thermoclineNormalized = sonarState.thermoclineNormalized;
+        controls.deepSpeedBoost = sonarState.deepSpeedBoost;
+        controls.arrayGeometry = sonarState.passiveArray.geometry;
+        controls.targetCount = sonarState.requestedTargetCount;
+        controls.orderedCourseDegrees = sonarState.requestedCourseDegrees;
+        controls.orderedSpeed = sonarState.requestedSpeed;
+    }
+    updateSonar(sonarState, (float)simulationTickSeconds);
+    publishSnapshot(sonarState, snapshots);
+    std::thread simulationThread(runSonarSimulation, std::ref(sonarState), std::ref(controls), std::ref(snapshots));
+
+    // one texel per field cell, filled by drawTransmissionLoss whenever the field changes
+    SonarDisplay sonarDisplay;
+    Image blankField = GenImageColor(TransmissionLossField::rangeBinCount, TransmissionLossField::depthBinCount, BLACK);
+    sonarDisplay.transmissionLossTexture = LoadTextureFromImage(blankField);
+    UnloadImage(blankField);
+    SetTextureFilter(sonarDisplay.transmissionLossTexture, TEXTURE_FILTER_BILINEAR);
+    // one texel per bearing bin per revolution, black until revolutions come in, repeat wrap is what lets the ring buffer scroll
+    Image blankWaterfall = GenImageColor(passiveBinCount, waterfallHistoryRows, BLACK);
+    sonarDisplay.waterfallTexture = LoadTextureFromImage(blankWaterfall);
+    UnloadImage(blankWaterfall);
+    SetTextureFilter(sonarDisplay.waterfallTexture, TEXTURE_FILTER_BILINEAR);
+    SetTextureWrap(sonarDisplay.waterfallTexture, TEXTURE_WRAP_REPEAT);
+    loadInstanceBatch(sonarDisplay);
 
     while (!WindowShouldClose()) {
-        float deltaTime = GetFrameTime();
-        updateSonar(sonarState, deltaTime, center, radius);
+        const SonarSnapshot& snapshot = snapshots.read(); // latest published tick, ours until the next read()
 
         BeginDrawing();
         ClearBackground(BLACK);
-        drawPPI(sonarState, center, radius); // drawn first so UI panel overlays on top
-        drawUI(sonarState, panelWidth, screenHeight);
+        drawPPI(snapshot, sonarDisplay, center, radius); // drawn first so UI panel overlays on top
+        drawUI(snapshot, controls, sonarDisplay, panelWidth, screenHeight);
+        drawWaterfall(snapshot, sonarDisplay, (float)(screenWidth - waterfallWidth - 20), 40.f, (float)waterfallWidth, screenHeight - 80.f);
         EndDrawing();
     }
 
+    controls.running = false;
+    simulationThread.join();
+    UnloadTexture(sonarDisplay.transmissionLossTexture);
+    UnloadTexture(sonarDisplay.waterfallTexture);
+    unloadInstanceBatch(sonarDisplay);
     CloseWindow();
     return 0;
 }
\ No newline at end of file
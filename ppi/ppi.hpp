@@ -1,4 +1,5 @@
 #include "main.hpp"
+#include "snapshot_buffer.hpp"
 
 // farthest distance the sonar can detect anything, edge of the green circle on screen
 static constexpr float maximumRangeKilometers = 100.f;
@@ -7,6 +8,19 @@ static constexpr float maximumRangeKilometers = 100.f;
 static constexpr float surfaceTemperature = 21.f;
 // passive sonar display is split into 720 angular "slices" around the full 360 degree circle, so 0.5° each
 static constexpr int passiveBinCount = 720;
+// the simulation runs on its own thread at this fixed step (1 kHz), at the fastest 360 deg/s sweep the arm moves 0.36° per tick
+// so no bearing is ever skipped and detection timing no longer depends on how fast the screen refreshes
+static constexpr double simulationTickSeconds = 0.001;
+// the normalized 0 to 1 depth of the sound speed profile maps onto this water column, bottom included
+static constexpr float waterDepthMeters = 1000.f;
+// our transducer hangs a few meters under the hull, that's where every ray starts from
+static constexpr float sourceDepthNormalized = 0.01f;
+// depth a target spawns at when nothing says otherwise, below the default thermocline like a submarine hiding under the layer,
+// every target then dives and climbs on its own (see Target)
+static constexpr float targetDepthNormalized = 0.6f;
+// fastest our ship can be ordered to go, in km/s like the targets (which run 1.2 to 4.4), half the slowest target's pace at most
+// so contacts still close on us and pass by
+static constexpr float maximumOwnshipSpeed = 0.6f;
 // one distinct color per simulated target (up to 10), no bright green so passive rays not confused with sonar ray
 static const Color targetColors[10] = {
     { 255, 70, 70, 255 }, // red
@@ -22,19 +36,79 @@ static const Color targetColors[10] = {
 };
 
 // represents a single simulated underwater body with a 2D position in km (x = east/west, y = north/south),
-// a velocity in km/s on each axis (how fast and in what direction it is drifting), a color index to look up in targetColors[]
+// a velocity in km/s on each axis (how fast and in what direction it is drifting), a color index to look up in targetColors[],
+// a 0 to 1 depth like the sound speed profile's and how fast it changes per second (positive = diving), whether it sits above or
+// below the thermocline decides which side of the shadow zone it's on, so changing depth is how a submarine hides or shows itself
 // the last time the rotating sweep arm detected it (so we don't redetect if it's moving along the sweep direction, default -999 for not detected yet)
+// id is the spawn order, together with the run seed it seeds the target's own random stream (see makeTarget)
 struct Target {
     float xKilometers, yKilometers;
     float velocityX, velocityY;
+    float depthNormalized = targetDepthNormalized;
+    float depthRatePerSecond = 0.f;
     int colorId;
-    float lastDetectionTime = -999.f;
+    double lastDetectionTime = -999.0;
+    int id = 0;
+    std::minstd_rand random; // 4 bytes of state, cheap enough to give one to each of thousands of targets
+};
+
+// a target a scenario file asks for, placed at spawnSeconds into the run with a fixed course (0=N, 90=E) and speed,
+// a negative depth keeps the random depth and depth rate the target would have had
+struct TargetSpawn {
+    float xKilometers, yKilometers;
+    float courseDegrees, speed;
+    double spawnSeconds = 0.0;
+    float depthNormalized = -1.f;
+    float depthRatePerSecond = 0.f;
+};
+
+// our own ship in the world frame, km east/north of where the run started (the frame targets, sensors, scatterers and the gridded water live in),
+// it steers toward the ordered course at a limited rate of turn and speeds up or slows down toward the ordered speed,
+// heading and course are the same thing here (no current, no leeway), everything our sonar measures is relative to it (see OwnshipFrame)
+struct Ownship {
+    float xKilometers = 0.f, yKilometers = 0.f;
+    float headingDegrees = 0.f; // where the bow points (0=N, 90=E)
+    float speed = 0.f; // km/s, same scale as the targets' speeds
+    float orderedCourseDegrees = 0.f, orderedSpeed = 0.f;
+};
+
+// a course and speed a scenario orders our ship to at orderSeconds into the run, the ship then turns and accelerates into it
+struct OwnshipOrder {
+    double orderSeconds = 0.0;
+    float courseDegrees, speed;
+};
+
+// every target as our ship sees it this tick (see transformToOwnship), parallel arrays indexed like SonarState::targets,
+// worked out at most once per tick after everything moved, every stage of our own sonar reads range and bearing from here
+// instead of redoing the hypot/atan2 per target on its own
+struct OwnshipFrame {
+    double tickSeconds = -1.0; // simulation time the arrays were worked out at
+    std::vector<float> eastKilometers, northKilometers; // target minus our ship
+    std::vector<float> rangeKilometers;
+    std::vector<float> bearingDegrees; // true bearing (from north), [0°, 360°)
+};
+
+// one contact reported by a sweep, what the headless log writes and what later processing stages consume,
+// passive detections only know the bearing so their range is 0, bearing and range are measured from the sensor that made it
+// (see Sensor) from where it was at the time, sensor 0 is our own ship
+struct Detection {
+    double timeSeconds;
+    int targetId;
+    bool active;
+    float bearingDegrees;
+    float rangeKilometers;
+    float signalStrength;
+    int sensorId = 0;
+    float sensorXKilometers = 0.f, sensorYKilometers = 0.f;
+    float beamWidthDegrees = 2.f; // active only, width of the beam that saw it (2° for the sweep), the bearing is only known to within it
 };
 
 // a "blip" is the bright dot that briefly flashes on the PPI when the sweep arm passes over a target and the echo comes back
-// it stores its screen pixel position, how bright it currently is (fades from 1.0 to 0.0 over time) and the color it inherited from its target
+// it stores its position in km in the world frame, where the contact was when it echoed, so the history stays put while our ship moves
+// and any display orientation is just a transform at draw time (the renderer maps it to pixels, the simulation doesn't know the screen),
+// how bright it currently is (fades from 1.0 to 0.0 over time) and the color it inherited from its target
 struct Blip {
-    float xPixels, yPixels;
+    float xKilometers, yKilometers;
     float alpha;
     Color color;
 };
@@ -45,13 +119,248 @@ struct PassiveBin {
     Color color;
 };
 
-// hold everything dynamic
+// range x depth grid of how many dB a sound loses travelling from our transducer to that cell (one-way),
+// relative to 1 km so spherical spreading alone gives 0 dB at 1 km, 20 dB at 10 km, 40 dB at 100 km (same reference as the old log10 model),
+// cells nothing reaches (deep shadow zone) saturate at maximumLossDecibels, stored row by row, one row per depth bin
+struct TransmissionLossField {
+    static constexpr int rangeBinCount = 200; // 0.5 km each
+    static constexpr int depthBinCount = 64; // ~15.6 m each
+    static constexpr float maximumLossDecibels = 150.f;
+    int key = -1; // quantized slider setting this field was traced for (see refreshTransmissionLoss)
+    float thermoclineNormalized = 0.f, deepSpeedBoost = 0.f;
+    std::vector<float> lossDecibels = std::vector<float>(rangeBinCount * depthBinCount, maximumLossDecibels);
+};
+
+// gridded sound speed over the plot (see environment.cpp), a profile of depthCount speeds every cellKilometers east and north,
+// stored as cm/s off 1500 m/s in 16 bits so even a 100 x 100 x 32 grid is only 640 KB, indexed ((north · eastCount + east) · depthCount + depth)
+struct OceanEnvironment {
+    int eastCount = 0, northCount = 0, depthCount = 0;
+    float cellKilometers = 10.f;
+    std::vector<int16_t> speedCentimeters;
+};
+
+// when the water changes across the plot a single range x depth field no longer fits every bearing, each 15° sector gets its own,
+// traced from the origin out along the sector's center bearing the first time something looks that way,
+// all of them are dropped when the environment or the origin changes (see sectorTransmissionLoss)
+static constexpr int sectorCount = 24;
+static constexpr int sectorKeyBase = 1 << 24; // sector field keys start here so they never collide with the sliders' quantized keys
+
+struct SectorFields {
+    const OceanEnvironment* environment = nullptr; // the environment the fields below were traced in
+    float originXKilometers = 0.f, originYKilometers = 0.f;
+    int ownerId = 0; // 0 = our ship, otherwise the sensor id, keeps every owner's keys apart
+    int revision = 0; // bumped on every invalidation
+    std::array<std::shared_ptr<const TransmissionLossField>, sectorCount> fields {};
+};
+
+// targets as one sonar sees them, parallel arrays the caller fills with the targets it cares about (see addTargetPath),
+// then computePathLoss looks up the one-way loss of every path at once, source depth to that target's depth,
+// 8 paths per instruction, grouped per sector field when the water is gridded, the sorted arrays are that grouping's scratch
+struct TargetPaths {
+    std::vector<int> targetIndices;
+    std::vector<float> rangeKilometers, bearingDegrees, depthNormalized, lossDecibels;
+    std::vector<int> sortedPaths;
+    std::vector<float> sortedRanges, sortedDepths, sortedLosses;
+};
+
+// a track is the tracker's belief about one contact, built from successive detections rather than a single blip,
+// the state is (x km, y km, vx km/s, vy km/s) with its 4x4 covariance (how unsure we are of each, and how they're linked),
+// fixed-size Eigen types so thousands of tracks live in one contiguous vector with no heap allocation per track
+struct Track {
+    Eigen::Vector4f state;
+    Eigen::Matrix4f covariance;
+    double stateSeconds; // time the state was predicted/updated to
+    double lastHitSeconds; // time of the last detection assigned to it
+    int id;
+    int hits = 1;
+    bool confirmed = false; // tentative until it collected enough hits to be trusted
+};
+
+// what the renderer needs of a track, the covariance stays on the simulation side
+struct TrackMark {
+    float xKilometers, yKilometers;
+    float velocityX, velocityY;
+    int id;
+    bool confirmed;
+};
+
+// active detections are buffered for trackerBatchSeconds then associated to tracks all at once (see updateTracker),
+// the vectors below are scratch space kept between batches so a batch doesn't allocate
+struct Tracker {
+    std::vector<Track> tracks;
+    std::vector<Detection> pendingDetections;
+    double lastBatchSeconds = 0.0;
+    int nextTrackId = 0;
+    std::vector<int> cellStart; // detection grid, detections of cell c are cellDetections[cellStart[c] .. cellStart[c + 1]]
+    std::vector<int> cellDetections;
+    std::vector<int> cellFill;
+    std::vector<std::tuple<float, int, int>> candidates; // (cost, track, detection) pairs that passed gating
+    std::vector<uint64_t> trackTaken; // per track, bit s set once it took a detection of sensor s this batch
+    std::vector<char> detectionTaken;
+};
+
+// everything a radix-2 FFT of one size needs precomputed (see makeFftPlan)
+struct FftPlan {
+    int size = 0;
+    std::vector<int> bitReverse;
+    std::vector<float> twiddleReal, twiddleImag; // e^(-2πi·j / 2h) of every stage, stage h at [h - 1, 2h - 1)
+};
+
+// how the hydrophones are laid out around our ship, a circular array hears all around,
+// a linear one (a line across the hull, east-west when heading north) can't tell which side of its axis a sound comes from so every contact shows twice, mirrored
+enum class ArrayGeometry {
+    Circular,
+    Linear,
+};
+
+// signal-level passive chain (see beamforming.cpp), every frame synthesizes what each hydrophone recorded over the last
+// sampleCount samples, FFTs each channel and steers a beam at every one of the passiveBinCount bearings,
+// elements sit half a wavelength apart at highestHertz, closer wastes elements, further lets grating lobes (ghost beams) in
+struct PassiveArray {
+    static constexpr int elementCount = 128;
+    static constexpr int sampleCount = 512;
+    static constexpr float sampleRateHertz = 4096.f; // one frame = 0.125 s of listening, 8 Hz per FFT bin
+    static constexpr float lowestHertz = 500.f, highestHertz = 1800.f; // processed band, below that the array is too small to point
+    ArrayGeometry geometry = ArrayGeometry::Circular;
+    std::array<float, elementCount> elementEastMeters {}, elementNorthMeters {};
+    FftPlan plan; // built on the first frame
+    std::minstd_rand noiseRandom; // ambient noise and broadband phases, seeded from the run seed on the first frame
+    double nextFrameSeconds = 0.0;
+    std::vector<float> spectrumReal, spectrumImag; // band bins x elements, element index fastest so a beam sums contiguous memory
+    std::array<float, passiveBinCount> beamSnrDecibels {}; // last frame's beam power over the background, ~0 dB where nothing is
+};
+
+// signal-level active chain (see echo.cpp), the sweep arm is a 2° transmit/receive beam that pings once per beam position,
+// a beam's received signal is complex baseband with one sample per 50 m of range, so sample i is the echo of whatever sits i·50 m away
+// (the simulation has no time of flight, a ping "comes back" from the whole 100 km at once),
+// a linear frequency modulated (LFM) ping of pulseSampleCount samples is pulse-compressed by a matched filter back to ~one range cell,
+// then cell-averaging CFAR decides which cells stand out of their neighbourhood
+struct ActiveProcessor {
+    static constexpr float beamWidthDegrees = 2.f;
+    static constexpr int beamCount = (int)(360.f / beamWidthDegrees);
+    static constexpr float rangeCellKilometers = 0.05f;
+    static constexpr int rangeCellCount = 2048; // 102.4 km
+    static constexpr int pulseSampleCount = 64;
+    static constexpr int fftSize = 4096; // room for the whole range window plus the pulse so the circular correlation doesn't wrap
+    FftPlan plan; // built on the first ping with the matched filter below
+    std::vector<float> pulseSpectrumReal, pulseSpectrumImag; // FFT of the transmitted ping
+    std::vector<float> filterSpectrumReal, filterSpectrumImag; // conjugate FFT of the Hamming-weighted ping, the matched filter
+    // per transmission loss field key, scattered energy of the seabed and water volume per range cell
+    std::unordered_map<int, std::vector<float>> reverberationAmplitudes;
+    std::vector<int> pendingBeams; // beams the sweep finished since the last batch, pinged together
+    double lastBatchSeconds = 0.0;
+    double lastMultiBeamPingSeconds = -999.0;
+    // multi-beam scratch, the targets in range as parallel arrays so the beams x targets gains run 8 targets per instruction
+    std::vector<float> targetBearings, targetLevels;
+    std::vector<int> targetCells, targetIndices;
+    uint32_t pingCount = 0; // every ping draws its noise from (run seed, ping number) so batching or threads never change a run
+};
+
+// a point that echoes a ping without being a target, a rock outcrop or wreck on the seabed, or a fish school / plankton patch in the water,
+// strength is its echo relative to a target at the same spot (its target strength minus a submarine's), each ping it answers
+// with returnProbability only (a school turns, a rock is masked by the ripple around it) and then with a Rayleigh-fading level
+struct Scatterer {
+    float xKilometers, yKilometers;
+    float velocityX, velocityY; // km/s, 0 on the seabed, a drifting school moves well under 1 m/s
+    float depthNormalized;
+    float strengthDecibels;
+    float returnProbability;
+};
+
+// what a scatterer sent back to one ping, echo level = the target echo level + echoOffsetDecibels
+struct ClutterReturn {
+    float bearingDegrees, rangeKilometers;
+    float echoOffsetDecibels;
+};
+
+// tens of thousands of scatterers indexed by a polar grid around our ship (see clutter.cpp): one column per 2° sweep beam,
+// rings of ringKilometers along it, CSR layout like the tracker's grid, scatterers of cell c are cellScatterers[cellStart[c] .. c + 1],
+// a ping only walks the columns of its own beams, drift is folded into the positions and the grid rebuilt every few seconds,
+// scatterers stay put in the world frame, the grid is rebuilt around our ship whenever it moved a little
+struct ClutterField {
+    // what the CLUTTER toggle turns on when the scenario didn't ask for any, enough to fill the display's near ranges
+    static constexpr int defaultSeabedCount = 20000, defaultBiologicCount = 10000;
+    static constexpr int columnCount = ActiveProcessor::beamCount;
+    static constexpr float ringKilometers = 2.f;
+    static constexpr int ringCount = (int)(maximumRangeKilometers / ringKilometers);
+    std::vector<Scatterer> scatterers;
+    std::vector<int> cellStart; // columnCount * ringCount + 1 entries, cell = column * ringCount + ring
+    std::vector<int> cellScatterers;
+    std::vector<int> cellFill;
+    double indexSeconds = -1.0; // time the positions were last advanced to and the grid rebuilt, -1 = never
+    float indexXKilometers = 0.f, indexYKilometers = 0.f; // where our ship was then, the grid's center
+    std::minstd_rand random; // per ping return draws, seeded from the run seed
+    TargetPaths paths; // scatterers of the current query, the path loss lookup works on them like on targets
+    std::vector<ClutterReturn> returns; // answers to the last query
+};
+
+// our ship plus up to 63 remote sensors, a fusion grid cell records which sensors' bearings crossed it as one bit each
+static constexpr int maximumSensorCount = 64;
+
+// a remote sonar platform (a sonobuoy or an anchored picket) at a fixed world position in km, with its own sweep, mode and water
+// (its own thermocline/boost, so its own ray-traced field), our ship keeps the full signal chain but a remote sensor reduces to the
+// sonar equation against its field (see sensors.cpp), cheap enough that dozens of them run next to thousands of targets,
+// active sensors report contacts when their own sweep crosses them, passive ones hear every bearing at once each frame like our array does,
+// ids start at 1, 0 is our own ship
+struct Sensor {
+    int id = 1;
+    float xKilometers = 0.f, yKilometers = 0.f;
+    float sweepAngleDegrees = 0.f, previousSweepDegrees = 0.f;
+    float sweepSpeedDegreesPerSecond = 90.f;
+    bool activeMode = false;
+    float thermoclineNormalized = 0.4f, deepSpeedBoost = 0.3f;
+    std::shared_ptr<const TransmissionLossField> transmissionLoss; // picked from the shared cache the first time the sensor runs
+    SectorFields sectors; // used instead of the field above when the scenario loaded an environment
+    TargetPaths paths;
+    std::minstd_rand random; // seeded from (run seed, sensor id) so every sensor is reproducible on its own
+    std::vector<double> lastDetectionSeconds; // per target index, same once-per-revolution rule as our own sweep
+    std::vector<Detection> detections; // active contacts of the last batch, written by the sensor's worker thread only
+    std::vector<float> bearings; // passive bearings heard in the last frame
+    double nextFrameSeconds = 0.0;
+};
+
+// one passive bearing as the fusion and the plot see it, a line from the sensor out to maximum range
+struct BearingLine {
+    float sensorXKilometers, sensorYKilometers;
+    float bearingDegrees;
+    int sensorId;
+};
+
+// a position where the passive bearings of several sensors cross, residual = worst distance from the fix to one of its bearing lines
+struct Fix {
+    float xKilometers, yKilometers;
+    int sensorCount;
+    float residualKilometers;
+};
+
+// bearing-only triangulation state (see fusion.cpp), bearings are rasterized into a grid over the plot, each cell ORs in the bit of every
+// sensor whose bearing passes through it, cells crossed by enough different sensors become fixes
+struct Fusion {
+    double lastBatchSeconds = 0.0;
+    std::vector<BearingLine> bearings; // last frame of every passive sensor, sorted by sensor then bearing
+    std::array<int, maximumSensorCount + 1> sensorStart {}; // bearings of sensor s are bearings[sensorStart[s] .. sensorStart[s + 1]]
+    std::vector<uint64_t> cellSensors;
+    std::vector<Fix> candidates; // crossings before line assignment, the lines of candidate c are candidateLines[candidateLineStart[c] .. c + 1]
+    std::vector<int> candidateLineStart, candidateLines;
+    std::vector<char> lineTaken;
+    std::vector<Fix> fixes;
+};
+
+// one row of the bearing-time waterfall per sweep revolution, texture height = how many revolutions of history it keeps,
+// 2048 revolutions is over 2 hours at the default 4 s per revolution
+static constexpr int waterfallHistoryRows = 2048;
+
+// hold everything dynamic, owned by the simulation thread only
 struct SonarState {
-    float elapsedSeconds = 0.f; // seconds since program start, used as a simulation clock
+    // seconds since program start, used as a simulation clock, double because a float adding 1 ms ticks drifts visibly after an hour
+    double elapsedSeconds = 0.0;
     float sweepAngleDegrees = 0.f; // current angle of the rotating arm (0=N, 90=E, 180=S, 270=W)
     float previousSweepDegrees = 0.f; // arm angle from last frame, the arc between this and sweepAngleDegrees
     float sweepSpeedDegreesPerSecond = 90.f; // rotation speed: 90 dps default = one full revolution every 4 seconds
+    float pendingFadeSeconds = 0.f; // time elapsed since blips and bins were last faded (see updateSonar)
     bool activeMode = true; // true = active (ping and listen), false = passive (listen only)
+    // active only, 0 = one beam riding the rotating sweep arm, otherwise this many fixed beams all around pinging together (see echo.cpp)
+    int multiBeamCount = 0;
     // the thermocline is a sharp temperature boundary layer in the ocean where warm surface water meets cold deep water,
     // sound waves bend away from it creating a "shadow zone" on the far side where signals are attenuated,
     // like a glass pane that refracts light, some gets through, some bounces off
@@ -61,13 +370,191 @@ struct SonarState {
     // after slowing down at the thermocline, this simulates that speed recovery
     // 0.0 = no recovery (sound stays slow in the deep), 1.0 = maximum speed recovery
     float deepSpeedBoost = 0.3f;
-    // updated every draw frame and read by the UI panel to show what the cursor is pointing at on the PPI
-    float mouseBearing = 0.f; // compass angle from our ship to the cursor (see sweepAngleDegrees)
-    float mouseRange = 0.f; // how far from our ship that cursor point represents in real-world kilometers
-    bool mouseOnPPI = false; // true only when the cursor is inside the green sonar circle
+    // field traced for the current thermocline/boost sliders, every traced setting is kept so dragging back and forth is free
+    std::shared_ptr<const TransmissionLossField> transmissionLoss;
+    std::unordered_map<int, std::shared_ptr<const TransmissionLossField>> transmissionLossCache;
+    // gridded water loaded by the scenario, when set it replaces the sliders' single profile for every bearing (see transmissionLossToward)
+    std::shared_ptr<const OceanEnvironment> environment;
+    SectorFields transmissionLossSectors;
+
+    Ownship ownship;
+    std::vector<OwnshipOrder> pendingOrders; // scenario orders not given yet, latest first like pendingSpawns
+    float requestedCourseDegrees = 0.f, requestedSpeed = 0.f; // last order the UI gave, scenario orders change course without the UI asking
+    OwnshipFrame ownshipFrame;
 
     int targetCount = 5;
+    int requestedTargetCount = 5; // last count the UI asked for, scenario spawns change targetCount without the UI asking
+    uint32_t seed = 1; // every random draw of the run derives from it, same seed + same inputs = same run
     std::vector<Target> targets;
+    TargetPaths targetPaths; // scratch of whichever stage is looking up our ship's loss to the targets
+    std::vector<TargetSpawn> pendingSpawns; // scenario targets not spawned yet, latest first so the next one is at the back
+    std::vector<Detection> detections; // this tick's detections only, cleared at the start of every tick
     std::vector<Blip> blips;
     std::array<PassiveBin, passiveBinCount> passiveBins {};
-};
\ No newline at end of file
+    Tracker tracker;
+    PassiveArray passiveArray;
+    ActiveProcessor activeProcessor;
+    ClutterField clutter;
+    std::vector<Sensor> sensors; // remote platforms, our own ship is not in here
+    double lastSensorBatchSeconds = 0.0;
+    Fusion fusion;
+    // brightest each bin got during the current revolution, handed over as a finished row when the arm passes north
+    std::array<PassiveBin, passiveBinCount> waterfallAccumulator {};
+    std::array<Color, passiveBinCount> waterfallRow {}; // last finished row
+    long long waterfallRowCount = 0; // rows finished so far, the renderer uploads a row whenever this moves
+};
+
+// everything a scenario file sets up (see ppi/scenario.txt for the format), durationSeconds is only used by headless runs
+struct Scenario {
+    uint32_t seed = 1;
+    double durationSeconds = 3600.0;
+    float sweepSpeedDegreesPerSecond = 90.f;
+    bool activeMode = true;
+    int multiBeamCount = 0;
+    float thermoclineNormalized = 0.4f;
+    float deepSpeedBoost = 0.3f;
+    ArrayGeometry arrayGeometry = ArrayGeometry::Circular;
+    int randomTargetCount = 0;
+    std::vector<TargetSpawn> spawns;
+    std::vector<Sensor> sensors; // a negative thermocline/boost means "same water as our ship"
+    std::shared_ptr<const OceanEnvironment> environment; // null = the sliders' single profile everywhere
+    int seabedScattererCount = 0, biologicScattererCount = 0; // clutter, none unless the scenario asks
+    std::vector<OwnshipOrder> ownshipOrders; // the ones at 0 s set where the ship starts heading, none = stopped facing north
+};
+
+// what the UI panel wants the simulation to do, written by the render thread and picked up by the simulation thread every tick,
+// each value is its own atomic so a slider drag never waits on the simulation (and the other way around)
+struct SonarControls {
+    std::atomic<float> sweepSpeedDegreesPerSecond { 90.f };
+    std::atomic<bool> activeMode { true };
+    std::atomic<float> thermoclineNormalized { 0.4f };
+    std::atomic<float> deepSpeedBoost { 0.3f };
+    std::atomic<int> targetCount { 5 };
+    std::atomic<ArrayGeometry> arrayGeometry { ArrayGeometry::Circular };
+    std::atomic<int> multiBeamCount { 0 };
+    std::atomic<bool> clutterEnabled { true };
+    std::atomic<float> orderedCourseDegrees { 0.f };
+    std::atomic<float> orderedSpeed { 0.f };
+    std::atomic<bool> running { true }; // cleared when the window closes so the simulation thread returns
+};
+
+// what the renderer needs of a remote sensor
+struct SensorMark {
+    float xKilometers, yKilometers;
+    float sweepAngleDegrees;
+    bool activeMode;
+};
+
+// copy of everything the renderer draws, taken at the end of a simulation tick
+struct SonarSnapshot {
+    double elapsedSeconds = 0.0;
+    float sweepAngleDegrees = 0.f;
+    bool activeMode = true;
+    int multiBeamCount = 0;
+    float thermoclineNormalized = 0.4f;
+    float deepSpeedBoost = 0.3f;
+    std::shared_ptr<const TransmissionLossField> transmissionLoss; // shared, not copied, fields are immutable once traced
+    std::shared_ptr<const OceanEnvironment> environment;
+    Ownship ownship;
+    std::vector<Target> targets;
+    std::vector<Blip> blips;
+    std::array<PassiveBin, passiveBinCount> passiveBins {};
+    std::vector<TrackMark> tracks;
+    std::array<Color, passiveBinCount> waterfallRow {};
+    long long waterfallRowCount = 0;
+    std::vector<SensorMark> sensors;
+    std::vector<BearingLine> bearings;
+    std::vector<Fix> fixes;
+};
+
+// one blip or one passive bin line as the GPU sees it, both are capsules (a segment with a radius), a blip is just one with a = b,
+// 24 bytes per instance, 100k blips is 2.4 MB uploaded per frame
+struct PpiInstance {
+    float ax, ay, bx, by; // segment ends in screen pixels
+    float radius; // pixels, half the line thickness for a bin
+    Color color;
+};
+
+// GPU side of the display and the cursor readouts, kept apart from SonarState which is pure simulation data
+struct SonarDisplay {
+    Texture2D transmissionLossTexture {};
+    int uploadedFieldKey = -1; // key of the field currently in the texture, re-upload when the sliders pick another one
+    bool showTransmissionLoss = true;
+    // north-up keeps north at the top, head-up (ship-stabilized) keeps our bow at the top and turns the picture as the ship turns,
+    // both are centered on our ship and only differ by the rotation applied when drawing, the stored history is the same
+    bool headUp = false;
+    // instanced capsule batch for blips and passive bins (see drawInstances)
+    Shader ppiShader {};
+    unsigned int instanceArray = 0, cornerBuffer = 0, instanceBuffer = 0;
+    int instanceCapacity = 0;
+    std::vector<PpiInstance> instances; // rebuilt every frame, capacity kept
+    Texture2D waterfallTexture {}; // ring buffer, row r of the history lives at texture row r % waterfallHistoryRows
+    long long uploadedWaterfallRows = 0;
+    // updated every draw frame and read by the UI panel to show what the cursor is pointing at on the PPI
+    float mouseBearing = 0.f; // true compass angle from our ship to the cursor whatever the display orientation (see sweepAngleDegrees)
+    float mouseRange = 0.f; // how far from our ship that cursor point represents in real-world kilometers
+    bool mouseOnPPI = false; // true only when the cursor is inside the green sonar circle
+};
+
+// propagation.cpp
+float soundSpeedMetersPerSecond(float normalizedDepth, float thermoclineNormalized, float deepSpeedBoost);
+std::shared_ptr<const TransmissionLossField> traceTransmissionLoss(float thermoclineNormalized, float deepSpeedBoost, int key);
+float transmissionLossDecibels(const TransmissionLossField& field, float rangeKilometers, float depthNormalized);
+std::shared_ptr<const TransmissionLossField> cachedTransmissionLoss(SonarState& sonarState, float thermoclineNormalized, float deepSpeedBoost);
+void refreshTransmissionLoss(SonarState& sonarState);
+const TransmissionLossField& sectorTransmissionLoss(
+    SectorFields& sectors, const OceanEnvironment& environment, float originXKilometers, float originYKilometers, float bearingDegrees);
+const TransmissionLossField& transmissionLossToward(SonarState& sonarState, float bearingDegrees);
+void findUntracedSectors(SectorFields& sectors, const OceanEnvironment& environment, float originXKilometers, float originYKilometers,
+    const std::vector<float>& bearingDegrees, std::vector<int>& sectorIds);
+void traceSector(SectorFields& sectors, int sectorId, int threadCount);
+void transmissionLossBatch(const TransmissionLossField& field, const float* rangeKilometers, const float* depthNormalized, float* lossDecibels, int count);
+void clearTargetPaths(TargetPaths& paths);
+void addTargetPath(TargetPaths& paths, int targetIndex, float rangeKilometers, float bearingDegrees, float depthNormalized);
+void computePathLoss(TargetPaths& paths, const TransmissionLossField* field, const OceanEnvironment* environment, SectorFields& sectors,
+    float originXKilometers, float originYKilometers);
+void computeOwnPathLoss(SonarState& sonarState, TargetPaths& paths);
+
+// environment.cpp
+std::shared_ptr<const OceanEnvironment> loadEnvironment(const std::string& path);
+float environmentSpeedMetersPerSecond(const OceanEnvironment& environment, float xKilometers, float yKilometers, float normalizedDepth);
+
+// sonar.cpp
+bool bearingInArc(float bearing, float arcStart, float arcEnd);
+float randomUnit(std::minstd_rand& random);
+Target makeTarget(int id, uint32_t seed);
+void setTargetCount(SonarState& sonarState, int count);
+const OwnshipFrame& transformToOwnship(SonarState& sonarState);
+void updateSonar(SonarState& sonarState, float deltaTime);
+void publishSnapshot(const SonarState& sonarState, SnapshotBuffer<SonarSnapshot>& snapshots);
+void runSonarSimulation(SonarState& sonarState, SonarControls& controls, SnapshotBuffer<SonarSnapshot>& snapshots);
+
+// scenario.cpp
+Scenario loadScenario(const std::string& path);
+void applyScenario(SonarState& sonarState, const Scenario& scenario);
+void runHeadless(const Scenario& scenario, const std::string& logPath);
+
+// tracker.cpp
+void updateTracker(SonarState& sonarState);
+
+// fft.cpp
+FftPlan makeFftPlan(int size);
+void fft(const FftPlan& plan, float* real, float* imag);
+void inverseFft(const FftPlan& plan, float* real, float* imag);
+
+// beamforming.cpp
+void updatePassiveArray(SonarState& sonarState);
+float passiveBeamStrength(const PassiveArray& array, float bearingDegrees);
+
+// echo.cpp
+void updateActivePings(SonarState& sonarState);
+
+// clutter.cpp
+void generateClutter(ClutterField& clutter, uint32_t seed, int seabedCount, int biologicCount);
+void queryClutter(SonarState& sonarState, const std::vector<int>& columns);
+
+// sensors.cpp
+void updateSensors(SonarState& sonarState);
+
+// fusion.cpp
+void updateFusion(SonarState& sonarState);
@@ -0,0 +1,415 @@
+#include "ppi.hpp"
+
+// rays are launched in a fan from -60° (toward the surface) to +60° (toward the bottom), steeper ones would only bounce
+// between surface and bottom losing energy every time so they never matter at range,
+// a gridded environment traces one field per bearing sector so it gets half the rays per field (see traceSectorTransmissionLoss)
+static constexpr int rayCount = 2048;
+static constexpr int sectorRayCount = 1024;
+// a range-dependent environment is sampled along the sector's bearing every km, rays interpolate between samples
+static constexpr int sectorRangeSampleCount = (int)maximumRangeKilometers + 1;
+static constexpr float maximumLaunchDegrees = 60.f;
+// distance travelled along the ray between two Snell updates, small enough to hit most ~15 m depth bins on the way
+static constexpr float rayStepMeters = 50.f;
+// seawater absorbs sound on top of spreading it, ~0.06 dB/km is the order of magnitude around 1 kHz
+static constexpr float absorptionDecibelsPerKilometer = 0.06f;
+// fraction of energy a ray keeps when it bounces off the seabed (~1 dB per bounce on sand), the surface is a near perfect mirror
+static constexpr float bottomReflectionFactor = 0.8f;
+// traced settings are kept until there are this many, then the cache starts over (64 * 51 KB = ~3 MB)
+static constexpr size_t maximumCachedFields = 64;
+
+// returns the sound speed at a given normalizedDepth (0.0 = surface, 1.0 = deepest),
+// above the thermocline: speed linearly drops from surfaceSpeed down to minimumSpeed as you go deeper,
+// below the thermocline: speed linearly rises from minimumSpeed back up toward deepSpeed (the SOFAR channel effect),
+// the 1e-4 added to each denominator prevents a divide-by-zero when the thermocline is at exactly 0 or 1
+float soundSpeedMetersPerSecond(float normalizedDepth, float thermoclineNormalized, float deepSpeedBoost)
+{
+    float surfaceSpeed = 1450.f + 3.5f * surfaceTemperature; // warmer surface = faster sound
+    float minimumSpeed = surfaceSpeed - 80.f; // the slowest point, right at the thermocline boundary
+    float deepSpeed = minimumSpeed + deepSpeedBoost * 100.f; // how much speed recovers in the deep layer
+    if (normalizedDepth <= thermoclineNormalized)
+        return surfaceSpeed - (surfaceSpeed - minimumSpeed) * (normalizedDepth / (thermoclineNormalized + 1e-4f));
+    return minimumSpeed + (deepSpeed - minimumSpeed) * ((normalizedDepth - thermoclineNormalized) / (1.f - thermoclineNormalized + 1e-4f));
+}
+
+// sound bends toward slower water, exactly like light entering glass, Snell's law says cos(angle) / speed stays constant along a ray
+// (angle measured from the horizontal), so each step we move the ray along its current angle then rescale cos(angle) by newSpeed / oldSpeed:
+// - going down above the thermocline, speed drops -> cos drops -> the ray steepens and dives (that's what empties the shallow water at range)
+// - going down below the thermocline, speed rises -> cos rises -> the ray flattens, if cos would exceed 1 the ray can't go any deeper,
+//   it turned horizontal somewhere in that step and now heads back up (the SOFAR channel traps sound that way)
+// every ray carries the slice of power its launch angle represents, which it deposits in each grid cell it crosses,
+// the more rays bunch up in a cell the louder it is there, no ray at all = shadow zone
+// rays are split across threadCount threads (all cores, or 1 when the caller already spreads several fields across them),
+// each thread owns a private energy grid so no locking, then all grids are summed up,
+// speedTable holds rangeSampleCount profiles sampled every meter of depth, evenly spread from 0 to maximum range (1 = the same water everywhere),
+// when the water changes along the way the same rescaling is applied with the speed at the ray's new range and depth, exact for layers,
+// a good approximation as long as the profile changes slowly over a wavelength of range (fronts and eddies span kilometers)
+static std::shared_ptr<TransmissionLossField> traceField(const std::vector<float>& speedTable, int rangeSampleCount, int tracedRayCount, int threadCount)
+{
+    constexpr int rangeBinCount = TransmissionLossField::rangeBinCount;
+    constexpr int depthBinCount = TransmissionLossField::depthBinCount;
+    const float maximumRangeMeters = maximumRangeKilometers * 1000.f;
+    const float rangeCellMeters = maximumRangeMeters / rangeBinCount;
+    const float depthCellMeters = waterDepthMeters / depthBinCount;
+    const float launchSpanRadians = 2.f * maximumLaunchDegrees * DEG2RAD;
+    // power multiplier per step, -0.06 dB/km -> 10^(-0.06 * 0.05 / 10) per 50 m step
+    const double absorptionPerStep = std::pow(10.0, -absorptionDecibelsPerKilometer * rayStepMeters / 1000.0 / 10.0);
+
+    // rays only interpolate in the table instead of re-evaluating the profile millions of times
+    const int profileLength = (int)waterDepthMeters + 2;
+    const float samplesPerMeter = rangeSampleCount > 1 ? (rangeSampleCount - 1) / maximumRangeMeters : 0.f;
+    auto speedAt = [&](float rangeMeters, float depthMeters) {
+        int meter = std::clamp((int)depthMeters, 0, (int)waterDepthMeters);
+        float blend = depthMeters - meter;
+        float rangePosition = std::min(rangeMeters * samplesPerMeter, rangeSampleCount - 1.f);
+        int rangeSample = std::min((int)rangePosition, std::max(rangeSampleCount - 2, 0));
+        const float* near = &speedTable[(size_t)rangeSample * profileLength + meter];
+        float nearSpeed = near[0] + (near[1] - near[0]) * blend;
+        if (rangeSampleCount == 1)
+            return nearSpeed;
+        const float* far = near + profileLength;
+        float farSpeed = far[0] + (far[1] - far[0]) * blend;
+        return nearSpeed + (farSpeed - nearSpeed) * (rangePosition - rangeSample);
+    };
+
+    std::vector<std::vector<double>> threadEnergy(threadCount, std::vector<double>(rangeBinCount * depthBinCount, 0.0));
+    std::vector<std::thread> workers;
+    for (int threadId = 0; threadId < threadCount; ++threadId) {
+        workers.emplace_back([&, threadId] {
+            std::vector<double>& energy = threadEnergy[threadId];
+            // interleave rays across threads so shallow and steep rays (which die early) are evenly spread
+            for (int rayId = threadId; rayId < tracedRayCount; rayId += threadCount) {
+                float launchRadians = -maximumLaunchDegrees * DEG2RAD + (rayId + 0.5f) * launchSpanRadians / tracedRayCount;
+                // a point source radiates 1 W over the whole sphere, the band between launch and launch + dAngle (all around us)
+                // covers cos(launch) * dAngle / 2 of it
+                double power = std::cos(launchRadians) * (launchSpanRadians / tracedRayCount) / 2.0;
+                float cosine = std::cos(launchRadians);
+                float direction = launchRadians >= 0.f ? 1.f : -1.f; // +1 = heading down, -1 = heading up
+                float depth = sourceDepthNormalized * waterDepthMeters;
+                float speed = speedAt(0.f, depth);
+                float range = 0.f;
+                // once a ray is 60 dB below what it started with (steep rays after ~60 bottom bounces) it can't move any cell's total anymore
+                const double negligiblePower = power * 1e-6;
+
+                while (range < maximumRangeMeters && power > negligiblePower) {
+                    float sine = std::sqrt(std::max(1e-6f, 1.f - cosine * cosine));
+                    float rangeStep = rayStepMeters * cosine;
+                    float nextDepth = depth + direction * rayStepMeters * sine;
+                    float nextDirection = direction;
+                    // surface is a mirror, the seabed a lossy one
+                    if (nextDepth < 0.f) {
+                        nextDepth = -nextDepth;
+                        nextDirection = 1.f;
+                    } else if (nextDepth > waterDepthMeters) {
+                        nextDepth = 2.f * waterDepthMeters - nextDepth;
+                        nextDirection = -1.f;
+                        power *= bottomReflectionFactor;
+                    }
+                    float nextSpeed = speedAt(range + rangeStep, nextDepth);
+                    float nextCosine = cosine * nextSpeed / speed;
+                    if (nextCosine >= 1.f) {
+                        // turning point, stay at this depth this step and come back the other way
+                        nextDepth = depth;
+                        nextSpeed = speed;
+                        nextCosine = cosine;
+                        nextDirection = -direction;
+                    }
+                    range += rangeStep;
+                    depth = nextDepth;
+                    speed = nextSpeed;
+                    cosine = nextCosine;
+                    direction = nextDirection;
+                    power *= absorptionPerStep;
+
+                    int rangeBin = (int)(range / rangeCellMeters);
+                    int depthBin = std::min((int)(depth / depthCellMeters), depthBinCount - 1);
+                    if (rangeBin >= rangeBinCount)
+                        break;
+                    // deposit weighted by how much of the cell's width this step covered, so a cell's total is the average power flowing through it
+                    energy[depthBin * rangeBinCount + rangeBin] += power * (rangeStep / rangeCellMeters);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+
+    std::vector<double> intensity(rangeBinCount * depthBinCount, 0.0);
+    for (const auto& energy : threadEnergy)
+        for (size_t cellId = 0; cellId < intensity.size(); ++cellId)
+            intensity[cellId] += energy[cellId];
+    // the power flowing through a cell is spread over a ring of radius range and height depthCell all around us (area 2π·r·h),
+    // intensity = power / area, the ring gets bigger with range which is what makes sound fade (cylindrical spreading once trapped)
+    for (int depthBin = 0; depthBin < depthBinCount; ++depthBin)
+        for (int rangeBin = 0; rangeBin < rangeBinCount; ++rangeBin)
+            intensity[depthBin * rangeBinCount + rangeBin] /= 2.0 * M_PI * ((rangeBin + 0.5) * rangeCellMeters) * depthCellMeters;
+
+    auto field = std::make_shared<TransmissionLossField>();
+    // a finite number of rays leaves a speckle of lucky/unlucky cells, a 3x3 average in intensity (not dB) smooths it the physical way,
+    // then TL = -10·log10(intensity / intensity at 1 m), 1 m from a 1 W point source is 1 / 4π, minus 60 dB to rebase it to 1 km
+    for (int depthBin = 0; depthBin < depthBinCount; ++depthBin) {
+        for (int rangeBin = 0; rangeBin < rangeBinCount; ++rangeBin) {
+            double sum = 0.0;
+            int count = 0;
+            for (int neighborDepth = std::max(0, depthBin - 1); neighborDepth <= std::min(depthBinCount - 1, depthBin + 1); ++neighborDepth)
+                for (int neighborRange = std::max(0, rangeBin - 1); neighborRange <= std::min(rangeBinCount - 1, rangeBin + 1); ++neighborRange, ++count)
+                    sum += intensity[neighborDepth * rangeBinCount + neighborRange];
+            double smoothed = sum / count;
+            float loss = smoothed > 0.0 ? (float)(-10.0 * std::log10(smoothed * 4.0 * M_PI)) - 60.f : TransmissionLossField::maximumLossDecibels;
+            field->lossDecibels[depthBin * rangeBinCount + rangeBin] = std::min(loss, TransmissionLossField::maximumLossDecibels);
+        }
+    }
+    return field;
+}
+
+// one profile for the whole range, the sliders' setting
+std::shared_ptr<const TransmissionLossField> traceTransmissionLoss(float thermoclineNormalized, float deepSpeedBoost, int key)
+{
+    std::vector<float> speedTable((int)waterDepthMeters + 2);
+    for (size_t meter = 0; meter < speedTable.size(); ++meter)
+        speedTable[meter] = soundSpeedMetersPerSecond(std::min(1.f, meter / waterDepthMeters), thermoclineNormalized, deepSpeedBoost);
+    std::shared_ptr<TransmissionLossField> field = traceField(speedTable, 1, rayCount, (int)std::max(1u, std::thread::hardware_concurrency()));
+    field->key = key;
+    field->thermoclineNormalized = thermoclineNormalized;
+    field->deepSpeedBoost = deepSpeedBoost;
+    return field;
+}
+
+// the field from a point toward one bearing of a gridded environment, the profile under each km of the way is sampled into the table first
+static std::shared_ptr<const TransmissionLossField> traceSectorTransmissionLoss(
+    const OceanEnvironment& environment, float originXKilometers, float originYKilometers, float bearingDegrees, int key, int threadCount)
+{
+    const int profileLength = (int)waterDepthMeters + 2;
+    std::vector<float> speedTable((size_t)sectorRangeSampleCount * profileLength);
+    float directionX = std::sin(bearingDegrees * DEG2RAD), directionY = std::cos(bearingDegrees * DEG2RAD);
+    for (int rangeSample = 0; rangeSample < sectorRangeSampleCount; ++rangeSample) {
+        float rangeKilometers = rangeSample * maximumRangeKilometers / (sectorRangeSampleCount - 1);
+        float xKilometers = originXKilometers + directionX * rangeKilometers, yKilometers = originYKilometers + directionY * rangeKilometers;
+        for (int meter = 0; meter < profileLength; ++meter)
+            speedTable[(size_t)rangeSample * profileLength + meter]
+                = environmentSpeedMetersPerSecond(environment, xKilometers, yKilometers, std::min(1.f, meter / waterDepthMeters));
+    }
+    std::shared_ptr<TransmissionLossField> field = traceField(speedTable, sectorRangeSampleCount, sectorRayCount, threadCount);
+    field->key = key;
+    return field;
+}
+
+// bilinear lookup between the 4 surrounding cell centers, inside the first half cell (< 250 m) there is no center to blend with
+// so we fall back to plain spherical spreading which is what the rays do that close anyway
+float transmissionLossDecibels(const TransmissionLossField& field, float rangeKilometers, float depthNormalized)
+{
+    constexpr int rangeBinCount = TransmissionLossField::rangeBinCount;
+    constexpr int depthBinCount = TransmissionLossField::depthBinCount;
+    float rangePosition = rangeKilometers / maximumRangeKilometers * rangeBinCount - 0.5f;
+    if (rangePosition < 0.f)
+        return 20.f * std::log10(std::max(rangeKilometers, 0.01f));
+    float depthPosition = std::clamp(depthNormalized * depthBinCount - 0.5f, 0.f, depthBinCount - 1.f);
+    rangePosition = std::min(rangePosition, rangeBinCount - 1.f);
+    int rangeBin = std::min((int)rangePosition, rangeBinCount - 2);
+    int depthBin = std::min((int)depthPosition, depthBinCount - 2);
+    float rangeBlend = rangePosition - rangeBin;
+    float depthBlend = depthPosition - depthBin;
+    const float* row = &field.lossDecibels[depthBin * rangeBinCount + rangeBin];
+    float top = row[0] + (row[1] - row[0]) * rangeBlend;
+    float bottom = row[rangeBinCount] + (row[rangeBinCount + 1] - row[rangeBinCount]) * rangeBlend;
+    return top + (bottom - top) * depthBlend;
+}
+
+// the same lookup for count points at once, 8 per instruction with AVX2: bin positions and blends in registers, the 4 corners of every
+// cell fetched with gathers, every operation in the scalar version's order so both give bit identical results whatever the batch split,
+// points inside the first half cell take the scalar path afterwards (they are rare, targets closer than 250 m)
+void transmissionLossBatch(const TransmissionLossField& field, const float* rangeKilometers, const float* depthNormalized, float* lossDecibels, int count)
+{
+    int index = 0;
+#ifdef __AVX2__
+    constexpr int rangeBinCount = TransmissionLossField::rangeBinCount;
+    constexpr int depthBinCount = TransmissionLossField::depthBinCount;
+    const __m256 maximumRange = _mm256_set1_ps(maximumRangeKilometers), rangeBins = _mm256_set1_ps((float)rangeBinCount);
+    const __m256 depthBins = _mm256_set1_ps((float)depthBinCount), half = _mm256_set1_ps(0.5f), zero = _mm256_setzero_ps();
+    const __m256 lastRangePosition = _mm256_set1_ps(rangeBinCount - 1.f), lastDepthPosition = _mm256_set1_ps(depthBinCount - 1.f);
+    const __m256i lastRangeBin = _mm256_set1_epi32(rangeBinCount - 2), lastDepthBin = _mm256_set1_epi32(depthBinCount - 2);
+    const __m256i rowLength = _mm256_set1_epi32(rangeBinCount);
+    const float* loss = field.lossDecibels.data();
+    for (; index + 8 <= count; index += 8) {
+        __m256 rangePosition = _mm256_sub_ps(_mm256_mul_ps(_mm256_div_ps(_mm256_loadu_ps(rangeKilometers + index), maximumRange), rangeBins), half);
+        int near = _mm256_movemask_ps(_mm256_cmp_ps(rangePosition, zero, _CMP_LT_OQ));
+        rangePosition = _mm256_min_ps(_mm256_max_ps(rangePosition, zero), lastRangePosition);
+        __m256 depthPosition = _mm256_sub_ps(_mm256_mul_ps(_mm256_loadu_ps(depthNormalized + index), depthBins), half);
+        depthPosition = _mm256_min_ps(_mm256_max_ps(depthPosition, zero), lastDepthPosition);
+        __m256i rangeBin = _mm256_min_epi32(_mm256_cvttps_epi32(rangePosition), lastRangeBin);
+        __m256i depthBin = _mm256_min_epi32(_mm256_cvttps_epi32(depthPosition), lastDepthBin);
+        __m256 rangeBlend = _mm256_sub_ps(rangePosition, _mm256_cvtepi32_ps(rangeBin));
+        __m256 depthBlend = _mm256_sub_ps(depthPosition, _mm256_cvtepi32_ps(depthBin));
+        __m256i cell = _mm256_add_epi32(_mm256_mullo_epi32(depthBin, rowLength), rangeBin);
+        __m256 topLeft = _mm256_i32gather_ps(loss, cell, 4), topRight = _mm256_i32gather_ps(loss + 1, cell, 4);
+        __m256 bottomLeft = _mm256_i32gather_ps(loss + rangeBinCount, cell, 4), bottomRight = _mm256_i32gather_ps(loss + rangeBinCount + 1, cell, 4);
+        __m256 top = _mm256_add_ps(topLeft, _mm256_mul_ps(_mm256_sub_ps(topRight, topLeft), rangeBlend));
+        __m256 bottom = _mm256_add_ps(bottomLeft, _mm256_mul_ps(_mm256_sub_ps(bottomRight, bottomLeft), rangeBlend));
+        _mm256_storeu_ps(lossDecibels + index, _mm256_add_ps(top, _mm256_mul_ps(_mm256_sub_ps(bottom, top), depthBlend)));
+        for (; near; near &= near - 1) {
+            int lane = index + std::countr_zero((unsigned)near);
+            lossDecibels[lane] = transmissionLossDecibels(field, rangeKilometers[lane], depthNormalized[lane]);
+        }
+    }
+#endif
+    for (; index < count; ++index)
+        lossDecibels[index] = transmissionLossDecibels(field, rangeKilometers[index], depthNormalized[index]);
+}
+
+// sliders move continuously but a field only changes visibly every 0.01 of thermocline/boost, so both are rounded to that
+// and packed in one int key (thermocline * 1000 + boost), a new key is traced once then served from the cache until it holds maximumCachedFields and starts over,
+// remote sensors draw their own water from the same cache, a field already handed out stays alive through its shared_ptr if the cache is cleared
+std::shared_ptr<const TransmissionLossField> cachedTransmissionLoss(SonarState& sonarState, float thermoclineNormalized, float deepSpeedBoost)
+{
+    int thermoclineKey = (int)std::lround(thermoclineNormalized * 100.f);
+    int boostKey = (int)std::lround(deepSpeedBoost * 100.f);
+    int key = thermoclineKey * 1000 + boostKey;
+    auto cached = sonarState.transmissionLossCache.find(key);
+    if (cached == sonarState.transmissionLossCache.end()) {
+        if (sonarState.transmissionLossCache.size() >= maximumCachedFields)
+            sonarState.transmissionLossCache.clear();
+        cached = sonarState.transmissionLossCache.emplace(key, traceTransmissionLoss(thermoclineKey / 100.f, boostKey / 100.f, key)).first;
+    }
+    return cached->second;
+}
+
+// our own ship's field for the current sliders, the key check skips the hash lookup on the 1 kHz tick when nothing moved
+void refreshTransmissionLoss(SonarState& sonarState)
+{
+    int key = (int)std::lround(sonarState.thermoclineNormalized * 100.f) * 1000 + (int)std::lround(sonarState.deepSpeedBoost * 100.f);
+    if (sonarState.transmissionLoss && sonarState.transmissionLoss->key == key)
+        return;
+    sonarState.transmissionLoss = cachedTransmissionLoss(sonarState, sonarState.thermoclineNormalized, sonarState.deepSpeedBoost);
+}
+
+// 15° sector a bearing falls in, any bearing, negative or over 360 included
+static int sectorOf(float bearingDegrees)
+{
+    return std::clamp((int)(std::fmod(std::fmod(bearingDegrees, 360.f) + 360.f, 360.f) / (360.f / sectorCount)), 0, sectorCount - 1);
+}
+
+// how far a sonar moves before its sector fields are retraced, the gridded water changes over cells of ~10 km
+// so a couple of km off the traced origin is still the same water, and a ship under way retraces every sector it uses once per 2 km
+static constexpr float sectorRetraceKilometers = 2.f;
+
+// every sector is dropped when the environment changes or the origin moved more than sectorRetraceKilometers (the sectors' fields
+// no longer start from there), keys stay unique per owner and origin so the display and the reverberation cache tell the new fields from the old
+static void refreshSectors(SectorFields& sectors, const OceanEnvironment& environment, float originXKilometers, float originYKilometers)
+{
+    if (sectors.environment != &environment || std::hypot(originXKilometers - sectors.originXKilometers, originYKilometers - sectors.originYKilometers) > sectorRetraceKilometers) {
+        if (sectors.environment)
+            ++sectors.revision;
+        sectors.environment = &environment;
+        sectors.originXKilometers = originXKilometers;
+        sectors.originYKilometers = originYKilometers;
+        sectors.fields.fill(nullptr);
+    }
+}
+
+// one sector's field from the current origin, its rays across threadCount threads
+void traceSector(SectorFields& sectors, int sectorId, int threadCount)
+{
+    int key = sectorKeyBase + (sectors.revision * maximumSensorCount + sectors.ownerId) * sectorCount + sectorId;
+    sectors.fields[sectorId] = traceSectorTransmissionLoss(
+        *sectors.environment, sectors.originXKilometers, sectors.originYKilometers, (sectorId + 0.5f) * 360.f / sectorCount, key, threadCount);
+}
+
+// the sectors toward these bearings that have no field yet for this origin, each listed once
+void findUntracedSectors(SectorFields& sectors, const OceanEnvironment& environment, float originXKilometers, float originYKilometers,
+    const std::vector<float>& bearingDegrees, std::vector<int>& sectorIds)
+{
+    refreshSectors(sectors, environment, originXKilometers, originYKilometers);
+    std::array<bool, sectorCount> listed {};
+    sectorIds.clear();
+    for (float bearing : bearingDegrees) {
+        int sectorId = sectorOf(bearing);
+        if (!sectors.fields[sectorId] && !listed[sectorId]) {
+            listed[sectorId] = true;
+            sectorIds.push_back(sectorId);
+        }
+    }
+}
+
+// the field of the sector a bearing falls in, traced across the cores the first time it's asked for
+const TransmissionLossField& sectorTransmissionLoss(
+    SectorFields& sectors, const OceanEnvironment& environment, float originXKilometers, float originYKilometers, float bearingDegrees)
+{
+    refreshSectors(sectors, environment, originXKilometers, originYKilometers);
+    int sectorId = sectorOf(bearingDegrees);
+    if (!sectors.fields[sectorId])
+        traceSector(sectors, sectorId, (int)std::max(1u, std::thread::hardware_concurrency()));
+    return *sectors.fields[sectorId];
+}
+
+// our own ship's loss toward a bearing, from the gridded environment when a scenario loaded one, the sliders' single profile otherwise
+const TransmissionLossField& transmissionLossToward(SonarState& sonarState, float bearingDegrees)
+{
+    if (!sonarState.environment)
+        return *sonarState.transmissionLoss;
+    return sectorTransmissionLoss(
+        sonarState.transmissionLossSectors, *sonarState.environment, sonarState.ownship.xKilometers, sonarState.ownship.yKilometers, bearingDegrees);
+}
+
+#pragma region paths
+void clearTargetPaths(TargetPaths& paths)
+{
+    paths.targetIndices.clear();
+    paths.rangeKilometers.clear();
+    paths.bearingDegrees.clear();
+    paths.depthNormalized.clear();
+}
+
+void addTargetPath(TargetPaths& paths, int targetIndex, float rangeKilometers, float bearingDegrees, float depthNormalized)
+{
+    paths.targetIndices.push_back(targetIndex);
+    paths.rangeKilometers.push_back(rangeKilometers);
+    paths.bearingDegrees.push_back(bearingDegrees);
+    paths.depthNormalized.push_back(depthNormalized);
+}
+
+// fills paths.lossDecibels, in one batch against field when there's no environment (the same field holds all around), otherwise the paths are counting-sorted by sector,
+// each sector's run is looked up in one batch against that sector's field (traced right there the first time) and scattered back
+void computePathLoss(TargetPaths& paths, const TransmissionLossField* field, const OceanEnvironment* environment, SectorFields& sectors,
+    float originXKilometers, float originYKilometers)
+{
+    const int pathCount = (int)paths.targetIndices.size();
+    paths.lossDecibels.resize(pathCount);
+    if (!environment) {
+        transmissionLossBatch(*field, paths.rangeKilometers.data(), paths.depthNormalized.data(), paths.lossDecibels.data(), pathCount);
+        return;
+    }
+
+    std::array<int, sectorCount + 1> sectorStart {};
+    for (int pathId = 0; pathId < pathCount; ++pathId)
+        ++sectorStart[sectorOf(paths.bearingDegrees[pathId]) + 1];
+    for (int sectorId = 0; sectorId < sectorCount; ++sectorId)
+        sectorStart[sectorId + 1] += sectorStart[sectorId];
+    std::array<int, sectorCount> sectorFill;
+    std::copy(sectorStart.begin(), sectorStart.end() - 1, sectorFill.begin());
+    paths.sortedPaths.resize(pathCount);
+    paths.sortedRanges.resize(pathCount);
+    paths.sortedDepths.resize(pathCount);
+    paths.sortedLosses.resize(pathCount);
+    for (int pathId = 0; pathId < pathCount; ++pathId) {
+        int slot = sectorFill[sectorOf(paths.bearingDegrees[pathId])]++;
+        paths.sortedPaths[slot] = pathId;
+        paths.sortedRanges[slot] = paths.rangeKilometers[pathId];
+        paths.sortedDepths[slot] = paths.depthNormalized[pathId];
+    }
+    for (int sectorId = 0; sectorId < sectorCount; ++sectorId) {
+        int first = sectorStart[sectorId], runLength = sectorStart[sectorId + 1] - first;
+        if (runLength == 0)
+            continue;
+        const TransmissionLossField& sectorField
+            = sectorTransmissionLoss(sectors, *environment, originXKilometers, originYKilometers, (sectorId + 0.5f) * 360.f / sectorCount);
+        transmissionLossBatch(sectorField, &paths.sortedRanges[first], &paths.sortedDepths[first], &paths.sortedLosses[first], runLength);
+    }
+    for (int slot = 0; slot < pathCount; ++slot)
+        paths.lossDecibels[paths.sortedPaths[slot]] = paths.sortedLosses[slot];
+}
+
+// our own ship's paths, from wherever it is now in our water
+void computeOwnPathLoss(SonarState& sonarState, TargetPaths& paths)
+{
+    computePathLoss(paths, sonarState.transmissionLoss.get(), sonarState.environment.get(), sonarState.transmissionLossSectors,
+        sonarState.ownship.xKilometers, sonarState.ownship.yKilometers);
+}
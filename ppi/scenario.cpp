@@ -0,0 +1,211 @@
+#include "ppi.hpp"
+
+#pragma region scenario
+// reads a scenario file, one "keyword values..." per line, # starts a comment, unknown keywords or missing values throw with the line number
+// (see ppi/scenario.txt), ex:
+//   seed 42                     -> every random draw of the run derives from 42
+//   target 30 40 225 2.0 120    -> a target at 30 km east 40 km north heading 225° at 2 km/s, appearing 120 s into the run
+//   target 0 50 90 1.5 0 300 -2 -> one 50 km north heading east at 300 m deep, climbing 2 m/s
+//   random 8                    -> 8 more targets spawned at random like the interactive ones
+//   sensor -40 30 passive       -> a passive buoy 40 km west 30 km north of where our ship starts, in our water
+//   environment ocean.txt       -> gridded sound speed read from ocean.txt next to the scenario file, replaces thermocline/boost
+//   clutter 20000 10000         -> 20000 seabed and 10000 biologic scatterers echoing our active pings
+//   ownship 45 0.5              -> our ship starts heading 45° at 0.5 km/s
+//   ownship 180 0.3 600         -> then 600 s into the run it's ordered round to 180° at 0.3 km/s and turns into it
+Scenario loadScenario(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+        throw std::runtime_error("Cannot open: " + path);
+
+    Scenario scenario;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+        std::istringstream words(line);
+        std::string keyword;
+        if (!(words >> keyword))
+            continue; // blank or comment-only line
+        auto fail = [&](const std::string& reason) { throw std::runtime_error(path + ":" + std::to_string(lineNumber) + " " + reason); };
+
+        if (keyword == "seed") {
+            if (!(words >> scenario.seed))
+                fail("seed needs an unsigned integer");
+        } else if (keyword == "duration") {
+            if (!(words >> scenario.durationSeconds) || scenario.durationSeconds <= 0.0)
+                fail("duration needs a positive number of seconds");
+        } else if (keyword == "sweep") {
+            if (!(words >> scenario.sweepSpeedDegreesPerSecond))
+                fail("sweep needs deg/s");
+            scenario.sweepSpeedDegreesPerSecond = std::clamp(scenario.sweepSpeedDegreesPerSecond, 10.f, 360.f);
+        } else if (keyword == "mode") {
+            std::string mode;
+            words >> mode;
+            if (mode != "active" && mode != "passive")
+                fail("mode is either active or passive");
+            scenario.activeMode = mode == "active";
+        } else if (keyword == "beams") {
+            if (!(words >> scenario.multiBeamCount) || (scenario.multiBeamCount != 0 && (scenario.multiBeamCount < 64 || scenario.multiBeamCount > 256)))
+                fail("beams needs 0 (rotating sweep) or a fixed beam count from 64 to 256");
+        } else if (keyword == "array") {
+            std::string geometry;
+            words >> geometry;
+            if (geometry != "circular" && geometry != "linear")
+                fail("array is either circular or linear");
+            scenario.arrayGeometry = geometry == "linear" ? ArrayGeometry::Linear : ArrayGeometry::Circular;
+        } else if (keyword == "thermocline") {
+            if (!(words >> scenario.thermoclineNormalized))
+                fail("thermocline needs a 0 to 1 depth");
+            scenario.thermoclineNormalized = std::clamp(scenario.thermoclineNormalized, 0.05f, 0.95f);
+        } else if (keyword == "boost") {
+            if (!(words >> scenario.deepSpeedBoost))
+                fail("boost needs a 0 to 1 value");
+            scenario.deepSpeedBoost = std::clamp(scenario.deepSpeedBoost, 0.f, 1.f);
+        } else if (keyword == "environment") {
+            std::string environmentPath;
+            if (!(words >> environmentPath))
+                fail("environment needs a file path");
+            // relative to the scenario so the pair runs from anywhere, loading errors already carry the environment file's own line
+            scenario.environment = loadEnvironment((std::filesystem::path(path).parent_path() / environmentPath).string());
+        } else if (keyword == "clutter") {
+            if (!(words >> scenario.seabedScattererCount >> scenario.biologicScattererCount) || scenario.seabedScattererCount < 0
+                || scenario.biologicScattererCount < 0)
+                fail("clutter needs <seabed scatterers> <biologic scatterers>");
+        } else if (keyword == "ownship") {
+            OwnshipOrder order;
+            if (!(words >> order.courseDegrees >> order.speed) || order.speed < 0.f || order.speed > maximumOwnshipSpeed) {
+                std::ostringstream limit;
+                limit << maximumOwnshipSpeed;
+                fail("ownship needs <course deg> <speed km/s, 0 to " + limit.str() + "> [order s]");
+            }
+            if (!(words >> order.orderSeconds))
+                order.orderSeconds = 0.0;
+            order.courseDegrees = std::fmod(std::fmod(order.courseDegrees, 360.f) + 360.f, 360.f);
+            scenario.ownshipOrders.push_back(order);
+        } else if (keyword == "target") {
+            TargetSpawn spawn;
+            if (!(words >> spawn.xKilometers >> spawn.yKilometers >> spawn.courseDegrees >> spawn.speed))
+                fail("target needs <east km> <north km> <course deg> <speed km/s> [spawn s] [depth m] [depth rate m/s, + dives]");
+            if (!(words >> spawn.spawnSeconds))
+                spawn.spawnSeconds = 0.0;
+            float depthMeters, depthRate;
+            if (words >> depthMeters) {
+                if (depthMeters < 0.f || depthMeters > waterDepthMeters)
+                    fail("target depth must be 0 to " + std::to_string((int)waterDepthMeters) + " m");
+                spawn.depthNormalized = depthMeters / waterDepthMeters;
+                spawn.depthRatePerSecond = words >> depthRate ? depthRate / waterDepthMeters : 0.f;
+            }
+            scenario.spawns.push_back(spawn);
+        } else if (keyword == "sensor") {
+            Sensor sensor;
+            std::string mode;
+            if (!(words >> sensor.xKilometers >> sensor.yKilometers >> mode) || (mode != "active" && mode != "passive"))
+                fail("sensor needs <east km> <north km> <active|passive> [sweep deg/s] [thermocline] [boost]");
+            sensor.activeMode = mode == "active";
+            if (!(words >> sensor.sweepSpeedDegreesPerSecond))
+                sensor.sweepSpeedDegreesPerSecond = 90.f;
+            if (!(words >> sensor.thermoclineNormalized))
+                sensor.thermoclineNormalized = -1.f;
+            if (!(words >> sensor.deepSpeedBoost))
+                sensor.deepSpeedBoost = -1.f;
+            sensor.sweepSpeedDegreesPerSecond = std::clamp(sensor.sweepSpeedDegreesPerSecond, 10.f, 360.f);
+            if ((int)scenario.sensors.size() + 1 >= maximumSensorCount)
+                fail("at most " + std::to_string(maximumSensorCount - 1) + " sensors");
+            scenario.sensors.push_back(sensor);
+        } else if (keyword == "random") {
+            if (!(words >> scenario.randomTargetCount) || scenario.randomTargetCount < 1)
+                fail("random needs a target count of at least 1");
+        } else {
+            fail("unknown keyword " + keyword);
+        }
+    }
+    return scenario;
+}
+
+// resets the simulation to the scenario's starting point, random targets take the first ids then the scheduled ones follow in spawn order
+void applyScenario(SonarState& sonarState, const Scenario& scenario)
+{
+    sonarState = SonarState {};
+    sonarState.seed = scenario.seed;
+    sonarState.sweepSpeedDegreesPerSecond = scenario.sweepSpeedDegreesPerSecond;
+    sonarState.activeMode = scenario.activeMode;
+    sonarState.multiBeamCount = scenario.multiBeamCount;
+    sonarState.thermoclineNormalized = scenario.thermoclineNormalized;
+    sonarState.deepSpeedBoost = scenario.deepSpeedBoost;
+    sonarState.passiveArray.geometry = scenario.arrayGeometry;
+    sonarState.environment = scenario.environment;
+    generateClutter(sonarState.clutter, scenario.seed, scenario.seabedScattererCount, scenario.biologicScattererCount);
+    // sensors take ids 1, 2... in file order, each with its own random stream, unset water means ours
+    for (const Sensor& spawn : scenario.sensors) {
+        Sensor& sensor = sonarState.sensors.emplace_back(spawn);
+        sensor.id = (int)sonarState.sensors.size();
+        std::seed_seq sequence { scenario.seed, 0x5E45u, (uint32_t)sensor.id };
+        sensor.random.seed(sequence);
+        if (sensor.thermoclineNormalized < 0.f)
+            sensor.thermoclineNormalized = scenario.thermoclineNormalized;
+        if (sensor.deepSpeedBoost < 0.f)
+            sensor.deepSpeedBoost = scenario.deepSpeedBoost;
+        sensor.thermoclineNormalized = std::clamp(sensor.thermoclineNormalized, 0.05f, 0.95f);
+        sensor.deepSpeedBoost = std::clamp(sensor.deepSpeedBoost, 0.f, 1.f);
+    }
+    for (int targetId = 0; targetId < scenario.randomTargetCount; ++targetId)
+        sonarState.targets.push_back(makeTarget(targetId, scenario.seed));
+    sonarState.targetCount = sonarState.requestedTargetCount = (int)sonarState.targets.size();
+    // stable sort so two spawns at the same second keep their file order, then reversed so the earliest sits at the back
+    sonarState.pendingSpawns = scenario.spawns;
+    std::stable_sort(sonarState.pendingSpawns.begin(), sonarState.pendingSpawns.end(),
+        [](const TargetSpawn& first, const TargetSpawn& second) { return first.spawnSeconds < second.spawnSeconds; });
+    std::reverse(sonarState.pendingSpawns.begin(), sonarState.pendingSpawns.end());
+    // same for our ship's orders, except the ones at the start: the ship is already on that course and at that speed when the run begins
+    sonarState.pendingOrders = scenario.ownshipOrders;
+    std::stable_sort(sonarState.pendingOrders.begin(), sonarState.pendingOrders.end(),
+        [](const OwnshipOrder& first, const OwnshipOrder& second) { return first.orderSeconds < second.orderSeconds; });
+    Ownship& ownship = sonarState.ownship;
+    for (const OwnshipOrder& order : sonarState.pendingOrders)
+        if (order.orderSeconds <= 0.0) {
+            ownship.headingDegrees = ownship.orderedCourseDegrees = order.courseDegrees;
+            ownship.speed = ownship.orderedSpeed = order.speed;
+        }
+    std::erase_if(sonarState.pendingOrders, [](const OwnshipOrder& order) { return order.orderSeconds <= 0.0; });
+    std::reverse(sonarState.pendingOrders.begin(), sonarState.pendingOrders.end());
+    sonarState.requestedCourseDegrees = ownship.orderedCourseDegrees;
+    sonarState.requestedSpeed = ownship.orderedSpeed;
+}
+
+#pragma region headless
+// runs the scenario with no window as fast as the CPU allows, same fixed tick as the live simulation so the run is identical to
+// what you'd see on screen with the same seed, every detection is appended to a CSV (one short line each, buffered by the stream),
+// bearing and range are from where the sensor was (our ship moves), so its position at that instant is on the line too
+// time_s,target,mode,bearing_deg,range_km,strength,sensor,sensor_east_km,sensor_north_km
+// 12.345,3,A,271.50,48.21,0.312,0,4.20,-1.75
+void runHeadless(const Scenario& scenario, const std::string& logPath)
+{
+    std::ofstream log(logPath);
+    if (!log.is_open())
+        throw std::runtime_error("Cannot write: " + logPath);
+    log << "time_s,target,mode,bearing_deg,range_km,strength,sensor,sensor_east_km,sensor_north_km\n";
+
+    SonarState sonarState;
+    applyScenario(sonarState, scenario);
+
+    const auto wallStart = std::chrono::steady_clock::now();
+    const long long tickCount = std::llround(scenario.durationSeconds / simulationTickSeconds);
+    long long detectionCount = 0;
+    char line[128];
+    for (long long tickId = 0; tickId < tickCount; ++tickId) {
+        updateSonar(sonarState, (float)simulationTickSeconds);
+        for (const Detection& detection : sonarState.detections) {
+            int length = std::snprintf(line, sizeof(line), "%.3f,%d,%c,%.2f,%.2f,%.3f,%d,%.2f,%.2f\n", detection.timeSeconds, detection.targetId,
+                detection.active ? 'A' : 'P', detection.bearingDegrees, detection.rangeKilometers, detection.signalStrength, detection.sensorId,
+                detection.sensorXKilometers, detection.sensorYKilometers);
+            log.write(line, length);
+        }
+        detectionCount += (long long)sonarState.detections.size();
+    }
+
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    std::printf("simulated %.0f s in %.2f s (%.0fx real time), %lld detections of %d targets -> %s\n", scenario.durationSeconds, wallSeconds,
+        scenario.durationSeconds / std::max(wallSeconds, 1e-9), detectionCount, (int)sonarState.targets.size(), logPath.c_str());
+}
@@ -0,0 +1,164 @@
+#include "ppi.hpp"
+
+#pragma region sensor utils
+// a remote sensor doesn't synthesize any signal, it applies the sonar equation to its own ray-traced field:
+// signal excess = figure of merit - transmission loss + fluctuation, a contact is detected when the excess is positive,
+// the figure of merit (FOM) is the largest loss at which the sensor still detects half the time, it folds source level, noise,
+// array gain and detection threshold into one number, the fluctuation (fading, multipath, a wobbling source) makes contacts
+// near the limit come and go instead of switching cleanly on and off at one range
+// ex: passive FOM 32 dB, target 50 km away in the default water loses ~29 dB -> excess +3 dB -> heard most frames
+constexpr double sensorBatchSeconds = 0.05; // active sweeps are processed in batches like our own pings
+constexpr double passiveFrameSeconds = 0.25; // how often a passive sensor reports the bearings it hears
+constexpr float activeFigureOfMeritDecibels = 62.f; // two-way loss, ~50 km in the default water
+constexpr float passiveFigureOfMeritDecibels = 32.f; // one-way loss, ~55 km
+constexpr float fluctuationDecibels = 3.f;
+constexpr float passiveBearingSigmaDegrees = 0.5f;
+constexpr float activeBearingSigmaDegrees = 0.29f * ActiveProcessor::beamWidthDegrees; // same 2° beam as ours
+constexpr float activeRangeSigmaKilometers = 0.05f;
+
+// roughly gaussian with unit σ: the sum of 3 uniforms has variance 3/12 = 1/4 so doubling it gives σ = 1,
+// the tails stop at 3σ which is all a fading model needs
+static float randomGaussian(std::minstd_rand& random)
+{
+    return 2.f * (randomUnit(random) + randomUnit(random) + randomUnit(random) - 1.5f);
+}
+
+// one batch of one sensor, runs on a worker thread so it only writes to its own sensor, the targets are read only,
+// active: advances the sensor's own sweep and reports every target the arm crossed that beats the two-way loss,
+// with the measurement noise of a 2° beam and a 50 m range cell,
+// passive: once per frame lists the bearing of every target it hears (one-way loss), no sweep, a passive array hears all around at once,
+// either way the targets in play are collected first and their losses (down to each one's depth) looked up in one batch,
+// in a gridded environment from the sensor's own sector fields, already traced by updateSensors before the fan-out
+// (the sensor owns its sectors so no other thread touches them)
+static void runSensor(Sensor& sensor, const OceanEnvironment* environment, const std::vector<Target>& targets, double now, float batchSeconds)
+{
+    TargetPaths& paths = sensor.paths;
+    clearTargetPaths(paths);
+    sensor.detections.clear();
+    if (sensor.activeMode) {
+        sensor.previousSweepDegrees = sensor.sweepAngleDegrees;
+        sensor.sweepAngleDegrees = std::fmod(sensor.sweepAngleDegrees + sensor.sweepSpeedDegreesPerSecond * batchSeconds, 360.f);
+        double minimumInterval = 360.0 / sensor.sweepSpeedDegreesPerSecond * 0.85;
+        sensor.lastDetectionSeconds.resize(targets.size(), -999.0);
+        for (int targetIndex = 0; targetIndex < (int)targets.size(); ++targetIndex) {
+            if (now - sensor.lastDetectionSeconds[targetIndex] < minimumInterval)
+                continue;
+            const Target& target = targets[targetIndex];
+            float eastKilometers = target.xKilometers - sensor.xKilometers, northKilometers = target.yKilometers - sensor.yKilometers;
+            float rangeKilometers = std::hypot(eastKilometers, northKilometers);
+            if (rangeKilometers < 0.5f || rangeKilometers > maximumRangeKilometers)
+                continue;
+            float bearing = std::fmod(std::atan2(eastKilometers, northKilometers) * RAD2DEG + 360.f, 360.f);
+            if (!bearingInArc(bearing, sensor.previousSweepDegrees, sensor.sweepAngleDegrees))
+                continue;
+            sensor.lastDetectionSeconds[targetIndex] = now;
+            addTargetPath(paths, targetIndex, rangeKilometers, bearing, target.depthNormalized);
+        }
+        computePathLoss(paths, sensor.transmissionLoss.get(), environment, sensor.sectors, sensor.xKilometers, sensor.yKilometers);
+        for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+            float excess = activeFigureOfMeritDecibels - 2.f * paths.lossDecibels[pathId] + fluctuationDecibels * randomGaussian(sensor.random);
+            if (excess <= 0.f)
+                continue;
+            float measuredBearing = std::fmod(paths.bearingDegrees[pathId] + activeBearingSigmaDegrees * randomGaussian(sensor.random) + 360.f, 360.f);
+            float measuredRange = paths.rangeKilometers[pathId] + activeRangeSigmaKilometers * randomGaussian(sensor.random);
+            sensor.detections.push_back({ now, targets[paths.targetIndices[pathId]].id, true, measuredBearing, measuredRange,
+                std::clamp(excess / 30.f, 0.f, 1.f), sensor.id, sensor.xKilometers, sensor.yKilometers });
+        }
+    } else if (now >= sensor.nextFrameSeconds) {
+        sensor.nextFrameSeconds = now + passiveFrameSeconds;
+        sensor.bearings.clear();
+        for (int targetIndex = 0; targetIndex < (int)targets.size(); ++targetIndex) {
+            const Target& target = targets[targetIndex];
+            float eastKilometers = target.xKilometers - sensor.xKilometers, northKilometers = target.yKilometers - sensor.yKilometers;
+            float rangeKilometers = std::hypot(eastKilometers, northKilometers);
+            if (rangeKilometers >= 0.5f && rangeKilometers <= maximumRangeKilometers)
+                addTargetPath(paths, targetIndex, rangeKilometers, std::atan2(eastKilometers, northKilometers) * RAD2DEG, target.depthNormalized);
+        }
+        computePathLoss(paths, sensor.transmissionLoss.get(), environment, sensor.sectors, sensor.xKilometers, sensor.yKilometers);
+        for (int pathId = 0; pathId < (int)paths.targetIndices.size(); ++pathId) {
+            float excess = passiveFigureOfMeritDecibels - paths.lossDecibels[pathId] + fluctuationDecibels * randomGaussian(sensor.random);
+            if (excess <= 0.f)
+                continue;
+            float bearing = paths.bearingDegrees[pathId] + passiveBearingSigmaDegrees * randomGaussian(sensor.random);
+            sensor.bearings.push_back(std::fmod(bearing + 360.f, 360.f));
+        }
+    }
+}
+
+#pragma region sensors
+// every sensorBatchSeconds runs every remote sensor for the time since the last batch, split across threads (sensors are independent,
+// each draws from its own random stream so the thread count never changes a run), then in sensor order their active contacts
+// become blips and detections on the shared plot, where the tracker fuses them with ours,
+// slider fields are fetched from the shared cache here on the simulation thread, the cache itself is not thread safe,
+// gridded sector fields toward every target in a sensor's range are traced here too so no worker ever starts threads of its own:
+// the rays of a lone missing field go across the cores, several missing fields (a scenario's first batch) go one per core
+void updateSensors(SonarState& sonarState)
+{
+    if (sonarState.sensors.empty() || sonarState.elapsedSeconds - sonarState.lastSensorBatchSeconds < sensorBatchSeconds)
+        return;
+    const float batchSeconds = (float)(sonarState.elapsedSeconds - sonarState.lastSensorBatchSeconds);
+    sonarState.lastSensorBatchSeconds = sonarState.elapsedSeconds;
+    const OceanEnvironment* environment = sonarState.environment.get();
+    for (Sensor& sensor : sonarState.sensors) {
+        sensor.sectors.ownerId = sensor.id;
+        if (!sensor.transmissionLoss && !environment)
+            sensor.transmissionLoss = cachedTransmissionLoss(sonarState, sensor.thermoclineNormalized, sensor.deepSpeedBoost);
+    }
+
+    const int sensorCount = (int)sonarState.sensors.size();
+    const int coreCount = (int)std::max(1u, std::thread::hardware_concurrency());
+    if (environment) {
+        std::vector<std::pair<int, int>> traces; // sensor index, sector
+        std::vector<float> bearings;
+        std::vector<int> sectorIds;
+        for (int sensorIndex = 0; sensorIndex < sensorCount; ++sensorIndex) {
+            Sensor& sensor = sonarState.sensors[sensorIndex];
+            bearings.clear();
+            for (const Target& target : sonarState.targets) {
+                float eastKilometers = target.xKilometers - sensor.xKilometers, northKilometers = target.yKilometers - sensor.yKilometers;
+                float rangeKilometers = std::hypot(eastKilometers, northKilometers);
+                if (rangeKilometers >= 0.5f && rangeKilometers <= maximumRangeKilometers)
+                    bearings.push_back(std::atan2(eastKilometers, northKilometers) * RAD2DEG);
+            }
+            findUntracedSectors(sensor.sectors, *environment, sensor.xKilometers, sensor.yKilometers, bearings, sectorIds);
+            for (int sectorId : sectorIds)
+                traces.emplace_back(sensorIndex, sectorId);
+        }
+        const int traceThreadCount = std::min((int)traces.size(), coreCount);
+        if (traces.size() == 1) {
+            traceSector(sonarState.sensors[traces[0].first].sectors, traces[0].second, coreCount);
+        } else if (traceThreadCount > 0) {
+            std::vector<std::thread> workers;
+            for (int threadId = 0; threadId < traceThreadCount; ++threadId)
+                workers.emplace_back([&, threadId] {
+                    for (int traceId = threadId; traceId < (int)traces.size(); traceId += traceThreadCount)
+                        traceSector(sonarState.sensors[traces[traceId].first].sectors, traces[traceId].second, 1);
+                });
+            for (auto& worker : workers)
+                worker.join();
+        }
+    }
+
+    const int threadCount = std::min(sensorCount, coreCount);
+    if (threadCount == 1) {
+        for (Sensor& sensor : sonarState.sensors)
+            runSensor(sensor, environment, sonarState.targets, sonarState.elapsedSeconds, batchSeconds);
+    } else {
+        std::vector<std::thread> workers;
+        for (int threadId = 0; threadId < threadCount; ++threadId)
+            workers.emplace_back([&, threadId] {
+                for (int sensorIndex = threadId; sensorIndex < sensorCount; sensorIndex += threadCount)
+                    runSensor(sonarState.sensors[sensorIndex], environment, sonarState.targets, sonarState.elapsedSeconds, batchSeconds);
+            });
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    for (const Sensor& sensor : sonarState.sensors)
+        for (const Detection& detection : sensor.detections) {
+            float xKilometers = sensor.xKilometers + std::sin(detection.bearingDegrees * DEG2RAD) * detection.rangeKilometers;
+            float yKilometers = sensor.yKilometers + std::cos(detection.bearingDegrees * DEG2RAD) * detection.rangeKilometers;
+            sonarState.blips.push_back({ xKilometers, yKilometers, 1.0f, targetColors[detection.targetId % 10] });
+            sonarState.detections.push_back(detection);
+        }
+}
@@ -0,0 +1,379 @@
+#include "ppi.hpp"
+
+#pragma region update utils
+// checks whether a target's bearing falls inside the "slice of pie" the sweep arm just rotated through,
+// we need this because at a 1 kHz tick the arm moves only a tiny arc per tick, but we still need to detect
+// every target the arm passes over, so instead of checking one exact angle we check an arc,
+// all three angles are normalised into [0°, 360°) first to handle wrap-around (ex: 365° -> 5°),
+// then we measure the clockwise arc length from arcStart to arcEnd, and check whether the clockwise distance from arcStart to bearing fits inside that arc
+// ex: arcStart=355°, arcEnd=5°, bearing=2° -> arcLength=10°, offsetToBearing=7° -> 7<=10 -> true (inside)
+bool bearingInArc(float bearing, float arcStart, float arcEnd)
+{
+    bearing = std::fmod(bearing + 360.f, 360.f);
+    arcStart = std::fmod(arcStart + 360.f, 360.f);
+    arcEnd = std::fmod(arcEnd + 360.f, 360.f);
+    float arcLength = std::fmod(arcEnd - arcStart + 360.f, 360.f);
+    float offsetToBearing = std::fmod(bearing - arcStart + 360.f, 360.f);
+    return offsetToBearing <= arcLength;
+}
+
+// uniform float in [0, 1) straight from the generator's raw output, std::uniform_real_distribution is implementation-defined
+// so the same seed could give a different run on another compiler, this can't
+float randomUnit(std::minstd_rand& random)
+{
+    return (float)((random() - std::minstd_rand::min()) / (std::minstd_rand::max() - std::minstd_rand::min() + 1.0));
+}
+
+// fastest a target dives or climbs, 0.004 of the water column per second = 4 m/s, scaled by the sweep speed like its motion
+static constexpr float maximumDepthRatePerSecond = 0.004f;
+// depth band targets stay in, a submarine neither surfaces nor sits on the bottom
+static constexpr float shallowestDepthNormalized = 0.05f, deepestDepthNormalized = 0.95f;
+
+// spawns a target at a random position and heading somewhere in the operational area,
+// each target draws from its own stream seeded by (run seed, target id), so target 3 is the same target whether 2 or 200
+// others were spawned around it, and the whole run replays identically from its seed
+Target makeTarget(int id, uint32_t seed)
+{
+    Target target;
+    target.id = id;
+    target.colorId = id % 10;
+    std::seed_seq sequence { seed, (uint32_t)id };
+    target.random.seed(sequence);
+    float angle = randomUnit(target.random) * 2.f * (float)M_PI; // 0 to 2pi, random spawn direction
+    float distance = 15.f + randomUnit(target.random) * 70.f; // 15 to 85 km from center
+    float speed = 1.2f + randomUnit(target.random) * 3.2f; // 1.2 to 4.4 km/s
+    float course = randomUnit(target.random) * 2.f * (float)M_PI; // random initial heading
+    target.xKilometers = std::sin(angle) * distance; // initial position
+    target.yKilometers = std::cos(angle) * distance;
+    target.velocityX = std::sin(course) * speed; // initial velocity
+    target.velocityY = std::cos(course) * speed;
+    // drawn last so positions and courses stay what they were before targets had a depth
+    target.depthNormalized = 0.1f + randomUnit(target.random) * 0.8f; // 100 to 900 m
+    target.depthRatePerSecond = (randomUnit(target.random) * 2.f - 1.f) * maximumDepthRatePerSecond;
+    return target;
+}
+
+// adjusts the live target list to match the desired count without rebuilding everything,
+// new targets take the next id so removing then re-adding one brings back the very same target, placed around wherever our ship is now
+void setTargetCount(SonarState& sonarState, int count)
+{
+    count = std::max(count, 1);
+    while ((int)sonarState.targets.size() < count) {
+        Target& target = sonarState.targets.emplace_back(makeTarget(sonarState.targets.empty() ? 0 : sonarState.targets.back().id + 1, sonarState.seed));
+        target.xKilometers += sonarState.ownship.xKilometers;
+        target.yKilometers += sonarState.ownship.yKilometers;
+    }
+    while ((int)sonarState.targets.size() > count)
+        sonarState.targets.pop_back();
+    sonarState.targetCount = count;
+}
+
+// how fast our ship comes round, 6°/s, and changes speed, 0.2 km/s per second, both scaled by the sweep speed like everything that moves
+static constexpr float ownshipTurnRateDegreesPerSecond = 6.f;
+static constexpr float ownshipAcceleration = 0.2f;
+
+// every target relative to our ship in one pass over the list, the subtraction is a straight-line SoA loop the compiler vectorizes,
+// the range goes 8 targets per instruction by hand (std::sqrt keeps its errno branch without -fno-math-errno, which stops the
+// compiler from vectorizing it), the bearing is an atan2 per target on top, done here once instead of by every stage that needs it,
+// the bearing is the reverse of the renderer's bearingToDirection: atan2(east, north) gives the clockwise-from-north angle
+// (east first then north is deliberate, standard atan2 is from-east, we want from-north so we swap), +360 then fmod(360) keeps it in [0°, 360°)
+// ex: our ship at (10, 0), a target at (10, 5) -> east 0, north 5, range 5 km, bearing 0°,  a target at (10, -1) -> bearing 180°
+// worked out on the first call of a tick only, the rotating sweep pings in batches so most ticks nobody asks
+const OwnshipFrame& transformToOwnship(SonarState& sonarState)
+{
+    OwnshipFrame& frame = sonarState.ownshipFrame;
+    if (frame.tickSeconds == sonarState.elapsedSeconds && frame.rangeKilometers.size() == sonarState.targets.size())
+        return frame;
+    frame.tickSeconds = sonarState.elapsedSeconds;
+    const int targetCount = (int)sonarState.targets.size();
+    frame.eastKilometers.resize(targetCount);
+    frame.northKilometers.resize(targetCount);
+    frame.rangeKilometers.resize(targetCount);
+    frame.bearingDegrees.resize(targetCount);
+    const float ownshipX = sonarState.ownship.xKilometers, ownshipY = sonarState.ownship.yKilometers;
+    for (int targetIndex = 0; targetIndex < targetCount; ++targetIndex) {
+        frame.eastKilometers[targetIndex] = sonarState.targets[targetIndex].xKilometers - ownshipX;
+        frame.northKilometers[targetIndex] = sonarState.targets[targetIndex].yKilometers - ownshipY;
+    }
+    float* __restrict east = frame.eastKilometers.data();
+    float* __restrict north = frame.northKilometers.data();
+    float* __restrict range = frame.rangeKilometers.data();
+    int targetIndex = 0;
+#ifdef __AVX2__
+    for (; targetIndex + 8 <= targetCount; targetIndex += 8) {
+        __m256 eastLanes = _mm256_loadu_ps(east + targetIndex), northLanes = _mm256_loadu_ps(north + targetIndex);
+        _mm256_storeu_ps(range + targetIndex, _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(eastLanes, eastLanes), _mm256_mul_ps(northLanes, northLanes))));
+    }
+#endif
+    for (; targetIndex < targetCount; ++targetIndex)
+        range[targetIndex] = std::sqrt(east[targetIndex] * east[targetIndex] + north[targetIndex] * north[targetIndex]);
+    for (targetIndex = 0; targetIndex < targetCount; ++targetIndex)
+        frame.bearingDegrees[targetIndex] = std::fmod(std::atan2(east[targetIndex], north[targetIndex]) * RAD2DEG + 360.f, 360.f);
+    return frame;
+}
+
+#pragma region updates
+// gives the scenario's orders whose time has come, then turns our ship toward the ordered course the short way round
+// (ex: heading 350°, ordered 20° -> turns right through north, 30° to go) and moves it along its heading,
+// the bow swings at most ownshipTurnRate per second so a big course change is a visible arc, not a jump
+static void updateOwnship(SonarState& sonarState, float deltaTime)
+{
+    Ownship& ownship = sonarState.ownship;
+    while (!sonarState.pendingOrders.empty() && sonarState.pendingOrders.back().orderSeconds <= sonarState.elapsedSeconds) {
+        ownship.orderedCourseDegrees = sonarState.pendingOrders.back().courseDegrees;
+        ownship.orderedSpeed = sonarState.pendingOrders.back().speed;
+        sonarState.pendingOrders.pop_back();
+    }
+
+    float speedScale = sonarState.sweepSpeedDegreesPerSecond / 90.f; // same scale as the targets (see updateTargets)
+    float turn = std::fmod(ownship.orderedCourseDegrees - ownship.headingDegrees + 540.f, 360.f) - 180.f; // -180 to 180, + = turn right
+    float maximumTurn = ownshipTurnRateDegreesPerSecond * speedScale * deltaTime;
+    ownship.headingDegrees = std::fmod(ownship.headingDegrees + std::clamp(turn, -maximumTurn, maximumTurn) + 360.f, 360.f);
+    float maximumSpeedChange = ownshipAcceleration * speedScale * deltaTime;
+    ownship.speed += std::clamp(ownship.orderedSpeed - ownship.speed, -maximumSpeedChange, maximumSpeedChange);
+    ownship.xKilometers += std::sin(ownship.headingDegrees * DEG2RAD) * ownship.speed * speedScale * deltaTime;
+    ownship.yKilometers += std::cos(ownship.headingDegrees * DEG2RAD) * ownship.speed * speedScale * deltaTime;
+}
+
+// moves every target forward by one time step using dead-reckoning (position += velocity * time),
+// "dead reckoning" is the nautical term for estimating current position based on last known position plus speed and heading
+// speedScale ties target movement to the sweep speed so faster sweeps feel like a more active simulation,
+// if a target drifts past 88% of the maximum range from our ship it is near the edge of the display,
+// so we redirect its heading back toward center with up to 30° of random wobble to keep contacts visible,
+// depth moves the same way and turns around at the top and bottom of the band targets keep to
+// scenario targets whose spawn time has come are created first, with the course and speed the scenario gave them
+static void updateTargets(SonarState& sonarState, float deltaTime)
+{
+    while (!sonarState.pendingSpawns.empty() && sonarState.pendingSpawns.back().spawnSeconds <= sonarState.elapsedSeconds) {
+        const TargetSpawn& spawn = sonarState.pendingSpawns.back();
+        Target target = makeTarget(sonarState.targets.empty() ? 0 : sonarState.targets.back().id + 1, sonarState.seed);
+        target.xKilometers = spawn.xKilometers;
+        target.yKilometers = spawn.yKilometers;
+        target.velocityX = std::sin(spawn.courseDegrees * DEG2RAD) * spawn.speed;
+        target.velocityY = std::cos(spawn.courseDegrees * DEG2RAD) * spawn.speed;
+        if (spawn.depthNormalized >= 0.f) {
+            target.depthNormalized = spawn.depthNormalized;
+            target.depthRatePerSecond = spawn.depthRatePerSecond;
+        }
+        sonarState.targets.push_back(target);
+        sonarState.targetCount = (int)sonarState.targets.size();
+        sonarState.pendingSpawns.pop_back();
+    }
+
+    float speedScale = sonarState.sweepSpeedDegreesPerSecond / 90.f; // 1.0 at default 90 dps
+    for (auto& target : sonarState.targets) {
+        target.xKilometers += target.velocityX * speedScale * deltaTime;
+        target.yKilometers += target.velocityY * speedScale * deltaTime;
+        target.depthNormalized += target.depthRatePerSecond * speedScale * deltaTime;
+        if ((target.depthNormalized < shallowestDepthNormalized && target.depthRatePerSecond < 0.f)
+            || (target.depthNormalized > deepestDepthNormalized && target.depthRatePerSecond > 0.f))
+            target.depthRatePerSecond = -target.depthRatePerSecond;
+        float eastKilometers = target.xKilometers - sonarState.ownship.xKilometers, northKilometers = target.yKilometers - sonarState.ownship.yKilometers;
+        float distance = std::hypot(eastKilometers, northKilometers); // straight-line dist from our ship
+        if (distance > maximumRangeKilometers * 0.88f) {
+            // atan2 of the negated offset gives the inward-pointing bearing (back toward our ship),
+            // then add up to 30 degrees of random wobble so targets don't all funnel to the same spot
+            float angle = std::atan2(-eastKilometers, -northKilometers) + (randomUnit(target.random) * 60.f - 30.f) * DEG2RAD;
+            float speed = std::hypot(target.velocityX, target.velocityY); // preserve the target's current speed
+            target.velocityX = std::sin(angle) * speed;
+            target.velocityY = std::cos(angle) * speed;
+        }
+    }
+}
+
+// passive mode only (active contacts come out of the ping processing, see echo.cpp), for each target checks whether the sweep arm
+// just crossed its bearing, if so reports it when the array's beam at that bearing heard it (see beamforming.cpp),
+// detection only registers if the arm's arc this tick covered that bearing + enough time has passed since the last detection on this target
+// (prevents re-firing every tick)
+static void updateDetections(SonarState& sonarState)
+{
+    if (sonarState.activeMode)
+        return;
+
+    // one full revolution takes 360/sweepSpeed seconds, require 85% of that before re-detecting the same target
+    // this mimics real PPI behavior where a contact appears once per sweep, not continuously on every tick
+    double revolutionSeconds = 360.0 / sonarState.sweepSpeedDegreesPerSecond;
+    double minimumInterval = revolutionSeconds * 0.85;
+
+    const OwnshipFrame& frame = transformToOwnship(sonarState);
+    for (int targetIndex = 0; targetIndex < (int)sonarState.targets.size(); ++targetIndex) {
+        Target& target = sonarState.targets[targetIndex];
+        // cheapest test first, right after a detection a target is skipped for most of the revolution
+        if (sonarState.elapsedSeconds - target.lastDetectionTime < minimumInterval)
+            continue; // too soon since the last ping on this target
+        float rangeKilometers = frame.rangeKilometers[targetIndex];
+        // too close (inside own-ship noise floor) or too far (off the display)
+        if (rangeKilometers < 0.5f || rangeKilometers > maximumRangeKilometers)
+            continue;
+        // compass bearing from our ship, atan2(east, north) worked out with the rest of the frame (see transformToOwnship)
+        float bearing = frame.bearingDegrees[targetIndex];
+
+        if (!bearingInArc(bearing, sonarState.previousSweepDegrees, sonarState.sweepAngleDegrees))
+            continue;
+        target.lastDetectionTime = sonarState.elapsedSeconds;
+
+        // the bins themselves are lit by the beamformer, here the sweep only reports what the beam at that bearing heard
+        float signalStrength = passiveBeamStrength(sonarState.passiveArray, bearing);
+        if (signalStrength <= 0.f)
+            continue;
+        sonarState.detections.push_back({ sonarState.elapsedSeconds, target.id, false, bearing, 0.f, signalStrength, 0, sonarState.ownship.xKilometers,
+            sonarState.ownship.yKilometers });
+    }
+}
+
+// picks up the propagation field for the current sliders, advances the sweep arm angle, fades out old blips and passive bins,
+// then moves our ship and the targets, runs our sonar and the remote sensors, triangulates passive bearings and feeds every detection to the tracker,
+// fade rate is proportional to sweep speed: faster sweep -> contacts fade faster, keeping the display
+// consistent regardless of rotation speed (a full revolution always clears the previous contacts),
+// the erase-remove_if pattern is the standard C++ idiom for deleting items from a vector in one pass
+// mark the ones to remove (alpha < 0.01), shift everything else forward, then truncate the tail,
+// fading runs at display granularity (every fadeIntervalSeconds of accumulated time) rather than every 1 ms tick,
+// the eye can't tell and it's most of a tick's cost otherwise (720 bins + every blip)
+void updateSonar(SonarState& sonarState, float deltaTime)
+{
+    refreshTransmissionLoss(sonarState); // only traces when the thermocline/boost sliders landed on a setting never seen before
+    sonarState.detections.clear();
+    sonarState.elapsedSeconds += deltaTime;
+    sonarState.previousSweepDegrees = sonarState.sweepAngleDegrees;
+    sonarState.sweepAngleDegrees = std::fmod(sonarState.sweepAngleDegrees + sonarState.sweepSpeedDegreesPerSecond * deltaTime, 360.f);
+
+    // at 90 dps: fadeRate = 0.25/s -> a blip at alpha 1.0 fully disappears after 4 seconds (one revolution),
+    // so the natural "sweep lifetime" of a contact exactly matches one full rotation
+    float fadeRate = sonarState.sweepSpeedDegreesPerSecond / 360.f;
+    constexpr float fadeIntervalSeconds = 1.f / 120.f;
+    sonarState.pendingFadeSeconds += deltaTime;
+    if (sonarState.pendingFadeSeconds >= fadeIntervalSeconds) {
+        float fade = fadeRate * sonarState.pendingFadeSeconds;
+        sonarState.pendingFadeSeconds = 0.f;
+        for (auto& blip : sonarState.blips)
+            blip.alpha = std::max(0.f, blip.alpha - fade);
+        sonarState.blips.erase(
+            std::remove_if(sonarState.blips.begin(), sonarState.blips.end(), [](const Blip& blip) { return blip.alpha < 0.01f; }), sonarState.blips.end());
+
+        for (int binId = 0; binId < passiveBinCount; ++binId) {
+            PassiveBin& passiveBin = sonarState.passiveBins[binId];
+            passiveBin.alpha = std::max(0.f, passiveBin.alpha - fade);
+            if (passiveBin.alpha > sonarState.waterfallAccumulator[binId].alpha)
+                sonarState.waterfallAccumulator[binId] = passiveBin; // brightest this bin got during the revolution
+        }
+    }
+
+    // the arm wrapped past north: the revolution is done, its row goes to the waterfall (colors darkened by brightness) and a fresh one starts
+    if (sonarState.sweepAngleDegrees < sonarState.previousSweepDegrees) {
+        for (int binId = 0; binId < passiveBinCount; ++binId) {
+            const PassiveBin& brightest = sonarState.waterfallAccumulator[binId];
+            sonarState.waterfallRow[binId] = { (unsigned char)(brightest.color.r * brightest.alpha), (unsigned char)(brightest.color.g * brightest.alpha),
+                (unsigned char)(brightest.color.b * brightest.alpha), 255 };
+        }
+        sonarState.waterfallAccumulator.fill({});
+        ++sonarState.waterfallRowCount;
+    }
+
+    updateOwnship(sonarState, deltaTime);
+    updateTargets(sonarState, deltaTime);
+    updatePassiveArray(sonarState);
+    updateActivePings(sonarState);
+    updateSensors(sonarState);
+    updateDetections(sonarState);
+    updateFusion(sonarState);
+    updateTracker(sonarState);
+}
+
+#pragma region thread
+// copies what the renderer needs into the free slot and hands it over, the copy is small (a few targets, blips and 720 bins)
+// so doing it every tick is cheaper than any kind of locking would be
+void publishSnapshot(const SonarState& sonarState, SnapshotBuffer<SonarSnapshot>& snapshots)
+{
+    SonarSnapshot& snapshot = snapshots.write();
+    snapshot.elapsedSeconds = sonarState.elapsedSeconds;
+    snapshot.sweepAngleDegrees = sonarState.sweepAngleDegrees;
+    snapshot.activeMode = sonarState.activeMode;
+    snapshot.multiBeamCount = sonarState.multiBeamCount;
+    snapshot.thermoclineNormalized = sonarState.thermoclineNormalized;
+    snapshot.deepSpeedBoost = sonarState.deepSpeedBoost;
+    // in a gridded environment the panel shows the field the sweep arm looks along, once it's been traced
+    snapshot.transmissionLoss = sonarState.transmissionLoss;
+    snapshot.environment = sonarState.environment;
+    snapshot.ownship = sonarState.ownship;
+    if (sonarState.environment) {
+        const SectorFields& sectors = sonarState.transmissionLossSectors;
+        int sectorId = std::clamp((int)(sonarState.sweepAngleDegrees / (360.f / sectorCount)), 0, sectorCount - 1);
+        if (sectors.fields[sectorId])
+            snapshot.transmissionLoss = sectors.fields[sectorId];
+    }
+    snapshot.targets = sonarState.targets; // vector assignment reuses the slot's capacity, no allocation once warmed up
+    snapshot.blips = sonarState.blips;
+    snapshot.passiveBins = sonarState.passiveBins;
+    snapshot.waterfallRow = sonarState.waterfallRow;
+    snapshot.waterfallRowCount = sonarState.waterfallRowCount;
+    snapshot.sensors.clear();
+    for (const Sensor& sensor : sonarState.sensors)
+        snapshot.sensors.push_back({ sensor.xKilometers, sensor.yKilometers, sensor.sweepAngleDegrees, sensor.activeMode });
+    snapshot.bearings = sonarState.fusion.bearings;
+    snapshot.fixes = sonarState.fusion.fixes;
+    // tracks are extrapolated to the snapshot time, they're only re-predicted once per association batch
+    snapshot.tracks.clear();
+    for (const Track& track : sonarState.tracker.tracks) {
+        float dt = (float)(sonarState.elapsedSeconds - track.stateSeconds);
+        snapshot.tracks.push_back({ track.state.x() + track.state.z() * dt, track.state.y() + track.state.w() * dt, track.state.z(), track.state.w(),
+            track.id, track.confirmed });
+    }
+    snapshots.publish();
+}
+
+// pulls the latest UI values into the simulation state, only ever called between two ticks so a tick always sees one consistent setting
+static void applyControls(SonarState& sonarState, const SonarControls& controls)
+{
+    sonarState.sweepSpeedDegreesPerSecond = controls.sweepSpeedDegreesPerSecond.load(std::memory_order_relaxed);
+    sonarState.activeMode = controls.activeMode.load(std::memory_order_relaxed);
+    sonarState.multiBeamCount = controls.multiBeamCount.load(std::memory_order_relaxed);
+    sonarState.thermoclineNormalized = controls.thermoclineNormalized.load(std::memory_order_relaxed);
+    sonarState.deepSpeedBoost = controls.deepSpeedBoost.load(std::memory_order_relaxed);
+    sonarState.passiveArray.geometry = controls.arrayGeometry.load(std::memory_order_relaxed);
+    // the toggle only generates or drops the field when it changed, a scenario's own clutter stays as it was laid out
+    bool clutterEnabled = controls.clutterEnabled.load(std::memory_order_relaxed);
+    if (clutterEnabled == sonarState.clutter.scatterers.empty())
+        generateClutter(sonarState.clutter, sonarState.seed, clutterEnabled ? ClutterField::defaultSeabedCount : 0,
+            clutterEnabled ? ClutterField::defaultBiologicCount : 0);
+    // same for the course and speed sliders, a scenario's orders keep the ship until the UI gives one of its own
+    float orderedCourse = controls.orderedCourseDegrees.load(std::memory_order_relaxed), orderedSpeed = controls.orderedSpeed.load(std::memory_order_relaxed);
+    if (orderedCourse != sonarState.requestedCourseDegrees || orderedSpeed != sonarState.requestedSpeed) {
+        sonarState.ownship.orderedCourseDegrees = orderedCourse;
+        sonarState.ownship.orderedSpeed = orderedSpeed;
+        sonarState.requestedCourseDegrees = orderedCourse;
+        sonarState.requestedSpeed = orderedSpeed;
+    }
+    // only react when the slider itself moved, scenario spawns grow the list on their own
+    int targetCount = controls.targetCount.load(std::memory_order_relaxed);
+    if (targetCount != sonarState.requestedTargetCount) {
+        setTargetCount(sonarState, targetCount);
+        sonarState.requestedTargetCount = targetCount;
+    }
+}
+
+// simulation thread body, advances the sonar by exactly simulationTickSeconds per step against a steady clock:
+// each wake-up it runs every tick that is due (usually one), publishes, then sleeps until the next one is due,
+// if it fell behind (OS hiccup, a new propagation field being traced) it catches up with fixed steps instead of one giant step,
+// but never more than maximumCatchUpTicks in a row, beyond that the missed time is dropped so it can't spiral out
+void runSonarSimulation(SonarState& sonarState, SonarControls& controls, SnapshotBuffer<SonarSnapshot>& snapshots)
+{
+    using Clock = std::chrono::steady_clock;
+    constexpr int maximumCatchUpTicks = 250; // 250 ms of simulated time
+    const auto tickDuration = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(simulationTickSeconds));
+    auto nextTick = Clock::now();
+
+    while (controls.running.load(std::memory_order_relaxed)) {
+        applyControls(sonarState, controls);
+        int ticksRun = 0;
+        while (Clock::now() >= nextTick && ticksRun < maximumCatchUpTicks) {
+            updateSonar(sonarState, (float)simulationTickSeconds);
+            nextTick += tickDuration;
+            ++ticksRun;
+        }
+        if (ticksRun == maximumCatchUpTicks)
+            nextTick = Clock::now();
+        if (ticksRun > 0)
+            publishSnapshot(sonarState, snapshots);
+        std::this_thread::sleep_until(nextTick);
+    }
+}
@@ -0,0 +1,213 @@
+#include "ppi.hpp"
+
+#pragma region tracker utils
+// a blip only says "something was here at that instant", a track strings successive blips of the same contact together
+// and estimates where it's heading, here with a constant-velocity Kalman filter per track:
+// predict -> move the state along its velocity and grow the covariance (the contact may have turned since),
+// update  -> pull the state toward the measurement, weighted by how much we trust each (covariance vs measurement noise)
+constexpr double trackerBatchSeconds = 0.05; // detections are associated in batches, the sweep covers 4.5° per batch at 90 dps
+// measurement noise of an active contact, it's placed at the center of its beam (2° for the sweep, 360°/N in multi-beam) and 50 m range cell,
+// uniform over a width w has σ = w/√12 ≈ 0.29·w, the range gets a bit more for the matched filter peak wandering a cell
+constexpr float rangeSigmaKilometers = 0.05f;
+constexpr float widestBearingSigmaRadians = 0.29f * (360.f / 64.f) * DEG2RAD; // 64 beams, the fewest multi-beam mode uses
+constexpr float accelerationNoise = 0.05f; // km²/s³, how much unmodelled acceleration (turns at the display edge) we allow
+constexpr float gateThreshold = 13.8f; // chi² with 2 degrees of freedom at 99.9%, beyond that the detection can't be this track's
+constexpr int confirmationHits = 3;
+constexpr float gridCellKilometers = 5.f;
+constexpr int gridSide = (int)(2.f * maximumRangeKilometers / gridCellKilometers); // 40x40 cells over ±100 km around our ship
+
+// moves a track's state to timeSeconds, F is the constant-velocity transition (position += velocity * dt),
+// Q is the discrete white-acceleration noise, the longer the gap the more the covariance grows
+static void predictTrack(Track& track, double timeSeconds)
+{
+    float dt = (float)(timeSeconds - track.stateSeconds);
+    if (dt <= 0.f)
+        return;
+    Eigen::Matrix4f transition = Eigen::Matrix4f::Identity();
+    transition(0, 2) = transition(1, 3) = dt;
+    float dt2 = dt * dt, dt3 = dt2 * dt;
+    Eigen::Matrix4f processNoise = Eigen::Matrix4f::Zero();
+    processNoise(0, 0) = processNoise(1, 1) = dt3 / 3.f * accelerationNoise;
+    processNoise(0, 2) = processNoise(2, 0) = processNoise(1, 3) = processNoise(3, 1) = dt2 / 2.f * accelerationNoise;
+    processNoise(2, 2) = processNoise(3, 3) = dt * accelerationNoise;
+    track.state = transition * track.state;
+    track.covariance = transition * track.covariance * transition.transpose() + processNoise;
+    track.stateSeconds = timeSeconds;
+}
+
+// the sonar measures range and bearing, so the noise is an ellipse stretched along the line of sight in range
+// and across it by range·σθ, rotated into east/north with the radial (sin b, cos b) and tangential (cos b, -sin b) axes
+static Eigen::Matrix2f measurementNoise(const Detection& detection)
+{
+    float bearing = detection.bearingDegrees * DEG2RAD;
+    Eigen::Vector2f radial(std::sin(bearing), std::cos(bearing));
+    Eigen::Vector2f tangential(std::cos(bearing), -std::sin(bearing));
+    float crossRangeSigma = std::max(detection.rangeKilometers, 1.f) * 0.29f * detection.beamWidthDegrees * DEG2RAD;
+    return rangeSigmaKilometers * rangeSigmaKilometers * radial * radial.transpose()
+        + crossRangeSigma * crossRangeSigma * tangential * tangential.transpose();
+}
+
+// bearing and range are measured from where the sensor that made the detection was, tracks live in the world frame
+static Eigen::Vector2f measurementPosition(const Detection& detection)
+{
+    float bearing = detection.bearingDegrees * DEG2RAD;
+    return { detection.sensorXKilometers + std::sin(bearing) * detection.rangeKilometers,
+        detection.sensorYKilometers + std::cos(bearing) * detection.rangeKilometers };
+}
+
+// every track sits at the batch time but each detection was made at its own tick a little earlier, so rather than rewinding the
+// track we observe its current state through H = [I  dt·I] (position dt seconds ago = position + velocity·dt, dt <= 0)
+static Eigen::Matrix<float, 2, 4> observation(const Track& track, const Detection& detection)
+{
+    Eigen::Matrix<float, 2, 4> observationMatrix;
+    float dt = (float)(detection.timeSeconds - track.stateSeconds);
+    observationMatrix << Eigen::Matrix2f::Identity(), Eigen::Matrix2f::Identity() * dt;
+    return observationMatrix;
+}
+
+// squared Mahalanobis distance between the track's predicted position and the detection, i.e. the distance measured in
+// "standard deviations" of the combined uncertainty S = H P Hᵀ + R, so a fuzzy old track accepts detections further away than a fresh one,
+// the gate tests that distance alone, the returned cost adds ln|S| (the Gaussian likelihood's normalisation) so that when a sharp track and a
+// fuzzy brand-new one both accept a detection, the sharp one wins it rather than whichever happens to be a bit closer in its own units
+static bool gateCost(const Track& track, const Detection& detection, float& cost)
+{
+    Eigen::Matrix<float, 2, 4> observationMatrix = observation(track, detection);
+    Eigen::Vector2f innovation = measurementPosition(detection) - observationMatrix * track.state;
+    Eigen::Matrix2f innovationCovariance = observationMatrix * track.covariance * observationMatrix.transpose() + measurementNoise(detection);
+    float distance = innovation.dot(innovationCovariance.inverse() * innovation);
+    cost = distance + std::log(innovationCovariance.determinant());
+    return distance < gateThreshold;
+}
+
+// the standard Kalman update, K = P Hᵀ S⁻¹ decides how far to move toward the measurement,
+// the Joseph form of the covariance update keeps P symmetric positive definite with floats over thousands of updates
+static void updateTrack(Track& track, const Detection& detection)
+{
+    Eigen::Matrix<float, 2, 4> observationMatrix = observation(track, detection);
+    Eigen::Matrix2f noise = measurementNoise(detection);
+    Eigen::Vector2f innovation = measurementPosition(detection) - observationMatrix * track.state;
+    Eigen::Matrix2f innovationCovariance = observationMatrix * track.covariance * observationMatrix.transpose() + noise;
+    Eigen::Matrix<float, 4, 2> gain = track.covariance * observationMatrix.transpose() * innovationCovariance.inverse();
+    track.state += gain * innovation;
+    Eigen::Matrix4f correction = Eigen::Matrix4f::Identity() - gain * observationMatrix;
+    track.covariance = correction * track.covariance * correction.transpose() + gain * noise * gain.transpose();
+    track.lastHitSeconds = detection.timeSeconds;
+    track.confirmed = ++track.hits >= confirmationHits || track.confirmed;
+}
+
+// a detection nobody claimed starts a tentative track, position from the measurement, velocity unknown: 0 with a σ of half the fastest
+// target speed, so the 99.9% gate one revolution later roughly matches how far the fastest target could have gone
+static Track startTrack(Tracker& tracker, const Detection& detection, float speedScale)
+{
+    Track track;
+    track.id = tracker.nextTrackId++;
+    track.state << measurementPosition(detection), 0.f, 0.f;
+    float velocitySigma = 0.5f * 4.4f * speedScale;
+    track.covariance.setZero();
+    track.covariance.topLeftCorner<2, 2>() = measurementNoise(detection);
+    track.covariance(2, 2) = track.covariance(3, 3) = velocitySigma * velocitySigma;
+    track.stateSeconds = track.lastHitSeconds = detection.timeSeconds;
+    return track;
+}
+
+// column (or row) of a world coordinate in the grid centered on our ship's coordinate, anything further out lands in the edge cells
+static int gridCell(float kilometers, float centerKilometers)
+{
+    return std::clamp((int)((kilometers - centerKilometers + maximumRangeKilometers) / gridCellKilometers), 0, gridSide - 1);
+}
+
+#pragma region tracker
+// runs one association batch every trackerBatchSeconds over the active detections gathered since the last one:
+// 1. predict every track to now
+// 2. bucket the detections into a coarse grid (counting sort into cellStart/cellDetections, no allocation),
+//    so each track only looks at the few cells its gate can reach instead of every detection (thousands of tracks stay cheap)
+// 3. collect every (track, detection) pair inside the gate, sort by cost and hand out greedily, most likely pairs first,
+//    a global nearest neighbour: a detection feeds at most one track and a track takes at most one detection per sensor per batch,
+//    so a contact seen by our ship and a buoy in the same batch is fused into one track instead of spawning a duplicate
+// 4. Kalman update the winners, start tentative tracks from leftover detections,
+//    drop tentative tracks that missed about 1.5 revolutions and confirmed ones that missed 3 (the contact faded or left)
+// passive detections are bearing-only and can't be placed on the plot, they're ignored here
+void updateTracker(SonarState& sonarState)
+{
+    Tracker& tracker = sonarState.tracker;
+    for (const Detection& detection : sonarState.detections)
+        if (detection.active)
+            tracker.pendingDetections.push_back(detection);
+    if (sonarState.elapsedSeconds - tracker.lastBatchSeconds < trackerBatchSeconds)
+        return;
+    const double now = sonarState.elapsedSeconds;
+    tracker.lastBatchSeconds = now;
+
+    for (Track& track : tracker.tracks)
+        predictTrack(track, now);
+
+    const std::vector<Detection>& detections = tracker.pendingDetections;
+    const float centerX = sonarState.ownship.xKilometers, centerY = sonarState.ownship.yKilometers;
+    tracker.cellStart.assign(gridSide * gridSide + 1, 0);
+    tracker.cellDetections.resize(detections.size());
+    for (const Detection& detection : detections) {
+        Eigen::Vector2f position = measurementPosition(detection);
+        ++tracker.cellStart[gridCell(position.y(), centerY) * gridSide + gridCell(position.x(), centerX) + 1];
+    }
+    for (int cellId = 0; cellId < gridSide * gridSide; ++cellId)
+        tracker.cellStart[cellId + 1] += tracker.cellStart[cellId];
+    std::vector<int>& cellFill = tracker.cellFill;
+    cellFill.assign(tracker.cellStart.begin(), tracker.cellStart.end() - 1);
+    for (int detectionId = 0; detectionId < (int)detections.size(); ++detectionId) {
+        Eigen::Vector2f position = measurementPosition(detections[detectionId]);
+        tracker.cellDetections[cellFill[gridCell(position.y(), centerY) * gridSide + gridCell(position.x(), centerX)]++] = detectionId;
+    }
+
+    tracker.candidates.clear();
+    if (!detections.empty()) {
+        for (int trackId = 0; trackId < (int)tracker.tracks.size(); ++trackId) {
+            const Track& track = tracker.tracks[trackId];
+            // the gate ellipse fits in a circle of radius sqrt(threshold · trace(S)), plus how far the track moves within the batch
+            float gateRadius = std::sqrt(gateThreshold * (track.covariance(0, 0) + track.covariance(1, 1) + 2.f * rangeSigmaKilometers * rangeSigmaKilometers
+                                             + std::pow(maximumRangeKilometers * widestBearingSigmaRadians, 2.f)))
+                + track.state.tail<2>().norm() * (float)trackerBatchSeconds;
+            int columnMin = gridCell(track.state.x() - gateRadius, centerX), columnMax = gridCell(track.state.x() + gateRadius, centerX);
+            int rowMin = gridCell(track.state.y() - gateRadius, centerY), rowMax = gridCell(track.state.y() + gateRadius, centerY);
+            for (int row = rowMin; row <= rowMax; ++row)
+                for (int column = columnMin; column <= columnMax; ++column)
+                    for (int slot = tracker.cellStart[row * gridSide + column]; slot < tracker.cellStart[row * gridSide + column + 1]; ++slot) {
+                        int detectionId = tracker.cellDetections[slot];
+                        float cost;
+                        if (gateCost(track, detections[detectionId], cost))
+                            tracker.candidates.emplace_back(cost, trackId, detectionId);
+                    }
+        }
+    }
+    std::sort(tracker.candidates.begin(), tracker.candidates.end());
+
+    std::vector<uint64_t>& trackTaken = tracker.trackTaken;
+    std::vector<char>& detectionTaken = tracker.detectionTaken;
+    trackTaken.assign(tracker.tracks.size(), 0);
+    detectionTaken.assign(detections.size(), 0);
+    for (const auto& [cost, trackId, detectionId] : tracker.candidates) {
+        uint64_t sensorBit = 1ull << detections[detectionId].sensorId;
+        if ((trackTaken[trackId] & sensorBit) || detectionTaken[detectionId])
+            continue;
+        trackTaken[trackId] |= sensorBit;
+        detectionTaken[detectionId] = 1;
+        updateTrack(tracker.tracks[trackId], detections[detectionId]);
+    }
+
+    float speedScale = sonarState.sweepSpeedDegreesPerSecond / 90.f;
+    for (int detectionId = 0; detectionId < (int)detections.size(); ++detectionId)
+        if (!detectionTaken[detectionId]) {
+            tracker.tracks.push_back(startTrack(tracker, detections[detectionId], speedScale));
+            predictTrack(tracker.tracks.back(), now);
+        }
+
+    double revolutionSeconds = 360.0 / sonarState.sweepSpeedDegreesPerSecond;
+    tracker.tracks.erase(std::remove_if(tracker.tracks.begin(), tracker.tracks.end(),
+                             [&](const Track& track) {
+                                 double silentSeconds = now - track.lastHitSeconds;
+                                 return silentSeconds > revolutionSeconds * (track.confirmed ? 3.0 : 1.5)
+                                     || std::abs(track.state.x() - centerX) > maximumRangeKilometers * 1.2f
+                                     || std::abs(track.state.y() - centerY) > maximumRangeKilometers * 1.2f;
+                             }),
+        tracker.tracks.end());
+    tracker.pendingDetections.clear();
+}
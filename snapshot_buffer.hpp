@@ -0,0 +1,26 @@
+#pragma once
+
+#include "main.hpp"
+
+// lock-free single writer/single reader hand-off of the latest snapshot, shared by the sonar and the kinematic controller threads,
+// the writer fills its slot then swaps it with the "latest" slot,
+// the reader swaps its slot with "latest" only if something new was published since, neither side ever waits for the other,
+// two slots aren't enough: while the reader draws from one, the writer must be able to finish a second AND start a third
+// (a double buffer where the writer can always move on, just with its spare made explicit)
+// latest packs the slot index in bits 0-1 and a "not picked up yet" flag in bit 2 so both travel in one atomic exchange
+template <typename Snapshot>
+struct SnapshotBuffer {
+    std::array<Snapshot, 3> slots;
+    std::atomic<int> latest { 0 };
+    int writing = 1; // only touched by the writer
+    int reading = 2; // only touched by the reader
+
+    Snapshot& write() { return slots[writing]; }
+    void publish() { writing = latest.exchange(writing | 4, std::memory_order_acq_rel) & 3; }
+    const Snapshot& read()
+    {
+        if (latest.load(std::memory_order_relaxed) & 4)
+            reading = latest.exchange(reading, std::memory_order_acq_rel) & 3;
+        return slots[reading];
+    }
+};
@@ -35,7 +35,7 @@ struct Output
     std::vector<Eigen::Vector3d> orientation;
 };
 
-Eigen::Vector3d get_first_point(const Input& input) {
+inline Eigen::Vector3d get_first_point(const Input& input) {
     // turn each vertex from local to world space using homogeneous coords
     Eigen::MatrixXd V_world(input.V.rows(), 3);
     for (int i = 0; i < input.V.rows(); i++) {
@@ -62,7 +62,7 @@ Eigen::Vector3d get_first_point(const Input& input) {
     return lowest_vertex - (lowest_vertex.dot(normal)) * normal;
 }
 
-Output ramping(const Input& input) {
+inline Output ramping(const Input& input) {
     Output output;
     Eigen::Vector3d first_point = get_first_point(input);
     Eigen::Vector3d normal = input.slicing_plane_normal.normalized();